@@ -0,0 +1,427 @@
+/*
+ * UDstructs.c
+ * Free list, instruction queues and branch target buffer used by the APEX
+ * pipeline. All state lives in the structures passed in, so any number of
+ * cores can use these at once.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apex_cpu.h"
+
+void free_list_init(free_list *fl, int size)
+{
+    fl->words = (size + 63) / 64;
+    fl->bits = (unsigned long long *)calloc(fl->words, sizeof(unsigned long long));
+    if (fl->bits == NULL)
+    {
+        printf("Error creating a new free list.\n");
+        exit(0);
+    }
+    fl->size = size;
+    fl->free_count = 0;
+}
+
+void free_list_release(free_list *fl, int preg)
+{
+    unsigned long long mask = 1ULL << (preg & 63);
+
+    if (!(fl->bits[preg >> 6] & mask))
+    {
+        fl->bits[preg >> 6] |= mask;
+        fl->free_count++;
+    }
+}
+
+/* Takes a specific register off the free list */
+void free_list_claim(free_list *fl, int preg)
+{
+    unsigned long long mask = 1ULL << (preg & 63);
+
+    if (fl->bits[preg >> 6] & mask)
+    {
+        fl->bits[preg >> 6] &= ~mask;
+        fl->free_count--;
+    }
+}
+
+/* Returns the allocated register, or -1 if none is free */
+int free_list_alloc(free_list *fl)
+{
+    int w;
+
+    for (w = 0; w < fl->words; ++w)
+    {
+        if (fl->bits[w])
+        {
+            int bit = __builtin_ctzll(fl->bits[w]);
+            fl->bits[w] &= fl->bits[w] - 1;
+            fl->free_count--;
+            return (w << 6) + bit;
+        }
+    }
+    return -1;
+}
+
+int free_list_count(const free_list *fl)
+{
+    return fl->free_count;
+}
+
+/* Marks every register free */
+void free_list_fill(free_list *fl)
+{
+    int i;
+
+    memset(fl->bits, 0, fl->words * sizeof(unsigned long long));
+    for (i = 0; i < fl->size; ++i)
+    {
+        fl->bits[i >> 6] |= 1ULL << (i & 63);
+    }
+    fl->free_count = fl->size;
+}
+
+void free_list_dispose(free_list *fl)
+{
+    free(fl->bits);
+    fl->bits = NULL;
+    fl->words = 0;
+    fl->size = 0;
+    fl->free_count = 0;
+}
+
+btb_buffer *insert_address_btb(btb_buffer *head, CPU_Stage data, int res)
+{
+    btb_buffer *cursor = head;
+    if (cursor != NULL)
+    {
+        while (cursor != NULL)
+        {
+            if (cursor->data.rob_tag == data.rob_tag)
+            {
+                cursor->data.computed_address = data.result_buffer;
+                cursor->data.active_flag = 1;
+                cursor->data.taken = res;
+                break;
+            }
+            cursor = cursor->next;
+        }
+    }
+    return head;
+}
+
+/* Gives the oldest entry not yet dispatched the branch's ROB tag */
+btb_buffer *tag_btb(btb_buffer *head, int rob_tag)
+{
+    btb_buffer *cursor = head;
+    while (cursor != NULL)
+    {
+        if (cursor->data.rob_tag == -1)
+        {
+            cursor->data.rob_tag = rob_tag;
+            break;
+        }
+        cursor = cursor->next;
+    }
+    return head;
+}
+
+btb_buffer *create_btb(BTB data, btb_buffer *next)
+{
+    btb_buffer *new_node = (btb_buffer *)malloc(sizeof(btb_buffer));
+    if (new_node == NULL)
+    {
+        printf("Error creating a new btb_buffer.\n");
+        exit(0);
+    }
+    new_node->data = data;
+    new_node->next = next;
+
+    return new_node;
+}
+
+btb_buffer *prepend_btb(btb_buffer *head, BTB data)
+{
+    btb_buffer *new_node = create_btb(data, head);
+    head = new_node;
+    return head;
+}
+
+btb_buffer *append_btb(btb_buffer *head, BTB data)
+{
+    if (head == NULL)
+        return NULL;
+    /* go to the last node */
+    btb_buffer *cursor = head;
+    while (cursor->next != NULL)
+        cursor = cursor->next;
+
+    /* create a new node */
+    btb_buffer *new_node = create_btb(data, NULL);
+    cursor->next = new_node;
+
+    return head;
+}
+
+btb_buffer *enqueue_btb(btb_buffer *head, BTB data)
+{
+    if (head == NULL)
+    {
+        head = prepend_btb(head, data);
+    }
+    else
+    {
+        head = append_btb(head, data);
+    }
+    return head;
+}
+
+void traverse_btb(btb_buffer *head, callback3 f)
+{
+    btb_buffer *cursor = head;
+    while (cursor != NULL)
+    {
+        f(cursor);
+        cursor = cursor->next;
+    }
+}
+
+btb_buffer *dequeue_btb(btb_buffer *head)
+{
+    if (head == NULL)
+        return NULL;
+    btb_buffer *front = head;
+    head = head->next;
+    front->next = NULL;
+    /* is this the last node in the list */
+    if (front == head)
+        head = NULL;
+    free(front);
+    return head;
+}
+
+int count_btb(btb_buffer *head)
+{
+    btb_buffer *cursor = head;
+    int c = 0;
+    while (cursor != NULL)
+    {
+        c++;
+        cursor = cursor->next;
+    }
+    return c;
+}
+
+BTB searchAtIndex_BTB(btb_buffer *head, int index)
+{
+
+    btb_buffer *cursor = head;
+    int i = 0;
+    while (i != index)
+    {
+
+        cursor = cursor->next;
+        i++;
+    }
+    return cursor->data;
+}
+
+btb_buffer *remove_back_btb(btb_buffer *head)
+{
+    if (head == NULL)
+        return NULL;
+
+    btb_buffer *cursor = head;
+    btb_buffer *back = NULL;
+    while (cursor->next != NULL)
+    {
+        back = cursor;
+        cursor = cursor->next;
+    }
+
+    if (back != NULL)
+        back->next = NULL;
+
+    /* if this is the last node in the list*/
+    if (cursor == head)
+        head = NULL;
+
+    free(cursor);
+
+    return head;
+}
+btb_buffer *remove_front_btb(btb_buffer *head)
+{
+    if (head == NULL)
+        return NULL;
+    btb_buffer *front = head;
+    head = head->next;
+    front->next = NULL;
+    /* is this the last node in the list */
+    if (front == head)
+        head = NULL;
+    free(front);
+    return head;
+}
+btb_buffer *remove_any_btb(btb_buffer *head, btb_buffer *nd)
+{
+    if (nd == NULL)
+        return NULL;
+    /* if the node is the first node */
+    if (nd == head)
+        return remove_front_btb(head);
+
+    /* if the node is the last node */
+    if (nd->next == NULL)
+        return remove_back_btb(head);
+
+    /* if the node is in the middle */
+    btb_buffer *cursor = head;
+    while (cursor != NULL)
+    {
+        if (cursor->next == nd)
+            break;
+        cursor = cursor->next;
+    }
+
+    if (cursor != NULL)
+    {
+        btb_buffer *tmp = cursor->next;
+        cursor->next = tmp->next;
+        tmp->next = NULL;
+        free(tmp);
+    }
+    return head;
+}
+
+void dispose_btb(btb_buffer *head)
+{
+    btb_buffer *cursor, *tmp;
+
+    cursor = head;
+    while (cursor != NULL)
+    {
+        tmp = cursor->next;
+        free(cursor);
+        cursor = tmp;
+    }
+}
+
+void queue_init(inst_queue *q, int capacity)
+{
+    q->entry = (CPU_Stage *)calloc(capacity, sizeof(CPU_Stage));
+    if (q->entry == NULL)
+    {
+        printf("Error creating a new queue.\n");
+        exit(0);
+    }
+    q->capacity = capacity;
+    q->head = 0;
+    q->tail = 0;
+    q->count = 0;
+}
+
+int count(const inst_queue *q)
+{
+    return q->count;
+}
+
+int queue_full(const inst_queue *q)
+{
+    return q->count >= q->capacity;
+}
+
+/* Tag of the entry that is index positions behind the head */
+int queue_tag_at(const inst_queue *q, int index)
+{
+    int tag = q->head + index;
+    if (tag >= q->capacity)
+        tag -= q->capacity;
+    return tag;
+}
+
+CPU_Stage *searchAtIndex(inst_queue *q, int index)
+{
+    return &q->entry[queue_tag_at(q, index)];
+}
+
+CPU_Stage *queue_front(inst_queue *q)
+{
+    return &q->entry[q->head];
+}
+
+CPU_Stage *queue_back(inst_queue *q)
+{
+    return &q->entry[queue_tag_at(q, q->count - 1)];
+}
+
+/* Position of the entry tagged tag behind the head, i.e. its age rank */
+int queue_age(const inst_queue *q, int tag)
+{
+    int age = tag - q->head;
+    if (age < 0)
+        age += q->capacity;
+    return age;
+}
+
+/* Returns the tag assigned to the new entry, or -1 if the queue is full */
+int enqueue(inst_queue *q, CPU_Stage data)
+{
+    int tag = q->tail;
+
+    if (q->count == q->capacity)
+        return -1;
+    q->entry[tag] = data;
+    q->tail = (tag + 1 == q->capacity) ? 0 : tag + 1;
+    q->count++;
+    return tag;
+}
+
+void dequeue(inst_queue *q)
+{
+    if (q->count == 0)
+        return;
+    q->head = (q->head + 1 == q->capacity) ? 0 : q->head + 1;
+    q->count--;
+}
+
+/* Drops the youngest entry */
+void queue_pop_back(inst_queue *q)
+{
+    if (q->count == 0)
+        return;
+    q->tail = queue_tag_at(q, q->count - 1);
+    q->count--;
+}
+
+/* Removes the entry index positions behind the head, sliding the younger
+ * entries up by one slot. Nothing is allocated or freed. */
+void remove_any(inst_queue *q, int index)
+{
+    int i;
+
+    if (index < 0 || index >= q->count)
+        return;
+    for (i = index; i < q->count - 1; ++i)
+    {
+        q->entry[queue_tag_at(q, i)] = q->entry[queue_tag_at(q, i + 1)];
+    }
+    q->tail = queue_tag_at(q, q->count - 1);
+    q->count--;
+}
+
+void queue_clear(inst_queue *q)
+{
+    q->head = 0;
+    q->tail = 0;
+    q->count = 0;
+}
+
+void dispose(inst_queue *q)
+{
+    free(q->entry);
+    q->entry = NULL;
+    q->capacity = 0;
+    queue_clear(q);
+}
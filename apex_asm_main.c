@@ -0,0 +1,38 @@
+/*
+ * apex_asm_main.c
+ * apex_asm: parses an assembly program once and writes it out as a
+ * predecoded image that apex_sim maps instead of parsing
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "apex_cpu.h"
+#include "apex_image.h"
+
+int
+main(int argc, char const *argv[])
+{
+    APEX_Instruction *code;
+    int size = 0;
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "APEX_Help: Usage %s <input_file> <image_file>\n", argv[0]);
+        exit(1);
+    }
+
+    code = create_code_memory(argv[1], &size);
+    if (!code)
+    {
+        fprintf(stderr, "APEX_Error: Unable to parse %s\n", argv[1]);
+        exit(1);
+    }
+    if (APEX_image_write(argv[2], code, size) < 0)
+    {
+        free(code);
+        exit(1);
+    }
+    printf("APEX_Asm: %d instructions written to %s\n", size, argv[2]);
+    free(code);
+    return 0;
+}
@@ -0,0 +1,408 @@
+/*
+ * apex_batch.c
+ * Runs a list of simulation jobs on a work-stealing thread pool and prints
+ * one aggregated report
+ *
+ * Every worker owns a deque holding a contiguous block of the job list. It
+ * takes work from the bottom of its own deque; once that is empty it steals
+ * from the top of the others', so a few long jobs do not leave the rest of
+ * the pool idle. No job creates new jobs, so a worker that finds every
+ * deque empty is done.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "apex_batch.h"
+#include "apex_cpu.h"
+#include "apex_functional.h"
+
+typedef struct job_deque
+{
+    pthread_mutex_t lock;
+    int *ids;
+    int top;    /* Next job a thief takes */
+    int bottom; /* One past the next job the owner takes */
+} job_deque;
+
+typedef struct batch_pool
+{
+    APEX_Batch *batch;
+    job_deque *deques;
+} batch_pool;
+
+typedef struct batch_worker
+{
+    batch_pool *pool;
+    int id;
+    pthread_t thread;
+} batch_worker;
+
+static double
+now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *
+status_name(int status)
+{
+    switch (status)
+    {
+    case APEX_RUN_HALTED:
+        return "halted";
+    case APEX_RUN_STOPPED:
+        return "stopped";
+    case APEX_RUN_CYCLE_LIMIT:
+        return "cycle-limit";
+    case APEX_RUN_INSN_LIMIT:
+        return "insn-limit";
+    case APEX_JOB_STUCK:
+        return "stuck";
+    }
+    return "failed";
+}
+
+/* Owner side: newest job first */
+static int
+deque_pop(job_deque *d)
+{
+    int id = -1;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->top < d->bottom)
+    {
+        id = d->ids[--d->bottom];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return id;
+}
+
+/* Thief side: oldest job first, away from where the owner works */
+static int
+deque_steal(job_deque *d)
+{
+    int id = -1;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->top < d->bottom)
+    {
+        id = d->ids[d->top++];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return id;
+}
+
+static void
+run_job(APEX_Job *job)
+{
+    APEX_CPU *cpu;
+    double start = now_seconds();
+
+    cpu = APEX_cpu_init(job->filename, &job->config);
+    if (!cpu)
+    {
+        job->status = APEX_JOB_FAILED;
+        job->seconds = now_seconds() - start;
+        return;
+    }
+
+    cpu->single_step = 0;
+    cpu->debug_messages = 0;
+    cpu->quiet = 1;
+    cpu->max_cycles = job->max_cycles;
+
+    if (job->fast_forward > 0)
+    {
+        switch (APEX_functional_run(cpu, job->fast_forward))
+        {
+        case APEX_FUNC_HALTED:
+            job->status = APEX_RUN_HALTED;
+            break;
+        case APEX_FUNC_FAULT:
+            job->status = APEX_JOB_FAILED;
+            break;
+        default:
+            job->status = APEX_cpu_run(cpu);
+            break;
+        }
+    }
+    else
+    {
+        job->status = APEX_cpu_run(cpu);
+    }
+    /* A bad data address or division by zero fails the job, as it does
+     * when fast-forwarding */
+    if (job->status == APEX_RUN_FAULT)
+    {
+        job->status = APEX_JOB_FAILED;
+    }
+    /* A run that stopped retiring and idled to the limit measured nothing */
+    if (job->status == APEX_RUN_CYCLE_LIMIT && cpu->clock - cpu->last_retire > cpu->clock / 2)
+    {
+        job->status = APEX_JOB_STUCK;
+    }
+    job->cycles = cpu->clock;
+    job->insns = cpu->insn_completed;
+    APEX_cpu_stop(cpu);
+    job->seconds = now_seconds() - start;
+}
+
+static void *
+worker_main(void *arg)
+{
+    batch_worker *self = arg;
+    batch_pool *pool = self->pool;
+    int threads = pool->batch->threads;
+    int id, stolen, i;
+
+    while (TRUE)
+    {
+        stolen = 0;
+        id = deque_pop(&pool->deques[self->id]);
+        for (i = 1; id < 0 && i < threads; ++i)
+        {
+            id = deque_steal(&pool->deques[(self->id + i) % threads]);
+            stolen = 1;
+        }
+        if (id < 0)
+        {
+            break;
+        }
+
+        run_job(&pool->batch->jobs[id]);
+        pool->batch->jobs[id].worker = self->id;
+        pool->batch->jobs[id].stolen = stolen;
+    }
+    return NULL;
+}
+
+/*
+ * Reads a job list: one job per line, the program file followed by optional
+ * key=value settings. Blank lines and lines starting with # are skipped.
+ *
+ * Supported settings:
+ *   max_cycles=N     cycle limit of the job, 0 for none
+ *   fast_forward=N   run the first N instructions on the functional
+ *                    interpreter; cycles and instructions count the rest
+ *   any key of apex_config.h, applied on top of config
+ */
+int
+APEX_batch_load(APEX_Batch *batch, const char *filename, int max_cycles, const APEX_Config *config)
+{
+    FILE *fp;
+    char *line = NULL;
+    size_t len = 0;
+    int line_num = 0;
+    int capacity = 0;
+    char where[256];
+
+    memset(batch, 0, sizeof(*batch));
+    batch->config = *config;
+
+    fp = fopen(filename, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to open job list %s\n", filename);
+        return -1;
+    }
+
+    while (getline(&line, &len, fp) != -1)
+    {
+        char *save;
+        char *token = strtok_r(line, " \t\r\n", &save);
+        APEX_Job *job;
+
+        line_num++;
+        if (!token || token[0] == '#')
+        {
+            continue;
+        }
+
+        if (batch->count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            batch->jobs = realloc(batch->jobs, capacity * sizeof(APEX_Job));
+            if (!batch->jobs)
+            {
+                fprintf(stderr, "APEX_Error: Out of memory reading job list\n");
+                exit(1);
+            }
+        }
+        job = &batch->jobs[batch->count++];
+        memset(job, 0, sizeof(*job));
+        job->filename = strdup(token);
+        job->max_cycles = max_cycles;
+        job->config = *config;
+        snprintf(where, sizeof(where), "%s:%d: ", filename, line_num);
+
+        while ((token = strtok_r(NULL, " \t\r\n", &save)) != NULL)
+        {
+            if (strncmp(token, "max_cycles=", 11) == 0)
+            {
+                job->max_cycles = atoi(token + 11);
+            }
+            else if (strncmp(token, "fast_forward=", 13) == 0)
+            {
+                job->fast_forward = atoll(token + 13);
+            }
+            else if (APEX_config_set(&job->config, token, where) < 0)
+            {
+                free(line);
+                fclose(fp);
+                APEX_batch_free(batch);
+                return -1;
+            }
+        }
+    }
+
+    free(line);
+    fclose(fp);
+    return 0;
+}
+
+/* Runs every job of the batch on threads workers, or one per online CPU if
+ * threads is 0 */
+void
+APEX_batch_run(APEX_Batch *batch, int threads)
+{
+    batch_pool pool;
+    batch_worker *workers;
+    int *ids;
+    int i, w;
+    double start;
+
+    if (threads <= 0)
+    {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads > batch->count)
+    {
+        threads = batch->count;
+    }
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+    batch->threads = threads;
+    if (batch->count == 0)
+    {
+        return;
+    }
+
+    ids = malloc(batch->count * sizeof(int));
+    pool.batch = batch;
+    pool.deques = calloc(threads, sizeof(job_deque));
+    workers = calloc(threads, sizeof(batch_worker));
+    if (!ids || !pool.deques || !workers)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory starting batch\n");
+        exit(1);
+    }
+
+    /* Worker w starts out owning jobs [w * count / threads, (w + 1) * count / threads) */
+    for (i = 0; i < batch->count; ++i)
+    {
+        ids[i] = i;
+    }
+    for (w = 0; w < threads; ++w)
+    {
+        pthread_mutex_init(&pool.deques[w].lock, NULL);
+        pool.deques[w].ids = ids;
+        pool.deques[w].top = (int)((long long)w * batch->count / threads);
+        pool.deques[w].bottom = (int)((long long)(w + 1) * batch->count / threads);
+    }
+
+    start = now_seconds();
+    for (w = 0; w < threads; ++w)
+    {
+        workers[w].pool = &pool;
+        workers[w].id = w;
+        if (pthread_create(&workers[w].thread, NULL, worker_main, &workers[w]) != 0)
+        {
+            fprintf(stderr, "APEX_Error: Unable to start worker thread\n");
+            exit(1);
+        }
+    }
+    for (w = 0; w < threads; ++w)
+    {
+        pthread_join(workers[w].thread, NULL);
+    }
+    batch->seconds = now_seconds() - start;
+
+    for (w = 0; w < threads; ++w)
+    {
+        pthread_mutex_destroy(&pool.deques[w].lock);
+    }
+    free(workers);
+    free(pool.deques);
+    free(ids);
+}
+
+void
+APEX_batch_report(const APEX_Batch *batch)
+{
+    long long total_cycles = 0, total_insns = 0;
+    int by_status[4] = {0, 0, 0, 0};
+    int failed = 0, stuck = 0, stolen = 0;
+    char settings[256];
+    int i;
+
+    printf("%-5s %-11s %10s %10s %6s %9s %6s  %s\n", "Job", "Status", "Cycles",
+           "Insns", "IPC", "Time(s)", "Thread", "Program");
+    for (i = 0; i < batch->count; ++i)
+    {
+        const APEX_Job *job = &batch->jobs[i];
+
+        /* Jobs that change the configuration say how */
+        APEX_config_format(&job->config, &batch->config, settings, sizeof(settings));
+        printf("%-5d %-11s %10d %10d %6.3f %9.4f %5d%c  %s%s%s\n", i, status_name(job->status),
+               job->cycles, job->insns, job->cycles ? (double)job->insns / job->cycles : 0.0,
+               job->seconds, job->worker, job->stolen ? '*' : ' ', job->filename, settings[0] ? " " : "",
+               settings);
+
+        stolen += job->stolen;
+        if (job->status == APEX_JOB_FAILED)
+        {
+            failed++;
+            continue;
+        }
+        if (job->status == APEX_JOB_STUCK)
+        {
+            stuck++;
+            continue;
+        }
+        by_status[job->status]++;
+        total_cycles += job->cycles;
+        total_insns += job->insns;
+    }
+
+    printf("APEX_Batch: %d jobs on %d threads in %.3f s, %d stolen (*)\n",
+           batch->count, batch->threads, batch->seconds, stolen);
+    printf("APEX_Batch: halted = %d cycle limit = %d stopped = %d stuck = %d failed = %d\n",
+           by_status[APEX_RUN_HALTED], by_status[APEX_RUN_CYCLE_LIMIT],
+           by_status[APEX_RUN_STOPPED], stuck, failed);
+    printf("APEX_Batch: cycles = %lld instructions = %lld IPC = %.3f, %.0f cycles/s\n",
+           total_cycles, total_insns, total_cycles ? (double)total_insns / total_cycles : 0.0,
+           batch->seconds > 0 ? total_cycles / batch->seconds : 0.0);
+}
+
+void
+APEX_batch_free(APEX_Batch *batch)
+{
+    int i;
+
+    for (i = 0; i < batch->count; ++i)
+    {
+        free(batch->jobs[i].filename);
+    }
+    free(batch->jobs);
+    batch->jobs = NULL;
+    batch->count = 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * apex_batch.h
+ * Runs many independent simulations on a work-stealing thread pool
+ */
+#ifndef _APEX_BATCH_H_
+#define _APEX_BATCH_H_
+
+#include "apex_config.h"
+
+/* Job status besides the APEX_RUN_* results of APEX_cpu_run */
+#define APEX_JOB_FAILED -1 /* Program could not be loaded */
+#define APEX_JOB_STUCK -2  /* Hit max_cycles, retiring nothing in the second half */
+
+/* Cycle limit of a batch job that does not give its own */
+#define APEX_BATCH_MAX_CYCLES 1000000
+
+/* One simulation of the batch, and its outcome once run */
+typedef struct APEX_Job
+{
+    char *filename;
+    int max_cycles;
+    long long fast_forward; /* Instructions run functionally before the pipeline */
+    APEX_Config config;
+    int status;
+    int cycles;
+    int insns;
+    double seconds; /* Wall time of the simulation */
+    int worker;     /* Thread that ran the job */
+    int stolen;     /* Taken from another thread's deque */
+} APEX_Job;
+
+typedef struct APEX_Batch
+{
+    APEX_Config config; /* Configuration of jobs that do not change it */
+    APEX_Job *jobs;
+    int count;
+    int threads;
+    double seconds; /* Wall time of the whole batch */
+} APEX_Batch;
+
+int APEX_batch_load(APEX_Batch *batch, const char *filename, int max_cycles, const APEX_Config *config);
+void APEX_batch_run(APEX_Batch *batch, int threads);
+void APEX_batch_report(const APEX_Batch *batch);
+void APEX_batch_free(APEX_Batch *batch);
+
+#endif
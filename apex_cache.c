@@ -0,0 +1,299 @@
+/*
+ * apex_cache.c
+ * Looks up, replays and records cached simulation results
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "apex_cache.h"
+
+#define FNV64_OFFSET 14695981039346656037ULL
+#define FNV64_PRIME 1099511628211ULL
+
+static unsigned long long
+hash_bytes(unsigned long long h, const unsigned char *b, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        h = (h ^ b[i]) * FNV64_PRIME;
+    }
+    return h;
+}
+
+static unsigned long long
+hash_u32(unsigned long long h, unsigned int v)
+{
+    unsigned char b[4] = {v & 0xff, (v >> 8) & 0xff, (v >> 16) & 0xff, v >> 24};
+
+    return hash_bytes(h, b, 4);
+}
+
+/* Hash of the simulator executable; where that cannot be read, of the
+ * version and the time this file was compiled */
+static unsigned long long
+build_id(void)
+{
+    unsigned long long h = FNV64_OFFSET;
+    unsigned char buf[65536];
+    FILE *fp = fopen("/proc/self/exe", "rb");
+    size_t n;
+
+    if (!fp)
+    {
+        char fallback[64];
+
+        snprintf(fallback, sizeof(fallback), "%.1f %s %s", VERSION, __DATE__, __TIME__);
+        return hash_bytes(h, (const unsigned char *)fallback, strlen(fallback));
+    }
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        h = hash_bytes(h, buf, n);
+    }
+    fclose(fp);
+    return h;
+}
+
+/* Field by field, so the hash does not depend on the host's layout */
+static unsigned long long
+code_hash(const APEX_CPU *cpu)
+{
+    unsigned long long h = FNV64_OFFSET;
+    int i;
+
+    for (i = 0; i < cpu->code_memory_size; ++i)
+    {
+        const APEX_Instruction *ins = &cpu->code_memory[i];
+
+        h = hash_u32(h, (unsigned int)ins->opcode);
+        h = hash_u32(h, (unsigned int)ins->rd);
+        h = hash_u32(h, (unsigned int)ins->rs1);
+        h = hash_u32(h, (unsigned int)ins->rs2);
+        h = hash_u32(h, (unsigned int)ins->imm);
+    }
+    return h;
+}
+
+/*
+ * Works out the key of a run of the program loaded in cpu, with its
+ * configuration and the given description of the run options, and creates
+ * dir if need be. Returns -1 if the cache cannot be used.
+ */
+int
+APEX_cache_open(APEX_Cache *cache, const char *dir, const APEX_CPU *cpu, const char *options)
+{
+    char config[256];
+    unsigned long long key;
+    int n;
+
+    memset(cache, 0, sizeof(*cache));
+    cache->dir = dir;
+    cache->saved_stdout = -1;
+
+    APEX_config_format(&cpu->config, NULL, config, sizeof(config));
+    n = snprintf(cache->header, sizeof(cache->header), "APEX_Cache %d build=%016llx code=%016llx/%d %s %s\n",
+                 CACHE_VERSION, build_id(), code_hash(cpu), cpu->code_memory_size, config, options);
+    if (n >= (int)sizeof(cache->header))
+    {
+        fprintf(stderr, "APEX_Error: Run options too long to cache\n");
+        return -1;
+    }
+    key = hash_bytes(FNV64_OFFSET, (const unsigned char *)cache->header, n);
+
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "APEX_Error: Unable to create cache directory %s\n", dir);
+        return -1;
+    }
+    n = snprintf(cache->path, sizeof(cache->path), "%s/%016llx", dir, key);
+    if (n >= (int)sizeof(cache->path))
+    {
+        fprintf(stderr, "APEX_Error: Cache directory name too long\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Copies what follows the header line of fp to standard output */
+static void
+copy_output(FILE *fp)
+{
+    char buf[65536];
+    size_t n;
+
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        fwrite(buf, 1, n, stdout);
+    }
+    fflush(stdout);
+}
+
+/* Prints the cached output of the run and returns TRUE, or returns FALSE
+ * if there is no entry for it */
+int
+APEX_cache_replay(const APEX_Cache *cache)
+{
+    char line[CACHE_HEADER_SIZE];
+    FILE *fp = fopen(cache->path, "rb");
+
+    if (!fp)
+    {
+        return FALSE;
+    }
+    if (!fgets(line, sizeof(line), fp) || strcmp(line, cache->header) != 0)
+    {
+        fclose(fp);
+        return FALSE;
+    }
+    copy_output(fp);
+    fclose(fp);
+    return TRUE;
+}
+
+/* Writes all n bytes to fd; returns FALSE if it could not */
+static int
+write_all(int fd, const char *buf, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t w = write(fd, buf, n);
+
+        if (w < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (w <= 0)
+        {
+            return FALSE;
+        }
+        buf += w;
+        n -= (size_t)w;
+    }
+    return TRUE;
+}
+
+/* Copies what the run prints to the real standard output and the entry
+ * until the pipe closes */
+static void *
+tee_main(void *arg)
+{
+    APEX_Cache *cache = arg;
+    char buf[65536];
+    ssize_t n;
+
+    for (;;)
+    {
+        n = read(cache->pipe_fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        write_all(cache->saved_stdout, buf, (size_t)n);
+        if (!write_all(cache->entry_fd, buf, (size_t)n))
+        {
+            cache->write_failed = TRUE;
+        }
+    }
+    if (n < 0)
+    {
+        cache->write_failed = TRUE;
+    }
+    return NULL;
+}
+
+/* Sends standard output to a new entry, as well as where it went, until
+ * APEX_cache_finish */
+int
+APEX_cache_record(APEX_Cache *cache)
+{
+    mode_t mask;
+    int fd;
+    int p[2];
+
+    snprintf(cache->tmp_path, sizeof(cache->tmp_path), "%s.XXXXXX", cache->path);
+    fd = mkstemp(cache->tmp_path);
+    if (fd < 0)
+    {
+        fprintf(stderr, "APEX_Error: Unable to create a cache entry in %s\n", cache->dir);
+        return -1;
+    }
+    /* mkstemp makes the file private; give it the umask's usual mode so
+     * that a shared cache directory can be read by everyone using it */
+    mask = umask(0);
+    umask(mask);
+    if (fchmod(fd, 0666 & ~mask) != 0 || !write_all(fd, cache->header, strlen(cache->header)))
+    {
+        fprintf(stderr, "APEX_Error: Unable to write a cache entry in %s\n", cache->dir);
+        close(fd);
+        remove(cache->tmp_path);
+        return -1;
+    }
+    if (pipe(p) != 0)
+    {
+        fprintf(stderr, "APEX_Error: Unable to redirect output to the cache\n");
+        close(fd);
+        remove(cache->tmp_path);
+        return -1;
+    }
+    fflush(stdout);
+    cache->entry_fd = fd;
+    cache->pipe_fd = p[0];
+    cache->write_failed = FALSE;
+    cache->saved_stdout = dup(STDOUT_FILENO);
+    if (cache->saved_stdout < 0 || dup2(p[1], STDOUT_FILENO) < 0 ||
+        pthread_create(&cache->tee, NULL, tee_main, cache) != 0)
+    {
+        fprintf(stderr, "APEX_Error: Unable to redirect output to the cache\n");
+        if (cache->saved_stdout >= 0)
+        {
+            dup2(cache->saved_stdout, STDOUT_FILENO);
+            close(cache->saved_stdout);
+            cache->saved_stdout = -1;
+        }
+        close(p[0]);
+        close(p[1]);
+        close(fd);
+        remove(cache->tmp_path);
+        return -1;
+    }
+    close(p[1]);
+    return 0;
+}
+
+/* Ends recording, and keeps what the run printed as the entry of the key
+ * if keep is TRUE */
+void
+APEX_cache_finish(APEX_Cache *cache, int keep)
+{
+    int ok;
+
+    if (cache->saved_stdout < 0)
+    {
+        return;
+    }
+    /* Putting standard output back closes the pipe's last write end, which
+     * lets the tee drain it and stop */
+    ok = fflush(stdout) == 0;
+    dup2(cache->saved_stdout, STDOUT_FILENO);
+    pthread_join(cache->tee, NULL);
+    close(cache->pipe_fd);
+    close(cache->saved_stdout);
+    cache->saved_stdout = -1;
+    ok = close(cache->entry_fd) == 0 && ok && !cache->write_failed;
+
+    if (keep && ok && rename(cache->tmp_path, cache->path) == 0)
+    {
+        fprintf(stderr, "APEX_Cache: result stored as %s\n", cache->path);
+        return;
+    }
+    remove(cache->tmp_path);
+}
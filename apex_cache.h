@@ -0,0 +1,51 @@
+/*
+ * apex_cache.h
+ * Content-addressed cache of simulation results
+ *
+ * A headless run is fully determined by its program, its configuration,
+ * its run options and the simulator binary, so its output can be kept and
+ * replayed. The key is an FNV-1a hash of a header naming all four: a hash
+ * of the predecoded code memory (an assembly file and its image share an
+ * entry), every configuration setting, the options that change what is
+ * printed, and a build ID hashed from the simulator executable itself, so
+ * a rebuilt simulator never replays an old result. Each entry is one file
+ * in the cache directory, named by the key: the header line, then the
+ * run's standard output exactly as printed. A lookup compares the whole
+ * header, so a hash collision is a miss rather than a wrong result.
+ * Timings vary from run to run, so they go to standard error and are not
+ * kept.
+ *
+ * Entries are written to a temporary file and renamed into place, so
+ * concurrent runs never see a partial one. While recording, standard output
+ * goes through a pipe to a thread that copies it both to the terminal and
+ * to the entry, so the run prints as it goes.
+ */
+#ifndef _APEX_CACHE_H_
+#define _APEX_CACHE_H_
+
+#include <pthread.h>
+
+#include "apex_cpu.h"
+
+#define CACHE_VERSION 1
+#define CACHE_HEADER_SIZE 1024
+
+typedef struct APEX_Cache
+{
+    const char *dir;
+    char header[CACHE_HEADER_SIZE];
+    char path[4096];     /* Entry of the key */
+    char tmp_path[4104]; /* Entry being recorded, path plus a suffix */
+    int saved_stdout;    /* Real standard output while recording, or -1 */
+    int entry_fd;        /* Entry being recorded */
+    int pipe_fd;         /* Read end of what the run prints */
+    int write_failed;    /* The entry could not be written in full */
+    pthread_t tee;
+} APEX_Cache;
+
+int APEX_cache_open(APEX_Cache *cache, const char *dir, const APEX_CPU *cpu, const char *options);
+int APEX_cache_replay(const APEX_Cache *cache);
+int APEX_cache_record(APEX_Cache *cache);
+void APEX_cache_finish(APEX_Cache *cache, int keep);
+
+#endif
@@ -0,0 +1,479 @@
+/*
+ * apex_checkpoint.c
+ * Writes and reads checkpoints. Every field is written out one by one, so
+ * the format does not depend on how the compiler lays out the structures.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apex_checkpoint.h"
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+/* Open checkpoint file and the checksum of the bytes it has seen so far */
+typedef struct ckpt_file
+{
+    FILE *fp;
+    unsigned int sum;
+    int error; /* Short read or write, or a value out of range */
+    const APEX_Config *config; /* Sizes the checks of a read go by */
+} ckpt_file;
+
+static void
+ckpt_bytes(ckpt_file *f, unsigned char *b, int n, int writing)
+{
+    int i;
+
+    if (f->error)
+    {
+        memset(b, 0, n);
+        return;
+    }
+    if (writing ? fwrite(b, 1, n, f->fp) != (size_t)n : fread(b, 1, n, f->fp) != (size_t)n)
+    {
+        f->error = TRUE;
+        memset(b, 0, n);
+        return;
+    }
+    for (i = 0; i < n; ++i)
+    {
+        f->sum = (f->sum ^ b[i]) * FNV_PRIME;
+    }
+}
+
+static void
+put_u32(ckpt_file *f, unsigned int v)
+{
+    unsigned char b[4] = {v & 0xff, (v >> 8) & 0xff, (v >> 16) & 0xff, v >> 24};
+
+    ckpt_bytes(f, b, 4, TRUE);
+}
+
+static unsigned int
+get_u32(ckpt_file *f)
+{
+    unsigned char b[4];
+
+    ckpt_bytes(f, b, 4, FALSE);
+    return b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int)b[3] << 24);
+}
+
+static void
+put_i64(ckpt_file *f, long long v)
+{
+    put_u32(f, (unsigned int)v);
+    put_u32(f, (unsigned int)((unsigned long long)v >> 32));
+}
+
+static long long
+get_i64(ckpt_file *f)
+{
+    unsigned long long lo = get_u32(f);
+    unsigned long long hi = get_u32(f);
+
+    return (long long)(lo | (hi << 32));
+}
+
+static void
+put_ints(ckpt_file *f, const int *v, int n)
+{
+    int i;
+
+    for (i = 0; i < n; ++i)
+    {
+        put_u32(f, (unsigned int)v[i]);
+    }
+}
+
+static void
+get_ints(ckpt_file *f, int *v, int n)
+{
+    int i;
+
+    for (i = 0; i < n; ++i)
+    {
+        v[i] = (int)get_u32(f);
+    }
+}
+
+/* Reads a value that must lie in [lo, hi) */
+static int
+get_index(ckpt_file *f, int lo, int hi)
+{
+    int v = (int)get_u32(f);
+
+    if (v < lo || v >= hi)
+    {
+        f->error = TRUE;
+        return lo;
+    }
+    return v;
+}
+
+/*
+ * A latch or queue entry. Registers, physical registers and ROB tags index
+ * arrays when the CPU runs on, so the reader checks them against both
+ * bounds; flag_tag is -1 when there is no flag producer. A latch without an
+ * instruction still has its old fields, which are kept as they are.
+ */
+static void
+put_stage(ckpt_file *f, const CPU_Stage *s)
+{
+    int v[22] = {s->pc, s->imm, s->ps1_value, s->ps2_value, s->result_buffer, (int)s->seq,
+                 s->ps1, s->ps2, s->pd, s->prev_pd, s->rob_tag, s->flag_tag,
+                 s->opcode, s->rs1, s->rs2, s->rd,
+                 s->has_insn, s->stalled, s->flush, s->completed, s->mem_ready, s->fault};
+
+    put_ints(f, v, 22);
+}
+
+static void
+get_stage(ckpt_file *f, CPU_Stage *s)
+{
+    int preg_arch = f->config->pregs;
+    int v[22];
+
+    get_ints(f, v, 22);
+    s->pc = v[0];
+    s->imm = v[1];
+    s->ps1_value = v[2];
+    s->ps2_value = v[3];
+    s->result_buffer = v[4];
+    s->seq = (unsigned int)v[5];
+    s->ps1 = (short)v[6];
+    s->ps2 = (short)v[7];
+    s->pd = (short)v[8];
+    s->prev_pd = (short)v[9];
+    s->rob_tag = (short)v[10];
+    s->flag_tag = (short)v[11];
+    s->opcode = (unsigned char)v[12];
+    s->rs1 = (signed char)v[13];
+    s->rs2 = (signed char)v[14];
+    s->rd = (signed char)v[15];
+    s->has_insn = (unsigned char)v[16];
+    s->stalled = (unsigned char)v[17];
+    s->flush = (unsigned char)v[18];
+    s->completed = (unsigned char)v[19];
+    s->mem_ready = (unsigned char)v[20];
+    s->fault = (unsigned char)v[21];
+
+    if (s->has_insn && (s->opcode >= OPCODE_COUNT || s->rs1 < 0 || s->rs1 >= REG_FILE_SIZE ||
+                        s->rs2 < 0 || s->rs2 >= REG_FILE_SIZE || s->rd < 0 || s->rd >= REG_FILE_SIZE ||
+                        s->ps1 < 0 || s->ps1 > preg_arch || s->ps2 < 0 || s->ps2 > preg_arch ||
+                        s->pd < 0 || s->pd > preg_arch || s->prev_pd < 0 || s->prev_pd > preg_arch ||
+                        s->rob_tag < 0 || s->rob_tag >= f->config->rob_size || s->flag_tag < -1 ||
+                        s->flag_tag >= f->config->rob_size))
+    {
+        f->error = TRUE;
+    }
+}
+
+/* Every slot is saved, not only the occupied ones: the pipeline finds
+ * entries by tag */
+static void
+put_queue(ckpt_file *f, const inst_queue *q)
+{
+    int i;
+
+    put_u32(f, q->head);
+    put_u32(f, q->tail);
+    put_u32(f, q->count);
+    for (i = 0; i < q->capacity; ++i)
+    {
+        put_stage(f, &q->entry[i]);
+    }
+}
+
+static void
+get_queue(ckpt_file *f, inst_queue *q)
+{
+    int i;
+
+    q->head = get_index(f, 0, q->capacity);
+    q->tail = get_index(f, 0, q->capacity);
+    q->count = get_index(f, 0, q->capacity + 1);
+    for (i = 0; i < q->capacity; ++i)
+    {
+        get_stage(f, &q->entry[i]);
+    }
+}
+
+static void
+put_btb(ckpt_file *f, btb_buffer *head)
+{
+    btb_buffer *cursor;
+
+    put_u32(f, count_btb(head));
+    for (cursor = head; cursor; cursor = cursor->next)
+    {
+        int v[5] = {cursor->data.active_flag, cursor->data.inst_pc,
+                    cursor->data.computed_address, cursor->data.taken, cursor->data.rob_tag};
+
+        put_ints(f, v, 5);
+    }
+}
+
+/* The pcs are only compared and fetched from, which checks its own
+ * bounds; the rob_tag is -1 until the branch is dispatched */
+static btb_buffer *
+get_btb(ckpt_file *f)
+{
+    btb_buffer *head = NULL;
+    int n = get_index(f, 0, 1 << 24);
+    int i;
+
+    for (i = 0; i < n && !f->error; ++i)
+    {
+        BTB entry;
+
+        entry.active_flag = get_index(f, 0, 2);
+        entry.inst_pc = (int)get_u32(f);
+        entry.computed_address = (int)get_u32(f);
+        entry.taken = get_index(f, 0, 2);
+        entry.rob_tag = get_index(f, -1, f->config->rob_size);
+        head = enqueue_btb(head, entry);
+    }
+    return head;
+}
+
+/* The stages in the order they are stored */
+static CPU_Stage *
+cpu_stage(APEX_CPU *cpu, int i)
+{
+    CPU_Stage *stages[] = {&cpu->fetch, &cpu->decode, &cpu->dispatch, &cpu->issueq,
+                           &cpu->intfu, &cpu->logicalfu, &cpu->mulfu1, &cpu->mulfu2,
+                           &cpu->mulfu3, &cpu->mulfu4, &cpu->dcache, &cpu->rob, &cpu->lsq};
+
+    return i < (int)(sizeof(stages) / sizeof(stages[0])) ? stages[i] : NULL;
+}
+
+static void
+put_sizes(ckpt_file *f, const APEX_Config *config)
+{
+    put_u32(f, REG_FILE_SIZE);
+    put_u32(f, config->pregs);
+    put_u32(f, config->iq_size);
+    put_u32(f, config->rob_size);
+    put_u32(f, config->lsq_size);
+    put_u32(f, config->mul_stages);
+    put_u32(f, config->data_memory_size);
+}
+
+/* The configuration the snapshot was taken with, checked as --set would */
+static int
+get_sizes(ckpt_file *f, APEX_Config *config)
+{
+    if (get_u32(f) != REG_FILE_SIZE)
+    {
+        return -1;
+    }
+    config->pregs = get_index(f, 1, PREGS_MAX + 1);
+    config->iq_size = get_index(f, 1, IQ_MAX + 1);
+    config->rob_size = get_index(f, 1, ROB_MAX + 1);
+    config->lsq_size = get_index(f, 1, LSQ_MAX + 1);
+    config->mul_stages = get_index(f, 1, MUL_STAGES_MAX + 1);
+    config->data_memory_size = get_index(f, 1, DATA_MEMORY_MAX + 1);
+    return f->error ? -1 : 0;
+}
+
+/* Writes the checkpoint next to filename and renames it into place, so an
+ * interrupted save never leaves a partial file under that name */
+int
+APEX_checkpoint_save(const APEX_CPU *cpu, const char *filename)
+{
+    ckpt_file f = {NULL, FNV_OFFSET, FALSE, NULL};
+    APEX_CPU *c = (APEX_CPU *)cpu; /* cpu_stage hands out non-const latches */
+    char *tmp;
+    int i;
+
+    tmp = malloc(strlen(filename) + 5);
+    if (!tmp)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory writing checkpoint\n");
+        return -1;
+    }
+    sprintf(tmp, "%s.tmp", filename);
+    f.fp = fopen(tmp, "wb");
+    if (!f.fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to create checkpoint %s\n", filename);
+        free(tmp);
+        return -1;
+    }
+
+    ckpt_bytes(&f, (unsigned char *)CHECKPOINT_MAGIC, 4, TRUE);
+    put_u32(&f, CHECKPOINT_VERSION);
+    put_sizes(&f, &cpu->config);
+
+    put_u32(&f, cpu->pc);
+    put_u32(&f, cpu->clock);
+    put_u32(&f, cpu->insn_completed);
+    put_i64(&f, cpu->insn_fast_forwarded);
+    put_u32(&f, cpu->cycles_skipped);
+    put_u32(&f, cpu->last_retire);
+    put_u32(&f, cpu->zero_flag);
+    put_u32(&f, cpu->fetch_from_next_cycle);
+    put_u32(&f, cpu->jump_inst);
+    put_u32(&f, cpu->halt_inst);
+    put_ints(&f, cpu->regs, REG_FILE_SIZE);
+    put_ints(&f, cpu->regs_valid, REG_FILE_SIZE);
+    put_ints(&f, cpu->rat, REG_FILE_SIZE);
+    put_ints(&f, cpu->pregs_valid, cpu->config.pregs + 1);
+    put_ints(&f, cpu->renameTableValues, cpu->config.pregs + 1);
+
+    for (i = 0; cpu_stage(c, i); ++i)
+    {
+        put_stage(&f, cpu_stage(c, i));
+    }
+    put_queue(&f, &cpu->issue_queue);
+    put_queue(&f, &cpu->load_store_queue);
+    put_queue(&f, &cpu->reorder_buffer);
+
+    /* Free list as one word per physical register: 1 if free */
+    for (i = 0; i < cpu->config.pregs; ++i)
+    {
+        put_u32(&f, (cpu->preg_free_list.bits[i >> 6] >> (i & 63)) & 1);
+    }
+    put_btb(&f, cpu->btb_head);
+
+    put_u32(&f, cpu->code_memory_size);
+    for (i = 0; i < cpu->code_memory_size; ++i)
+    {
+        const APEX_Instruction *ins = &cpu->code_memory[i];
+        int v[5] = {ins->opcode, ins->rd, ins->rs1, ins->rs2, ins->imm};
+
+        put_ints(&f, v, 5);
+    }
+    put_ints(&f, cpu->data_memory, cpu->config.data_memory_size);
+
+    put_u32(&f, f.sum);
+
+    if (fclose(f.fp) != 0 || f.error || rename(tmp, filename) != 0)
+    {
+        fprintf(stderr, "APEX_Error: Unable to write checkpoint %s\n", filename);
+        remove(tmp);
+        free(tmp);
+        return -1;
+    }
+    free(tmp);
+    return 0;
+}
+
+/* Returns a CPU in the saved state, with the reset run settings, or NULL if
+ * the file is not a checkpoint this simulator can resume */
+APEX_CPU *
+APEX_checkpoint_load(const char *filename)
+{
+    ckpt_file f = {NULL, FNV_OFFSET, FALSE, NULL};
+    unsigned char magic[4];
+    unsigned int version, sum;
+    APEX_Config config;
+    APEX_CPU *cpu;
+    int i;
+
+    f.fp = fopen(filename, "rb");
+    if (!f.fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to open checkpoint %s\n", filename);
+        return NULL;
+    }
+
+    ckpt_bytes(&f, magic, 4, FALSE);
+    version = get_u32(&f);
+    if (f.error || memcmp(magic, CHECKPOINT_MAGIC, 4) != 0)
+    {
+        fprintf(stderr, "APEX_Error: %s is not an APEX checkpoint\n", filename);
+        fclose(f.fp);
+        return NULL;
+    }
+    if (version != CHECKPOINT_VERSION)
+    {
+        fprintf(stderr, "APEX_Error: %s is checkpoint version %u, this simulator reads version %d\n",
+                filename, version, CHECKPOINT_VERSION);
+        fclose(f.fp);
+        return NULL;
+    }
+    if (get_sizes(&f, &config) < 0)
+    {
+        fprintf(stderr, "APEX_Error: %s was saved with a register file or configuration this simulator cannot run\n",
+                filename);
+        fclose(f.fp);
+        return NULL;
+    }
+
+    cpu = APEX_cpu_create(&config);
+    if (!cpu)
+    {
+        fclose(f.fp);
+        return NULL;
+    }
+    f.config = &cpu->config;
+
+    cpu->pc = (int)get_u32(&f);
+    cpu->clock = (int)get_u32(&f);
+    cpu->insn_completed = (int)get_u32(&f);
+    cpu->insn_fast_forwarded = get_i64(&f);
+    cpu->cycles_skipped = (int)get_u32(&f);
+    cpu->last_retire = (int)get_u32(&f);
+    cpu->zero_flag = (int)get_u32(&f);
+    cpu->fetch_from_next_cycle = (int)get_u32(&f);
+    cpu->jump_inst = (int)get_u32(&f);
+    cpu->halt_inst = (int)get_u32(&f);
+    get_ints(&f, cpu->regs, REG_FILE_SIZE);
+    get_ints(&f, cpu->regs_valid, REG_FILE_SIZE);
+    for (i = 0; i < REG_FILE_SIZE; ++i)
+    {
+        cpu->rat[i] = get_index(&f, 0, PREG_ARCH(cpu) + 1);
+    }
+    get_ints(&f, cpu->pregs_valid, cpu->config.pregs + 1);
+    get_ints(&f, cpu->renameTableValues, cpu->config.pregs + 1);
+
+    for (i = 0; cpu_stage(cpu, i); ++i)
+    {
+        get_stage(&f, cpu_stage(cpu, i));
+    }
+    get_queue(&f, &cpu->issue_queue);
+    get_queue(&f, &cpu->load_store_queue);
+    get_queue(&f, &cpu->reorder_buffer);
+
+    for (i = 0; i < cpu->config.pregs; ++i)
+    {
+        if (!get_u32(&f))
+        {
+            free_list_claim(&cpu->preg_free_list, i);
+        }
+    }
+    cpu->btb_head = get_btb(&f);
+
+    cpu->code_memory_size = get_index(&f, 0, 1 << 24);
+    cpu->code_memory = calloc(cpu->code_memory_size ? cpu->code_memory_size : 1, sizeof(APEX_Instruction));
+    if (!cpu->code_memory)
+    {
+        f.error = TRUE;
+    }
+    for (i = 0; i < cpu->code_memory_size && !f.error; ++i)
+    {
+        APEX_Instruction *ins = &cpu->code_memory[i];
+
+        ins->opcode = get_index(&f, 0, OPCODE_COUNT);
+        ins->rd = get_index(&f, 0, REG_FILE_SIZE);
+        ins->rs1 = get_index(&f, 0, REG_FILE_SIZE);
+        ins->rs2 = get_index(&f, 0, REG_FILE_SIZE);
+        ins->imm = (int)get_u32(&f);
+    }
+    get_ints(&f, cpu->data_memory, cpu->config.data_memory_size);
+
+    /* The checksum covers everything before it, so read it outside the sum */
+    sum = f.sum;
+    if (get_u32(&f) != sum || f.error || fgetc(f.fp) != EOF)
+    {
+        fprintf(stderr, "APEX_Error: Checkpoint %s is corrupt or truncated\n", filename);
+        fclose(f.fp);
+        APEX_cpu_stop(cpu);
+        return NULL;
+    }
+    fclose(f.fp);
+    return cpu;
+}
@@ -0,0 +1,33 @@
+/*
+ * apex_checkpoint.h
+ * Snapshots of the complete simulator state, to resume a run later
+ *
+ * A checkpoint holds everything a cycle reads: the architectural and
+ * physical registers, the RAT, free list, every pipeline latch, the issue,
+ * load-store and reorder queues slot by slot, the BTB, data memory and the
+ * program itself. Restoring one gives a CPU that carries on exactly as the
+ * saved one would have. Run settings (limits, tracing, single-step) are not
+ * part of it.
+ *
+ * All numbers are little-endian 32-bit words (64-bit for the instruction
+ * counts), and the file ends with an FNV-1a checksum of everything before it:
+ *
+ *   "APXK" version  sizes  cpu  stages  queues  free_list  btb  code  data  checksum
+ *
+ * The sizes are the architectural register file size and the configuration
+ * (apex_config.h) the snapshot was taken with. A restored CPU is created
+ * with that configuration; a simulator built with another register file
+ * refuses the file, as it does any other version.
+ */
+#ifndef _APEX_CHECKPOINT_H_
+#define _APEX_CHECKPOINT_H_
+
+#include "apex_cpu.h"
+
+#define CHECKPOINT_MAGIC "APXK"
+#define CHECKPOINT_VERSION 6
+
+int APEX_checkpoint_save(const APEX_CPU *cpu, const char *filename);
+APEX_CPU *APEX_checkpoint_load(const char *filename);
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ * apex_config.c
+ * Parses and prints microarchitecture configurations
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apex_config.h"
+#include "apex_macros.h"
+
+/* One setting: its key, where it lives and the values it may take */
+typedef struct config_param
+{
+    const char *key;
+    size_t offset;
+    int min;
+    int max;
+} config_param;
+
+static const config_param config_params[] = {
+    {"iq_size", offsetof(APEX_Config, iq_size), 1, IQ_MAX},
+    {"rob_size", offsetof(APEX_Config, rob_size), 1, ROB_MAX},
+    {"lsq_size", offsetof(APEX_Config, lsq_size), 1, LSQ_MAX},
+    {"pregs", offsetof(APEX_Config, pregs), 1, PREGS_MAX},
+    {"mul_stages", offsetof(APEX_Config, mul_stages), 1, MUL_STAGES_MAX},
+    {"data_memory_size", offsetof(APEX_Config, data_memory_size), 1, DATA_MEMORY_MAX},
+};
+
+#define CONFIG_PARAMS (int)(sizeof(config_params) / sizeof(config_params[0]))
+
+static int *
+param_field(APEX_Config *config, const config_param *p)
+{
+    return (int *)((char *)config + p->offset);
+}
+
+void
+APEX_config_defaults(APEX_Config *config)
+{
+    config->iq_size = IQ_SIZE;
+    config->rob_size = ROB_SIZE;
+    config->lsq_size = LSQ_SIZE;
+    config->pregs = PREGS_FILE_SIZE;
+    config->mul_stages = MUL_STAGES;
+    config->data_memory_size = DATA_MEMORY_SIZE;
+}
+
+/* Applies one key=value setting. Spaces around the key and value are
+ * allowed. Returns -1 for an unknown key or a bad value, with a message
+ * starting with where, e.g. "file:line: ". */
+int
+APEX_config_set(APEX_Config *config, const char *setting, const char *where)
+{
+    const char *eq = strchr(setting, '=');
+    const char *key_end, *value;
+    char *end;
+    long v;
+    int i;
+
+    if (!eq)
+    {
+        fprintf(stderr, "APEX_Error: %s%.*s is not of the form key=value\n", where, (int)strcspn(setting, "\r\n"),
+                setting);
+        return -1;
+    }
+    while (*setting == ' ' || *setting == '\t')
+    {
+        setting++;
+    }
+    for (key_end = eq; key_end > setting && (key_end[-1] == ' ' || key_end[-1] == '\t'); --key_end)
+    {
+    }
+    value = eq + 1;
+
+    for (i = 0; i < CONFIG_PARAMS; ++i)
+    {
+        const config_param *p = &config_params[i];
+
+        if (strlen(p->key) != (size_t)(key_end - setting) || strncmp(p->key, setting, key_end - setting) != 0)
+        {
+            continue;
+        }
+        errno = 0;
+        v = strtol(value, &end, 10);
+        while (*end == ' ' || *end == '\t' || *end == '\r' || *end == '\n')
+        {
+            end++;
+        }
+        if (errno || end == value || *end != '\0' || v < p->min || v > p->max)
+        {
+            fprintf(stderr, "APEX_Error: %s%s must be a number from %d to %d\n", where, p->key, p->min, p->max);
+            return -1;
+        }
+        *param_field(config, p) = (int)v;
+        return 0;
+    }
+    fprintf(stderr, "APEX_Error: %sunknown setting %.*s\n", where, (int)(key_end - setting), setting);
+    return -1;
+}
+
+/* Applies every setting of a configuration file on top of config */
+int
+APEX_config_load(APEX_Config *config, const char *filename)
+{
+    FILE *fp;
+    char *line = NULL;
+    size_t len = 0;
+    int line_num = 0;
+    int result = 0;
+    char where[256];
+
+    fp = fopen(filename, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to open configuration %s\n", filename);
+        return -1;
+    }
+    while (result == 0 && getline(&line, &len, fp) != -1)
+    {
+        char *s = line;
+
+        line_num++;
+        while (*s == ' ' || *s == '\t')
+        {
+            s++;
+        }
+        if (*s == '\0' || *s == '\n' || *s == '\r' || *s == '#' || *s == ';')
+        {
+            continue;
+        }
+        snprintf(where, sizeof(where), "%s:%d: ", filename, line_num);
+        result = APEX_config_set(config, s, where);
+    }
+    free(line);
+    fclose(fp);
+    return result;
+}
+
+/* Writes the settings of config that differ from base, or all of them if
+ * base is NULL, as space-separated key=value pairs. Returns the length
+ * written; a buffer too short for them all ends in a cut-off pair. */
+int
+APEX_config_format(const APEX_Config *config, const APEX_Config *base, char *buf, size_t size)
+{
+    int len = 0;
+    int i;
+
+    if (size > 0)
+    {
+        buf[0] = '\0';
+    }
+    for (i = 0; i < CONFIG_PARAMS; ++i)
+    {
+        const config_param *p = &config_params[i];
+        int v = *param_field((APEX_Config *)config, p);
+
+        if (base && v == *param_field((APEX_Config *)base, p))
+        {
+            continue;
+        }
+        if ((size_t)len >= size)
+        {
+            break;
+        }
+        len += snprintf(buf + len, size - len, "%s%s=%d", len ? " " : "", p->key, v);
+    }
+    return len;
+}
@@ -0,0 +1,37 @@
+/*
+ * apex_config.h
+ * Microarchitecture parameters chosen at run time
+ *
+ * Every CPU is created from an APEX_Config that sizes its issue queue, ROB,
+ * LSQ, physical register file, MUL pipeline and data memory, so a design
+ * point needs no rebuild. A configuration starts from the defaults in
+ * apex_macros.h and takes settings of the form key=value, from the command
+ * line (--set) or a configuration file (--config) in INI style:
+ *
+ *   # Wider window
+ *   rob_size = 32
+ *   iq_size = 16
+ *
+ * Blank lines and lines starting with # or ; are skipped.
+ */
+#ifndef _APEX_CONFIG_H_
+#define _APEX_CONFIG_H_
+
+#include <stddef.h>
+
+typedef struct APEX_Config
+{
+    int iq_size;
+    int rob_size;
+    int lsq_size;
+    int pregs;            /* Physical registers */
+    int mul_stages;       /* Cycles a MUL spends in the MUL pipeline */
+    int data_memory_size; /* Words of data memory */
+} APEX_Config;
+
+void APEX_config_defaults(APEX_Config *config);
+int APEX_config_set(APEX_Config *config, const char *setting, const char *where);
+int APEX_config_load(APEX_Config *config, const char *filename);
+int APEX_config_format(const APEX_Config *config, const APEX_Config *base, char *buf, size_t size);
+
+#endif
@@ -1,1776 +1,2272 @@
-/*
- * apex_cpu.c
- * Contains APEX cpu pipeline implementation
- *
- * Author:
- * Copyright (c) 2020, Gaurav Kothari (gkothar1@binghamton.edu)
- * State University of New York at Binghamton
- */
-#include <string.h>
-#include "UDstructs.h"
-// Reference : https://www.zentut.com/c-tutorial/c-linked-list/
-
-/* Converts the PC(4000 series) into array index for code memory
- *
- * Note: You are not supposed to edit this function
- */
-static int
-get_code_memory_index_from_pc(const int pc)
-{
-    return (pc - 4000) / 4;
-}
-
-static void
-print_instruction(const CPU_Stage *stage)
-{
-    switch (stage->opcode)
-    {
-    case OPCODE_STR:
-    case OPCODE_ADD:
-    case OPCODE_SUB:
-    case OPCODE_MUL:
-    case OPCODE_DIV:
-    case OPCODE_AND:
-    case OPCODE_OR:
-    case OPCODE_XOR:
-    case OPCODE_LDR:
-    case OPCODE_CMP:
-    {
-        printf("%s,R%d,R%d,R%d", stage->opcode_str, stage->rd, stage->rs1,
-               stage->rs2);
-        break;
-    }
-
-    case OPCODE_MOVC:
-    {
-        printf("%s,R%d,#%d", stage->opcode_str, stage->rd, stage->imm);
-        break;
-    }
-
-    case OPCODE_LOAD:
-    case OPCODE_ADDL:
-    case OPCODE_SUBL:
-
-    {
-        printf("%s,R%d,R%d,#%d ", stage->opcode_str, stage->rd, stage->rs1,
-               stage->imm);
-        break;
-    }
-
-    case OPCODE_STORE:
-    {
-        printf("%s,R%d,R%d,#%d ", stage->opcode_str, stage->rs1, stage->rs2,
-               stage->imm);
-        break;
-    }
-
-    case OPCODE_BZ:
-    case OPCODE_BNZ:
-    {
-        printf("%s,#%d ", stage->opcode_str, stage->imm);
-        break;
-    }
-    case OPCODE_JUMP:
-    {
-        printf("%s R%d,#%d ", stage->opcode_str, stage->rs1, stage->imm);
-        break;
-    }
-
-    case OPCODE_HALT:
-    {
-        printf("%s", stage->opcode_str);
-        break;
-    }
-
-    case OPCODE_NULL:
-    {
-        printf(" ");
-        break;
-    }
-    case OPCODE_NOP:
-        printf("%s", stage->opcode_str);
-    }
-}
-
-static void
-print_instruction_with_renamed_registers(const CPU_Stage *stage)
-{
-    switch (stage->opcode)
-    {
-    case OPCODE_STR:
-    case OPCODE_ADD:
-    case OPCODE_SUB:
-    case OPCODE_MUL:
-    case OPCODE_DIV:
-    case OPCODE_AND:
-    case OPCODE_OR:
-    case OPCODE_XOR:
-    case OPCODE_LDR:
-    case OPCODE_CMP:
-    {
-        printf("%s,R%d,R%d,R%d\t\t%s,P%d,P%d,P%d", stage->opcode_str, stage->rd, stage->rs1,
-               stage->rs2, stage->opcode_str, stage->pd, stage->ps1, stage->ps2);
-        break;
-    }
-
-    case OPCODE_MOVC:
-    {
-        printf("%s,R%d,#%d\t\t%s,P%d,#%d", stage->opcode_str, stage->rd, stage->imm, stage->opcode_str, stage->pd, stage->imm);
-        break;
-    }
-
-    case OPCODE_LOAD:
-    case OPCODE_ADDL:
-    case OPCODE_SUBL:
-    {
-        printf("%s,R%d,R%d,#%d\t\t%s,P%d,P%d,#%d", stage->opcode_str, stage->rd, stage->rs1,
-               stage->imm, stage->opcode_str, stage->pd, stage->ps1, stage->imm);
-        break;
-    }
-
-    case OPCODE_STORE:
-    {
-        printf("%s,R%d,R%d,#%d\t%s,P%d,P%d,#%d", stage->opcode_str, stage->rs1, stage->rs2,
-               stage->imm, stage->opcode_str, stage->ps1, stage->ps2, stage->imm);
-        break;
-    }
-
-    case OPCODE_BZ:
-    case OPCODE_BNZ:
-    {
-        printf("%s,#%d", stage->opcode_str, stage->imm);
-        break;
-    }
-
-    case OPCODE_HALT:
-    {
-        printf("%s", stage->opcode_str);
-        break;
-    }
-    case OPCODE_JUMP:
-    {
-        printf("%s R%d,#%d\t", stage->opcode_str, stage->rs1, stage->imm);
-        break;
-    }
-
-    case OPCODE_NULL:
-    {
-        printf(" ");
-        break;
-    }
-    case OPCODE_NOP:
-        printf("%s", stage->opcode_str);
-    }
-}
-
-static void
-print_stage_content(const char *name, const CPU_Stage *stage)
-{
-    printf("%-15s: pc(%d) ", name, stage->pc);
-
-    print_instruction_with_renamed_registers(stage);
-
-    printf("\n");
-}
-
-static void
-print_stage_content_for_fetch(const char *name, const CPU_Stage *stage)
-{
-    printf("%-15s: pc(%d) ", name, stage->pc);
-    print_instruction(stage);
-    printf("\n");
-}
-
-static void
-print_reg_file(const APEX_CPU *cpu)
-{
-    int i;
-
-    printf("----------\n%s\n----------\n", "Registers:");
-
-    for (int i = 0; i < REG_FILE_SIZE / 2; ++i)
-    {
-        printf("R%-3d[%-3d] ", i, cpu->regs[i]);
-    }
-
-    printf("\n");
-
-    for (i = (REG_FILE_SIZE / 2); i < REG_FILE_SIZE; ++i)
-    {
-        printf("R%-3d[%-3d] ", i, cpu->regs[i]);
-    }
-
-    printf("\n");
-}
-
-static void print_btb(btb_buffer *head)
-{
-    btb_buffer *cursor = head;
-    printf("BTB Entries: \n");
-    while (cursor != NULL)
-    {
-        printf("act_flg:%d \t inst_add:%d \t computed_add: %d \t taken_flg: %d \n", cursor->data.active_flag, cursor->data.inst_pc, cursor->data.computed_address, cursor->data.taken);
-        cursor = cursor->next;
-    }
-}
-
-/*
- * Fetch Stage of APEX Pipeline
- *
- * Note: You are free to edit this function according to your implementation
- */
-static void
-APEX_fetch(APEX_CPU *cpu)
-{
-
-    APEX_Instruction *current_ins;
-
-    if (cpu->jump_inst == 1)
-    {
-        cpu->fetch.flush = 1;
-        cpu->fetch.stalled = 1;
-    }
-    else
-    {
-        cpu->fetch.flush = 0;
-        cpu->fetch.stalled = 0;
-    }
-
-    if (cpu->decode.stalled == 1)
-    {
-        cpu->fetch.stalled = 1;
-    }
-    else
-    {
-        cpu->fetch.stalled = 0;
-    }
-
-    if (cpu->fetch.flush == 1)
-    {
-        strcpy(cpu->fetch.opcode_str, " ");
-        cpu->fetch.opcode = 0x0;
-        cpu->fetch.pc = '\0';
-        cpu->fetch.flush = 0;
-        return;
-    }
-
-    if (cpu->fetch_from_next_cycle == TRUE)
-    {
-        cpu->fetch_from_next_cycle = FALSE;
-
-        return;
-    }
-    if (count_btb(btb_head) < 1)
-    {
-        // continue;
-    }
-    else
-    {
-        btb_buffer *cursor = btb_head;
-        while (cursor != NULL)
-        {
-            if (cursor->data.active_flag)
-            {
-                if (cursor->data.taken)
-                {
-                    cpu->pc = cursor->data.computed_address;
-                    dispose_btb(btb_head);
-                    btb_head = NULL;
-                    break;
-                }
-                btb_head = remove_any_btb(btb_head, cursor);
-            }
-            cursor = cursor->next;
-        }
-    }
-
-    /* Store current PC in fetch latch */
-    cpu->fetch.pc = cpu->pc;
-
-    current_ins = &cpu->code_memory[get_code_memory_index_from_pc(cpu->pc)];
-    strcpy(cpu->fetch.opcode_str, current_ins->opcode_str);
-    cpu->fetch.opcode = current_ins->opcode;
-    cpu->fetch.rd = current_ins->rd;
-    cpu->fetch.rs1 = current_ins->rs1;
-    cpu->fetch.rs2 = current_ins->rs2;
-    cpu->fetch.imm = current_ins->imm;
-    if (cpu->fetch.opcode == 0)
-    {
-        strcpy(cpu->fetch.opcode_str, " ");
-        cpu->fetch.pc = '\0';
-    }
-
-    if (cpu->fetch.has_insn && (!cpu->fetch.stalled))
-    {
-        /* Update PC for next instruction */
-        cpu->pc += 4;
-
-        /* Copy data from fetch latch to decode latch*/
-        if (cpu->decode.stalled == 0)
-        {
-            cpu->decode = cpu->fetch;
-        }
-    }
-
-    if (ENABLE_DEBUG_MESSAGES && cpu->fetch.opcode != OPCODE_NULL)
-    {
-        print_stage_content_for_fetch("Fetch", &cpu->fetch);
-    }
-}
-
-/*
- * Decode Stage of APEX Pipeline
- *
- * Note: You are free to edit this function according to your implementation
- */
-static void
-APEX_decode(APEX_CPU *cpu)
-{
-    printf("In decode %d\t\n", cpu->decode.pc);
-    // if (cpu->branch_taken_stage == 1)
-    // {
-    //     hasher *temp = search_physical_register2(rfprf, cpu->dispatch.rd);
-    //     if (temp != NULL)
-    //     {
-    //         printf("In if condition %d\t%d\t%d\t\n", cpu->decode.pc, temp->data.rf_code, temp->data.prf_code);
-    //         rfprf = remove_any_hasher(rfprf, temp);
-    //         phead = prependIntoPreg(phead, temp->data.prf_code);
-    //         cpu->pregs_valid[cpu->dispatch.pd] = 1;
-    //         cpu->branch_taken_stage = 0;
-    //     }
-    // }
-
-    if (cpu->decode.flush == 1)
-    {
-        strcpy(cpu->decode.opcode_str, " ");
-        cpu->decode.opcode = 0x0;
-        cpu->decode.pc = 0000;
-        cpu->decode.flush = 0;
-    }
-    if (cpu->decode.stalled == 1)
-    {
-        cpu->dispatch.flush = 1;
-    }
-    else
-    {
-        cpu->dispatch.flush = 0;
-    }
-
-    if (cpu->decode.has_insn && (!cpu->decode.stalled))
-    {
-        switch (cpu->decode.opcode)
-        {
-
-        case OPCODE_STR:
-        {
-            cpu->decode.ps1 = search_physical_register(rfprf, cpu->decode.rs1);
-            cpu->decode.ps2 = search_physical_register(rfprf, cpu->decode.rs2);
-            cpu->decode.pd = search_physical_register(rfprf, cpu->decode.rd);
-            cpu->mreadybit[cpu->decode.pc] = 0;
-            cpu->lsInstComplete[cpu->decode.pc] = 0;
-            break;
-        }
-
-        case OPCODE_STORE:
-        {
-            cpu->decode.ps1 = search_physical_register(rfprf, cpu->decode.rs1);
-            cpu->decode.ps2 = search_physical_register(rfprf, cpu->decode.rs2);
-            cpu->mreadybit[cpu->decode.pc] = 0;
-            cpu->lsInstComplete[cpu->decode.pc] = 0;
-            break;
-        }
-
-        case OPCODE_LDR:
-        {
-
-            cpu->decode.ps1 = search_physical_register(rfprf, cpu->decode.rs1);
-            cpu->decode.ps2 = search_physical_register(rfprf, cpu->decode.rs2);
-            cpu->decode.pd = phead->data;
-            cpu->pregs_valid[cpu->decode.pd] = 0;
-            renametable.rf_code = cpu->decode.rd;
-            renametable.prf_code = cpu->decode.pd;
-            rfprf = prepend_hasher(rfprf, renametable);
-            phead = dequeueReg(phead);
-            cpu->mreadybit[cpu->decode.pc] = 0;
-
-            break;
-        }
-
-        case OPCODE_LOAD:
-        {
-
-            cpu->decode.ps1 = search_physical_register(rfprf, cpu->decode.rs1);
-            cpu->decode.pd = phead->data;
-            cpu->pregs_valid[cpu->decode.pd] = 0;
-            renametable.rf_code = cpu->decode.rd;
-            renametable.prf_code = cpu->decode.pd;
-            rfprf = prepend_hasher(rfprf, renametable);
-            phead = dequeueReg(phead);
-            cpu->mreadybit[cpu->decode.pc] = 0;
-
-            break;
-        }
-
-        case OPCODE_CMP:
-        {
-            cpu->decode.ps1 = search_physical_register(rfprf, cpu->decode.rs1);
-            cpu->decode.ps2 = search_physical_register(rfprf, cpu->decode.rs2);
-            cpu->decode.pd = phead->data;
-            cpu->pregs_valid[cpu->decode.pd] = 0;
-            renametable.rf_code = cpu->decode.rd;
-            renametable.prf_code = cpu->decode.pd;
-            rfprf = prepend_hasher(rfprf, renametable);
-            phead = dequeueReg(phead);
-            break;
-        }
-
-        case OPCODE_ADD:
-        case OPCODE_SUB:
-        case OPCODE_MUL:
-        case OPCODE_DIV:
-        case OPCODE_AND:
-        case OPCODE_OR:
-        case OPCODE_XOR:
-        {
-
-            cpu->decode.ps1 = search_physical_register(rfprf, cpu->decode.rs1);
-            cpu->decode.ps2 = search_physical_register(rfprf, cpu->decode.rs2);
-            cpu->decode.pd = phead->data;
-            cpu->pregs_valid[cpu->decode.pd] = 0;
-            renametable.rf_code = cpu->decode.rd;
-            renametable.prf_code = cpu->decode.pd;
-            rfprf = prepend_hasher(rfprf, renametable);
-            phead = dequeueReg(phead);
-
-            break;
-        }
-
-        case OPCODE_ADDL:
-        case OPCODE_SUBL:
-        {
-            cpu->decode.ps1 = search_physical_register(rfprf, cpu->decode.rs1);
-            cpu->decode.pd = phead->data;
-            cpu->pregs_valid[cpu->decode.pd] = 0;
-            renametable.rf_code = cpu->decode.rd;
-            renametable.prf_code = cpu->decode.pd;
-            rfprf = prepend_hasher(rfprf, renametable);
-            phead = dequeueReg(phead);
-            break;
-        }
-
-        case OPCODE_MOVC:
-        {
-
-            cpu->decode.pd = phead->data;
-            renametable.rf_code = cpu->decode.rd;
-            renametable.prf_code = cpu->decode.pd;
-            cpu->pregs_valid[cpu->decode.pd] = 0;
-            rfprf = prepend_hasher(rfprf, renametable);
-            phead = dequeueReg(phead);
-            break;
-        }
-
-        case OPCODE_BNZ:
-        case OPCODE_BZ:
-        {
-            btb_buffer *new_node = (btb_buffer *)malloc(sizeof(btb_buffer));
-            new_node->data.active_flag = 0;
-            new_node->data.inst_pc = cpu->decode.pc;
-            new_node->data.computed_address = 0;
-            new_node->data.taken = 0;
-            btb_head = enqueue_btb(btb_head, new_node->data);
-            cpu->branchreadybit[cpu->decode.pc] = 0;
-            break;
-        }
-
-        case OPCODE_JUMP:
-        {
-            cpu->jump_inst = 1;
-            cpu->fetch.flush = 1;
-            break;
-        }
-
-        case OPCODE_HALT:
-        {
-
-            break;
-        }
-        default:
-        {
-            break;
-        }
-        }
-    }
-
-    /* Copy data from decode latch to intfu latch*/
-    if (cpu->decode.stalled == 0)
-    {
-        cpu->dispatch = cpu->decode;
-        cpu->decode.has_insn = FALSE;
-    }
-    else
-    {
-        cpu->decode.stalled = 1;
-        cpu->dispatch.flush = 1;
-    }
-
-    if (ENABLE_DEBUG_MESSAGES && cpu->decode.opcode != OPCODE_NULL)
-    {
-        print_stage_content("Decode/RF", &cpu->decode);
-    }
-}
-
-static void
-APEX_dispatch(APEX_CPU *cpu)
-{
-
-    if (cpu->branch_taken_stage == 1 && cpu->dispatch.opcode != 0 && (cpu->dispatch.opcode != 9 && cpu->dispatch.opcode != 16))
-    {
-        hasher *temp = search_physical_register2(rfprf, cpu->dispatch.rd);
-
-        if (temp != NULL)
-        {
-            int data = temp->data.prf_code;
-            rfprf = remove_any_hasher(rfprf, temp);
-            phead = enqueueReg(phead, data);
-            cpu->pregs_valid[cpu->dispatch.pd] = 1;
-            cpu->branch_taken_stage = 0;
-        }
-    }
-    else
-    {
-        cpu->branch_taken_stage = 0;
-    }
-    if (cpu->dispatch.flush == 1)
-    {
-        strcpy(cpu->dispatch.opcode_str, " ");
-        cpu->dispatch.opcode = 0x0;
-        cpu->dispatch.pc = 0000;
-        cpu->dispatch.flush = 0;
-    }
-    if (cpu->dispatch.stalled == 1)
-    {
-        cpu->issueq.flush = 1;
-        cpu->rob.flush = 1;
-        cpu->decode.stalled = 1;
-        cpu->lsq.flush = 1;
-    }
-    else
-    {
-        cpu->issueq.flush = 0;
-        cpu->rob.flush = 0;
-        cpu->decode.stalled = 0;
-        cpu->lsq.flush = 0;
-    }
-
-    if (cpu->dispatch.stalled == 0)
-    {
-        switch (cpu->dispatch.opcode)
-        {
-        case OPCODE_LDR:
-        case OPCODE_LOAD:
-        {
-            if (count(iqhead) < 8 && count(robhead) < 16 && count(lsqhead) < 4)
-            {
-                cpu->issueq = cpu->dispatch;
-                cpu->rob = cpu->dispatch;
-                cpu->lsq = cpu->dispatch;
-            }
-            else
-            {
-                cpu->dispatch.stalled = 1;
-            }
-            break;
-        }
-
-        case OPCODE_STR:
-        case OPCODE_STORE:
-        {
-            if (count(iqhead) < 8 && count(robhead) < 16 && count(lsqhead) < 4)
-            {
-                cpu->issueq = cpu->dispatch;
-                cpu->rob = cpu->dispatch;
-                // cpu->rob.flush = 1;
-                cpu->lsq = cpu->dispatch;
-            }
-            else
-            {
-                cpu->dispatch.stalled = 1;
-            }
-            break;
-        }
-        case OPCODE_JUMP:
-        {
-            if (count(iqhead) < 8 && count(robhead) < 16)
-            {
-                cpu->issueq = cpu->dispatch;
-                cpu->rob = cpu->dispatch;
-                cpu->lsq.flush = 1;
-                cpu->decode.flush = 1;
-            }
-            else
-            {
-                cpu->dispatch.stalled = 1;
-            }
-            break;
-        }
-
-        default:
-        {
-            if (count(iqhead) < 8 && count(robhead) < 16)
-            {
-                cpu->issueq = cpu->dispatch;
-                cpu->rob = cpu->dispatch;
-                cpu->lsq.flush = 1;
-            }
-            else
-            {
-                cpu->dispatch.stalled = 1;
-            }
-            break;
-        }
-        }
-
-        cpu->dispatch.has_insn = FALSE;
-    }
-    if (ENABLE_DEBUG_MESSAGES && cpu->dispatch.opcode != OPCODE_NULL)
-    {
-        print_stage_content("Dispatch/RF", &cpu->dispatch);
-    }
-}
-
-static void
-APEX_lsq(APEX_CPU *cpu)
-{
-    if (cpu->branch_taken_stage == 1 && cpu->lsq.opcode != 0xc)
-    {
-        if (cpu->lsq.opcode != 0x0 && (cpu->lsq.opcode == OPCODE_LDR || cpu->lsq.opcode == OPCODE_LOAD))
-        {
-
-            hasher *temp = search_physical_register2(rfprf, cpu->lsq.rd);
-            if (temp != NULL)
-            {
-
-                int data = temp->data.prf_code;
-                rfprf = remove_any_hasher(rfprf, temp);
-                phead = enqueueReg(phead, data);
-                cpu->pregs_valid[cpu->lsq.pd] = 1;
-            }
-        }
-    }
-
-    if (cpu->lsq.flush == 1)
-    {
-
-        strcpy(cpu->lsq.opcode_str, " ");
-        cpu->lsq.opcode = 0x0;
-        cpu->lsq.pc = 0000;
-        cpu->lsq.flush = 0;
-    }
-
-    if (cpu->lsq.opcode != 0x0 && cpu->lsq.has_insn == TRUE)
-    {
-        lsqhead = enqueue(lsqhead, cpu->lsq);
-    }
-
-    node *cursor = lsqhead;
-    while (cursor != NULL)
-    {
-        if (ENABLE_DEBUG_MESSAGES && cursor->data.opcode != OPCODE_NULL)
-        {
-            print_stage_content("LSQ", &cursor->data);
-        }
-        cursor = cursor->next;
-    }
-
-    if (count(lsqhead) != 0)
-    {
-
-        node *cursor = lsqhead;
-
-        switch (cursor->data.opcode)
-        {
-
-        case OPCODE_STR:
-        {
-
-            if (cpu->pregs_valid[cursor->data.pd] && cpu->mreadybit[cursor->data.pc])
-            {
-                cursor->data.result_buffer = cpu->intfu.result_buffer;
-                cpu->mem_valid[cpu->renameTableValues[cursor->data.ps1] + cpu->renameTableValues[cursor->data.ps2]] = 0;
-                cpu->dcache = cursor->data;
-                lsqhead = remove_any(lsqhead, cursor);
-            }
-            else
-            {
-                cpu->dcache.flush = 1;
-            }
-            break;
-        }
-
-        case OPCODE_STORE:
-        {
-            if (cpu->pregs_valid[cursor->data.ps1] && cpu->mreadybit[cursor->data.pc])
-            {
-                cursor->data.result_buffer = cpu->intfu.result_buffer;
-                cpu->mem_valid[cpu->renameTableValues[cursor->data.ps2] + cpu->renameTableValues[cursor->data.imm]] = 0;
-                cpu->dcache = cursor->data;
-                lsqhead = remove_any(lsqhead, cursor);
-            }
-            else
-            {
-                cpu->dcache.flush = 1;
-            }
-            break;
-        }
-
-        case OPCODE_LDR:
-        {
-            if (cpu->mreadybit[cursor->data.pc])
-            {
-                cursor->data.result_buffer = cpu->intfu.result_buffer;
-                cpu->pregs_valid[cursor->data.pd] = 0;
-                cpu->dcache = cursor->data;
-                lsqhead = remove_any(lsqhead, cursor);
-            }
-            else
-            {
-                cpu->dcache.flush = 1;
-            }
-            break;
-        }
-
-        case OPCODE_LOAD:
-        {
-            if (cpu->mreadybit[cursor->data.pc])
-            {
-                cursor->data.result_buffer = cpu->intfu.result_buffer;
-                cpu->pregs_valid[cursor->data.pd] = 0;
-                cpu->dcache = cursor->data;
-                lsqhead = remove_any(lsqhead, cursor);
-            }
-            else
-            {
-                cpu->dcache.flush = 1;
-            }
-            break;
-        }
-
-        default:
-        {
-            lsqhead = remove_any(lsqhead, cursor);
-            break;
-        }
-        }
-    }
-    cpu->lsq.has_insn = FALSE;
-}
-
-static void
-APEX_issueq(APEX_CPU *cpu)
-{
-
-    if (cpu->branch_taken_stage == 1 && cpu->issueq.opcode != 0xc)
-    {
-        if (cpu->issueq.opcode != 0x0)
-        {
-
-            hasher *temp = search_physical_register2(rfprf, cpu->issueq.rd);
-            if (temp != NULL)
-            {
-                int data = temp->data.prf_code;
-                rfprf = remove_any_hasher(rfprf, temp);
-                phead = enqueueReg(phead, data);
-                cpu->pregs_valid[cpu->issueq.pd] = 1;
-            }
-        }
-    }
-    if (cpu->issueq.flush == 1)
-    {
-        strcpy(cpu->issueq.opcode_str, " ");
-        cpu->issueq.opcode = 0x0;
-        cpu->issueq.pc = 0000;
-        cpu->issueq.flush = 0;
-    }
-
-    if (cpu->issueq.opcode != 0x0 && cpu->issueq.has_insn == TRUE)
-    {
-        iqhead = enqueue(iqhead, cpu->issueq);
-    }
-    if (cpu->issueq.opcode == 0xc)
-    {
-        cpu->dispatch.flush = 1;
-        cpu->decode.flush = 1;
-    }
-
-    node *cursor = iqhead;
-    while (cursor != NULL)
-    {
-        if (ENABLE_DEBUG_MESSAGES && cursor->data.opcode != OPCODE_NULL)
-        {
-            print_stage_content("Issueq", &cursor->data);
-        }
-        cursor = cursor->next;
-    }
-    int intfuBusyFlag = 0;
-    int mulfuBusyFlag = 0;
-    int logicalBusyFlag = 0;
-
-    if (count(iqhead) != 0)
-    {
-
-        node *cursor = iqhead;
-
-        while (cursor != NULL)
-        {
-            switch (cursor->data.opcode)
-            {
-
-            case OPCODE_STR:
-            {
-
-                if (cpu->pregs_valid[cursor->data.ps1] && cpu->pregs_valid[cursor->data.ps2] && cpu->pregs_valid[cursor->data.pd] && intfuBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cursor->data.ps2_value = cpu->renameTableValues[cursor->data.ps2];
-                    cpu->mem_valid[cursor->data.ps1_value + cursor->data.ps2_value] = 0;
-                    cpu->mreadybit[cursor->data.pc] = 0;
-                    cpu->intfu = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    intfuBusyFlag = 1;
-                }
-                break;
-            }
-
-            case OPCODE_STORE:
-            {
-                if (cpu->pregs_valid[cursor->data.ps2] && intfuBusyFlag != 1)
-                {
-                    cursor->data.ps2_value = cpu->renameTableValues[cursor->data.ps2];
-                    cpu->mem_valid[cursor->data.ps2_value + cursor->data.imm] = 0;
-                    cpu->mreadybit[cursor->data.pc] = 0;
-                    cpu->intfu = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    intfuBusyFlag = 1;
-                }
-                break;
-            }
-
-            case OPCODE_LDR:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1] && cpu->pregs_valid[cursor->data.ps2] && intfuBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cursor->data.ps2_value = cpu->renameTableValues[cursor->data.ps2];
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    cpu->mreadybit[cursor->data.pc] = 0;
-                    cpu->intfu = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    intfuBusyFlag = 1;
-                }
-                break;
-            }
-
-            case OPCODE_LOAD:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1] && intfuBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    cpu->mreadybit[cursor->data.pc] = 0;
-                    cpu->intfu = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    intfuBusyFlag = 1;
-                }
-                break;
-            }
-
-            case OPCODE_ADD:
-            case OPCODE_SUB:
-            case OPCODE_DIV:
-            case OPCODE_CMP:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1] && cpu->pregs_valid[cursor->data.ps2] && intfuBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cursor->data.ps2_value = cpu->renameTableValues[cursor->data.ps2];
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    cpu->intfu = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-
-                    intfuBusyFlag = 1;
-                }
-
-                break;
-            }
-            case OPCODE_AND:
-            case OPCODE_OR:
-            case OPCODE_XOR:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1] && cpu->pregs_valid[cursor->data.ps2] && logicalBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cursor->data.ps2_value = cpu->renameTableValues[cursor->data.ps2];
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    cpu->logicalfu = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    logicalBusyFlag = 1;
-                }
-
-                break;
-            }
-
-            case OPCODE_JUMP:
-            {
-                if (intfuBusyFlag != 1)
-                {
-
-                    cpu->intfu = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    intfuBusyFlag = 1;
-                }
-
-                break;
-            }
-
-            case OPCODE_BNZ:
-            case OPCODE_BZ:
-            {
-                if (intfuBusyFlag != 1)
-                {
-                    cpu->intfu = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    intfuBusyFlag = 1;
-                }
-                break;
-            }
-
-            case OPCODE_MUL:
-            {
-
-                if (cpu->pregs_valid[cursor->data.ps1] && cpu->pregs_valid[cursor->data.ps2] && mulfuBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cursor->data.ps2_value = cpu->renameTableValues[cursor->data.ps2];
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    cpu->mulfu1 = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    mulfuBusyFlag = 1;
-                }
-
-                break;
-            }
-            case OPCODE_ADDL:
-            case OPCODE_SUBL:
-            {
-                if (cpu->pregs_valid[cursor->data.ps1] && intfuBusyFlag != 1)
-                {
-                    cursor->data.ps1_value = cpu->renameTableValues[cursor->data.ps1];
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    cpu->intfu = cursor->data;
-                    iqhead = remove_any(iqhead, cursor);
-                    intfuBusyFlag = 1;
-                }
-
-                break;
-            }
-
-            case OPCODE_MOVC:
-            {
-                if (intfuBusyFlag != 1)
-                {
-                    cpu->intfu = cursor->data;
-                    cpu->pregs_valid[cursor->data.pd] = 0;
-                    iqhead = remove_any(iqhead, cursor);
-                    intfuBusyFlag = 1;
-                }
-                break;
-            }
-
-            default:
-            {
-                iqhead = remove_any(iqhead, cursor);
-                break;
-            }
-            }
-            cursor = cursor->next;
-        }
-    }
-    cpu->decode.stalled = 0;
-    cpu->issueq.has_insn = FALSE;
-}
-
-static void
-APEX_intfu(APEX_CPU *cpu)
-{
-
-    if (cpu->intfu.flush == 1)
-    {
-        strcpy(cpu->intfu.opcode_str, " ");
-        cpu->intfu.opcode = 0x0;
-        cpu->intfu.pc = 0000;
-    }
-    if (cpu->intfu.has_insn)
-    {
-        switch (cpu->intfu.opcode)
-        {
-        case OPCODE_CMP:
-        {
-
-            cpu->intfu.result_buffer = cpu->intfu.ps1_value - cpu->intfu.ps2_value;
-            cpu->cmpvalue[cpu->intfu.pc] = cpu->intfu.result_buffer;
-            cpu->cmp_completed = 1;
-            cpu->renameTableValues[cpu->intfu.pd] = 0;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
-            if (cpu->intfu.result_buffer == 0)
-            {
-                cpu->zero_flag = 0;
-            }
-            else
-            {
-                cpu->zero_flag = cpu->intfu.result_buffer;
-            }
-            break;
-        }
-        case OPCODE_JUMP:
-        {
-            cpu->intfu.result_buffer = cpu->intfu.pc + cpu->intfu.imm;
-            cpu->branch_taken = 1;
-            cpu->jumpval[cpu->intfu.pc] = cpu->intfu.result_buffer;
-            cpu->jump_inst = 0;
-            break;
-        }
-        case OPCODE_STR:
-        {
-            cpu->intfu.result_buffer = cpu->intfu.ps1_value + cpu->intfu.ps2_value;
-            cpu->mreadybit[cpu->intfu.pc] = 1;
-            break;
-        }
-        case OPCODE_STORE:
-        {
-            cpu->intfu.result_buffer = cpu->intfu.ps2_value + cpu->intfu.imm;
-            cpu->mreadybit[cpu->intfu.pc] = 1;
-            break;
-        }
-        case OPCODE_LDR:
-        {
-            cpu->intfu.result_buffer = cpu->intfu.ps1_value + cpu->intfu.ps2_value;
-            cpu->mreadybit[cpu->intfu.pc] = 1;
-            break;
-        }
-        case OPCODE_LOAD:
-        {
-            cpu->intfu.result_buffer = cpu->intfu.ps1_value + cpu->intfu.imm;
-            cpu->mreadybit[cpu->intfu.pc] = 1;
-            break;
-        }
-
-        case OPCODE_ADD:
-        {
-
-            cpu->intfu.result_buffer = cpu->intfu.ps1_value + cpu->intfu.ps2_value;
-            cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
-            break;
-        }
-        case OPCODE_SUB:
-        {
-            cpu->intfu.result_buffer = cpu->intfu.ps1_value - cpu->intfu.ps2_value;
-            cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
-
-            break;
-        }
-
-        case OPCODE_DIV:
-        {
-            cpu->intfu.result_buffer = cpu->intfu.ps1_value / cpu->intfu.ps2_value;
-            cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
-            break;
-        }
-        case OPCODE_ADDL:
-        {
-            cpu->intfu.result_buffer = (cpu->intfu.ps1_value) + cpu->intfu.imm;
-            cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
-            break;
-        }
-        case OPCODE_SUBL:
-        {
-            cpu->intfu.result_buffer = cpu->intfu.ps1_value - cpu->intfu.imm;
-            cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
-            break;
-        }
-
-        case OPCODE_MOVC:
-        {
-
-            cpu->intfu.result_buffer = cpu->intfu.imm;
-            cpu->renameTableValues[cpu->intfu.pd] = cpu->intfu.result_buffer;
-            cpu->pregs_valid[cpu->intfu.pd] = 1;
-            break;
-        }
-
-        case OPCODE_BZ:
-        {
-            cpu->intfu.result_buffer = cpu->intfu.pc + cpu->intfu.imm;
-            cpu->branchreadybit[cpu->intfu.pc] = 1;
-
-            if (cpu->zero_flag == 0)
-            {
-                cpu->branch_taken = 1;
-
-                cpu->rob.flush = 1;
-                cpu->issueq.flush = 1;
-                cpu->lsq.flush = 1;
-                cpu->intfu.flush = 1;
-                cpu->mulfu1.flush = 1;
-                cpu->mulfu2.flush = 1;
-                cpu->mulfu3.flush = 1;
-                cpu->mulfu4.flush = 1;
-                cpu->dcache.flush = 1;
-                cpu->dispatch.flush = 1;
-                cpu->decode.flush = 1;
-                cpu->branch_taken_stage = 1;
-            }
-            else
-            {
-                cpu->branch_taken = 0;
-            }
-            btb_head = insert_address_btb(btb_head, cpu->intfu, cpu->branch_taken);
-            break;
-        }
-        case OPCODE_BNZ:
-        {
-            cpu->intfu.result_buffer = cpu->intfu.pc + cpu->intfu.imm;
-            cpu->branchreadybit[cpu->intfu.pc] = 1;
-            if (cpu->zero_flag > 0 || cpu->zero_flag < 0)
-            {
-                cpu->branch_taken = 1;
-
-                cpu->rob.flush = 1;
-                cpu->issueq.flush = 1;
-                cpu->lsq.flush = 1;
-                cpu->intfu.flush = 1;
-                cpu->mulfu1.flush = 1;
-                cpu->mulfu2.flush = 1;
-                cpu->mulfu3.flush = 1;
-                cpu->mulfu4.flush = 1;
-                cpu->dcache.flush = 1;
-                cpu->dispatch.flush = 1;
-                cpu->decode.flush = 1;
-                cpu->branch_taken_stage = 1;
-            }
-            else
-            {
-                cpu->branch_taken = 0;
-            }
-            btb_head = insert_address_btb(btb_head, cpu->intfu, cpu->branch_taken);
-            break;
-        }
-
-        case OPCODE_HALT:
-        {
-            cpu->decode.flush = 1;
-            cpu->fetch.flush = 1;
-            break;
-        }
-        }
-
-        cpu->intfu.has_insn = FALSE;
-        if (ENABLE_DEBUG_MESSAGES && cpu->intfu.opcode != OPCODE_NULL)
-        {
-            print_stage_content("intfu", &cpu->intfu);
-        }
-    }
-}
-
-static void
-APEX_dcache(APEX_CPU *cpu)
-{
-    if (cpu->dcache.flush == 1)
-    {
-        strcpy(cpu->dcache.opcode_str, " ");
-        cpu->dcache.opcode = 0x0;
-        cpu->dcache.pc = 0000;
-    }
-    if (cpu->dcache.has_insn)
-    {
-        switch (cpu->dcache.opcode)
-        {
-        case OPCODE_STR:
-        {
-            cpu->data_memory[cpu->dcache.result_buffer] = cpu->renameTableValues[cpu->dcache.pd];
-            cpu->lsInstComplete[cpu->decode.pc] = 1;
-            break;
-        }
-        case OPCODE_STORE:
-        {
-            cpu->data_memory[cpu->dcache.result_buffer] = cpu->renameTableValues[cpu->dcache.ps1];
-            cpu->lsInstComplete[cpu->decode.pc] = 1;
-            break;
-        }
-        case OPCODE_LDR:
-        case OPCODE_LOAD:
-        {
-
-            cpu->renameTableValues[cpu->dcache.pd] = cpu->data_memory[cpu->dcache.result_buffer];
-            cpu->pregs_valid[cpu->dcache.pd] = 1;
-            break;
-        }
-        }
-
-        cpu->dcache.has_insn = FALSE;
-        if (ENABLE_DEBUG_MESSAGES && cpu->dcache.opcode != OPCODE_NULL)
-        {
-            print_stage_content("dcache", &cpu->dcache);
-        }
-    }
-}
-
-static void
-APEX_logicalfu(APEX_CPU *cpu)
-{
-    if (cpu->logicalfu.flush == 1)
-    {
-        strcpy(cpu->logicalfu.opcode_str, " ");
-        cpu->logicalfu.opcode = 0x0;
-        cpu->logicalfu.pc = 0000;
-    }
-    if (cpu->logicalfu.has_insn)
-    {
-        switch (cpu->logicalfu.opcode)
-        {
-        case OPCODE_AND:
-        {
-            cpu->logicalfu.result_buffer = (cpu->logicalfu.ps1_value) & (cpu->logicalfu.ps2_value);
-            cpu->renameTableValues[cpu->logicalfu.pd] = cpu->logicalfu.result_buffer;
-            cpu->pregs_valid[cpu->logicalfu.pd] = 1;
-            break;
-        }
-        case OPCODE_OR:
-        {
-            cpu->logicalfu.result_buffer = cpu->logicalfu.ps1_value | cpu->logicalfu.ps2_value;
-            cpu->renameTableValues[cpu->logicalfu.pd] = cpu->logicalfu.result_buffer;
-            cpu->pregs_valid[cpu->logicalfu.pd] = 1;
-            break;
-        }
-        case OPCODE_XOR:
-        {
-            cpu->logicalfu.result_buffer = (cpu->logicalfu.ps1_value) ^ (cpu->logicalfu.ps2_value);
-            cpu->renameTableValues[cpu->logicalfu.pd] = cpu->logicalfu.result_buffer;
-            cpu->pregs_valid[cpu->logicalfu.pd] = 1;
-            break;
-        }
-        }
-
-        cpu->logicalfu.has_insn = FALSE;
-        if (ENABLE_DEBUG_MESSAGES && cpu->logicalfu.opcode != OPCODE_NULL)
-        {
-            print_stage_content("logicalfu", &cpu->logicalfu);
-        }
-    }
-}
-
-static void
-APEX_mulfu1(APEX_CPU *cpu)
-{
-    if (cpu->mulfu1.flush == 1)
-    {
-        strcpy(cpu->mulfu1.opcode_str, " ");
-        cpu->mulfu1.opcode = 0x0;
-        cpu->mulfu1.pc = 0000;
-    }
-
-    if (cpu->mulfu1.has_insn)
-    {
-
-        switch (cpu->mulfu1.opcode)
-        {
-        case OPCODE_MUL:
-        {
-            cpu->mulfu1.result_buffer = cpu->mulfu1.ps1_value * cpu->mulfu1.ps2_value;
-
-            break;
-        }
-        }
-
-        cpu->mulfu2 = cpu->mulfu1;
-        cpu->mulfu1.has_insn = FALSE;
-        if (ENABLE_DEBUG_MESSAGES && cpu->mulfu1.opcode != OPCODE_NULL)
-        {
-            print_stage_content("mulfu1", &cpu->mulfu1);
-        }
-    }
-}
-
-static void
-APEX_mulfu2(APEX_CPU *cpu)
-{
-    if (cpu->mulfu2.has_insn)
-    {
-
-        cpu->mulfu3 = cpu->mulfu2;
-        cpu->mulfu2.has_insn = FALSE;
-        if (ENABLE_DEBUG_MESSAGES && cpu->mulfu2.opcode != OPCODE_NULL)
-        {
-            print_stage_content("mulfu2", &cpu->mulfu2);
-        }
-    }
-}
-
-static void
-APEX_mulfu3(APEX_CPU *cpu)
-{
-    if (cpu->mulfu3.has_insn)
-    {
-
-        cpu->mulfu4 = cpu->mulfu3;
-        cpu->mulfu3.has_insn = FALSE;
-        if (ENABLE_DEBUG_MESSAGES && cpu->mulfu3.opcode != OPCODE_NULL)
-        {
-            print_stage_content("mulfu3", &cpu->mulfu3);
-        }
-    }
-}
-
-static void
-APEX_mulfu4(APEX_CPU *cpu)
-{
-    if (cpu->mulfu4.has_insn)
-    {
-
-        switch (cpu->mulfu4.opcode)
-        {
-        case OPCODE_MUL:
-        {
-
-            cpu->renameTableValues[cpu->mulfu4.pd] = cpu->mulfu4.result_buffer;
-            cpu->pregs_valid[cpu->mulfu4.pd] = 1;
-            break;
-        }
-        }
-
-        cpu->mulfu4.has_insn = FALSE;
-
-        if (ENABLE_DEBUG_MESSAGES && cpu->mulfu4.opcode != OPCODE_NULL)
-        {
-            print_stage_content("mulfu4", &cpu->mulfu4);
-        }
-    }
-}
-
-void validaterob(node *head, APEX_CPU *cpu)
-{
-    node *cursor = head;
-    while (cursor != NULL)
-    {
-        switch (cursor->data.opcode)
-        {
-
-        case OPCODE_JUMP:
-        case OPCODE_BZ:
-        case OPCODE_BNZ:
-        case OPCODE_HALT:
-        case OPCODE_NOP:
-        case OPCODE_NULL:
-        {
-            break;
-        }
-        case OPCODE_STORE:
-        {
-            cpu->mem_valid[cursor->data.imm + cpu->renameTableValues[cursor->data.ps2]] = 1;
-            cpu->mreadybit[cursor->data.pc] = 1;
-            cpu->lsInstComplete[cursor->data.opcode] = 1;
-            break;
-        }
-        case OPCODE_STR:
-        {
-            cpu->mem_valid[cpu->renameTableValues[cursor->data.ps1] + cpu->renameTableValues[cursor->data.ps2]] = 1;
-            cpu->mreadybit[cursor->data.pc] = 1;
-            cpu->lsInstComplete[cursor->data.pc] = 1;
-            break;
-        }
-
-        default:
-        {
-            hasher *temp = search_physical_register2(rfprf, cursor->data.rd);
-            if (temp != NULL)
-            {
-                int data = temp->data.prf_code;
-                rfprf = remove_any_hasher(rfprf, temp);
-                phead = enqueueReg(phead, data);
-                cpu->pregs_valid[cursor->data.pd] = 1;
-            }
-        }
-        }
-
-        cursor = cursor->next;
-    }
-}
-
-static int
-APEX_rob(APEX_CPU *cpu)
-{
-    if (cpu->rob.flush == 1)
-    {
-        strcpy(cpu->rob.opcode_str, " ");
-        cpu->rob.opcode = 0x0;
-        cpu->rob.pc = 0000;
-        cpu->rob.flush = 0;
-    }
-
-    if (count(robhead) != 0)
-    {
-        if (robhead->data.opcode == OPCODE_HALT)
-        {
-            validaterob(robhead, cpu);
-            cpu->pregs_valid[cpu->issueq.pd] = 1;
-            if (ENABLE_DEBUG_MESSAGES && robhead->data.opcode != OPCODE_NULL)
-            {
-                print_stage_content("ROB ", &robhead->data);
-            }
-            return TRUE;
-        }
-    }
-    if (cpu->rob.opcode != 0x0 && cpu->rob.has_insn == TRUE)
-    {
-        robhead = enqueue(robhead, cpu->rob);
-    }
-    node *cursor = robhead;
-    while (cursor != NULL)
-    {
-        if (ENABLE_DEBUG_MESSAGES && cursor->data.opcode != OPCODE_NULL)
-        {
-            print_stage_content("ROB ", &cursor->data);
-        }
-        cursor = cursor->next;
-    }
-
-    if (count(robhead) != 0)
-    {
-
-        switch (robhead->data.opcode)
-        {
-        case OPCODE_ADD:
-        case OPCODE_MUL:
-        case OPCODE_DIV:
-        case OPCODE_AND:
-        case OPCODE_OR:
-        case OPCODE_XOR:
-        case OPCODE_ADDL:
-        case OPCODE_LDR:
-        case OPCODE_LOAD:
-        {
-            if (cpu->pregs_valid[robhead->data.pd])
-            {
-
-                cpu->regs[robhead->data.rd] = cpu->renameTableValues[robhead->data.pd];
-                cpu->regs_valid[robhead->data.rd] = 1;
-                phead = enqueueReg(phead, robhead->data.pd);
-                robhead = dequeue(robhead);
-            }
-
-            break;
-        }
-
-        case OPCODE_SUB:
-        case OPCODE_SUBL:
-        {
-            if (cpu->pregs_valid[robhead->data.pd])
-            {
-                cpu->zero_flag = cpu->renameTableValues[robhead->data.pd];
-
-                cpu->regs[robhead->data.rd] = cpu->renameTableValues[robhead->data.pd];
-                cpu->regs_valid[robhead->data.rd] = 1;
-                phead = enqueueReg(phead, robhead->data.pd);
-                robhead = dequeue(robhead);
-            }
-
-            break;
-        }
-        case OPCODE_BZ:
-        case OPCODE_BNZ:
-        {
-            if (cpu->branchreadybit[robhead->data.pc] == 1)
-            {
-                robhead = dequeue(robhead);
-            }
-
-            break;
-        }
-        case OPCODE_JUMP:
-        {
-            if (cpu->branch_taken == 1)
-            {
-                cpu->pc = cpu->jumpval[robhead->data.pc];
-                cpu->jump_inst = 0;
-                cpu->intfu.flush = 1;
-                cpu->decode.flush = 1;
-                cpu->branch_taken = 0;
-                validaterob(robhead, cpu);
-                dispose(robhead);
-                robhead = dequeue(robhead);
-                cpu->rob.flush = 1;
-                dispose(iqhead);
-                iqhead = dequeue(iqhead);
-                cpu->issueq.flush = 1;
-                dispose(lsqhead);
-                lsqhead = dequeue(lsqhead);
-                cpu->lsq.flush = 1;
-                cpu->intfu.flush = 1;
-                cpu->mulfu1.flush = 1;
-                cpu->mulfu2.flush = 1;
-                cpu->mulfu3.flush = 1;
-                cpu->mulfu4.flush = 1;
-                cpu->dcache.flush = 1;
-                cpu->dispatch.flush = 1;
-                cpu->branchcomplete = 0;
-            }
-            break;
-        }
-
-        case OPCODE_STR:
-        {
-
-            if (cpu->lsInstComplete[robhead->data.pc])
-            {
-                robhead = dequeue(robhead);
-            }
-            break;
-        }
-
-        case OPCODE_STORE:
-        {
-
-            if (cpu->mreadybit[robhead->data.pc])
-            {
-                robhead = dequeue(robhead);
-            }
-            break;
-        }
-
-        case OPCODE_CMP:
-        {
-            if (cpu->cmp_completed == 1)
-            {
-                cpu->zero_flag = cpu->cmpvalue[robhead->data.pc];
-                cpu->regs[robhead->data.rd] = cpu->renameTableValues[robhead->data.pd];
-                cpu->regs_valid[robhead->data.rd] = 1;
-                phead = enqueueReg(phead, robhead->data.pd);
-                robhead = dequeue(robhead);
-                cpu->cmp_completed = 0;
-            }
-            break;
-        }
-
-        case OPCODE_MOVC:
-        {
-            if (cpu->pregs_valid[robhead->data.pd])
-            {
-
-                cpu->regs[robhead->data.rd] = cpu->renameTableValues[robhead->data.pd];
-                cpu->regs_valid[robhead->data.rd] = 1;
-                phead = enqueueReg(phead, robhead->data.pd);
-                robhead = dequeue(robhead);
-            }
-            break;
-        }
-        case OPCODE_HALT:
-        {
-
-            break;
-        }
-        default:
-        {
-            robhead = dequeue(robhead);
-        }
-        }
-        cpu->decode.stalled = 0;
-        cpu->insn_completed++;
-        cpu->rob.has_insn = FALSE;
-    }
-
-    /* Default */
-    return 0;
-}
-
-/*
- * This function creates and initializes APEX cpu.
- *
- * Note: You are free to edit this function according to your implementation
- */
-APEX_CPU *
-APEX_cpu_init(const char *filename)
-{
-
-    int i;
-    APEX_CPU *cpu;
-
-    if (!filename)
-    {
-        return NULL;
-    }
-
-    cpu = calloc(1, sizeof(APEX_CPU));
-
-    if (!cpu)
-    {
-        return NULL;
-    }
-
-    /* Initialize PC, Registers and all pipeline stages */
-    cpu->pc = 4000;
-    memset(cpu->regs, 0, sizeof(int) * REG_FILE_SIZE);
-    memset(cpu->renameTableValues, 0, sizeof(int) * (PREGS_FILE_SIZE + 1));
-
-    iqhead = NULL;
-    lsqhead = NULL;
-    robhead = NULL;
-    phead = NULL;
-    rfprf = NULL;
-    btb_head = NULL;
-
-    memset(cpu->data_memory, 0, sizeof(int) * DATA_MEMORY_SIZE);
-    memset(cpu->mreadybit, 0, sizeof(int) * 60000);
-    memset(cpu->cmpvalue, 0, sizeof(int) * 60000);
-    memset(cpu->branchreadybit, 0, sizeof(int) * 60000);
-    memset(cpu->jumpval, 0, sizeof(int) * 60000);
-    for (i = 0; i < 4096; i++)
-    {
-        cpu->mem_valid[i] = 1;
-    }
-    cpu->zero_flag = -9999;
-    cpu->branch_taken = 0;
-    cpu->cmp_completed = 0;
-    cpu->mulstage = 0;
-    cpu->branchcomplete = 0;
-    cpu->branch_taken_stage = 0;
-    for (i = 0; i < 16; i++)
-    {
-        cpu->regs_valid[i] = 1;
-    }
-    for (i = 0; i < 15; i++)
-    {
-        cpu->pregs_valid[i] = 1;
-        phead = enqueueReg(phead, i);
-    }
-
-    cpu->single_step = ENABLE_SINGLE_STEP;
-
-    /* Parse input file and create code memory */
-    cpu->code_memory = create_code_memory(filename, &cpu->code_memory_size);
-    if (!cpu->code_memory)
-    {
-        free(cpu);
-        return NULL;
-    }
-
-    if (ENABLE_DEBUG_MESSAGES)
-    {
-        fprintf(stderr,
-                "APEX_CPU: Initialized APEX CPU, loaded %d instructions\n",
-                cpu->code_memory_size);
-        fprintf(stderr, "APEX_CPU: PC initialized to %d\n", cpu->pc);
-        fprintf(stderr, "APEX_CPU: Printing Code Memory\n");
-        printf("%-9s %-9s %-9s %-9s %-9s\n", "opcode_str", "rd", "rs1", "rs2",
-               "imm");
-
-        for (i = 0; i < cpu->code_memory_size; ++i)
-        {
-            printf("%-9s %-9d %-9d %-9d %-9d\n", cpu->code_memory[i].opcode_str,
-                   cpu->code_memory[i].rd, cpu->code_memory[i].rs1,
-                   cpu->code_memory[i].rs2, cpu->code_memory[i].imm);
-        }
-    }
-
-    /* To start fetch stage */
-    cpu->fetch.has_insn = TRUE;
-
-    return cpu;
-}
-
-void printFile(APEX_CPU *cpu)
-{
-
-    printf("\n-----------------REGISTER FILE------------------------------------------------------- \n");
-    printf("|Ar Register|Phy. Register| Value | VALID bit\n");
-    for (int i = 0; i < 16; i++)
-    {
-        printf("|R[%d]\t|\tP[%d]\t|\t=%d\t|\t%d\n", i, search_physical_register1(rfprf, i), cpu->renameTableValues[search_physical_register(rfprf, i)], cpu->pregs_valid[search_physical_register1(rfprf, i)]);
-    }
-    printf("\n-----------------REGISTER FILE------------------------------------------------------- \n");
-
-    printf("\n-----------------DATA MEMORY-------------- \n");
-    for (int i = 0; i < 4096; i++)
-    {
-        if (cpu->data_memory[i] != 0)
-        {
-
-            printf("| MEM[%d] | Value=%d | \n", i, cpu->data_memory[i]);
-        }
-    }
-    printf("-----------------DATA MEMORY-------------- \n");
-}
-
-/*
- * APEX CPU simulation loop
- *
- * Note: You are free to edit this function according to your implementation
- */
-void APEX_cpu_run(APEX_CPU *cpu)
-{
-    char user_prompt_val;
-
-    while (TRUE)
-    {
-        if (ENABLE_DEBUG_MESSAGES)
-        {
-            printf("--------------------------------------------\n");
-            printf("Clock Cycle #: %d\n", cpu->clock);
-            printf("--------------------------------------------\n");
-        }
-
-        APEX_intfu(cpu);
-        APEX_logicalfu(cpu);
-        APEX_mulfu4(cpu);
-        APEX_mulfu3(cpu);
-        APEX_mulfu2(cpu);
-        APEX_mulfu1(cpu);
-        APEX_dcache(cpu);
-        if (APEX_rob(cpu))
-        {
-            printf("APEX_CPU: Simulation Complete, cycles = %d instructions = %d\n", cpu->clock + 1, cpu->insn_completed);
-            break;
-        }
-        APEX_lsq(cpu);
-        APEX_issueq(cpu);
-        APEX_dispatch(cpu);
-        APEX_decode(cpu);
-        APEX_fetch(cpu);
-
-        print_reg_file(cpu);
-
-        if (cpu->single_step)
-        {
-            printf("Press any key to advance CPU Clock or <q> to quit:\n");
-            scanf("%c", &user_prompt_val);
-
-            if ((user_prompt_val == 'Q') || (user_prompt_val == 'q'))
-            {
-                printf("APEX_CPU: Simulation Stopped, cycles = %d instructions = %d\n", cpu->clock, cpu->insn_completed);
-                break;
-            }
-        }
-
-        cpu->clock++;
-    }
-}
-
-void APEX_cpu_stop(APEX_CPU *cpu)
-{
-    free(cpu->code_memory);
-    free(cpu);
+/*
+ * apex_cpu.c
+ * Contains APEX cpu pipeline implementation
+ *
+ * Author:
+ * Copyright (c) 2020, Gaurav Kothari (gkothar1@binghamton.edu)
+ * State University of New York at Binghamton
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apex_cpu.h"
+#include "apex_image.h"
+#include "apex_kanata.h"
+#include "apex_stats.h"
+#include "apex_trace.h"
+// Reference : https://www.zentut.com/c-tutorial/c-linked-list/
+
+/* Converts the PC(4000 series) into array index for code memory
+ *
+ * Note: You are not supposed to edit this function
+ */
+static int
+get_code_memory_index_from_pc(const int pc)
+{
+    return (pc - 4000) / 4;
+}
+
+static void
+print_reg_file(const APEX_CPU *cpu)
+{
+    APEX_print_regs(cpu->regs, free_list_count(&cpu->preg_free_list), cpu->config.pregs);
+}
+
+static void print_btb(btb_buffer *head)
+{
+    btb_buffer *cursor = head;
+    printf("BTB Entries: \n");
+    while (cursor != NULL)
+    {
+        printf("act_flg:%d \t inst_add:%d \t computed_add: %d \t taken_flg: %d \t rob_tag: %d \n", cursor->data.active_flag, cursor->data.inst_pc, cursor->data.computed_address, cursor->data.taken, cursor->data.rob_tag);
+        cursor = cursor->next;
+    }
+}
+
+/* Instructions that are given a new physical destination register at rename */
+static int
+has_destination(int opcode)
+{
+    switch (opcode)
+    {
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_MUL:
+    case OPCODE_DIV:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_ADDL:
+    case OPCODE_SUBL:
+    case OPCODE_MOVC:
+    case OPCODE_LOAD:
+    case OPCODE_LDR:
+    case OPCODE_CMP:
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/* ROB entry of an in-flight instruction, addressed by its tag */
+static CPU_Stage *
+rob_entry(APEX_CPU *cpu, int rob_tag)
+{
+    return &cpu->reorder_buffer.entry[rob_tag];
+}
+
+/* Latch a MUL issues into: config.mul_stages latches before the end of the
+ * mulfu1-mulfu4 chain, so that it writes back that many cycles later */
+CPU_Stage *
+APEX_mul_entry(APEX_CPU *cpu)
+{
+    switch (cpu->config.mul_stages)
+    {
+    case 1:
+        return &cpu->mulfu4;
+    case 2:
+        return &cpu->mulfu3;
+    case 3:
+        return &cpu->mulfu2;
+    }
+    return &cpu->mulfu1;
+}
+
+/* TRUE if the instruction tagged rob_tag entered the ROB after the one tagged
+ * than_tag. Tags not yet in the ROB count as youngest. */
+static int
+is_younger(const APEX_CPU *cpu, int rob_tag, int than_tag)
+{
+    return queue_age(&cpu->reorder_buffer, rob_tag) > queue_age(&cpu->reorder_buffer, than_tag);
+}
+
+/* Maps stage->rd to a free physical register, remembering the old mapping */
+static void
+rename_destination(APEX_CPU *cpu, CPU_Stage *stage)
+{
+    stage->pd = free_list_alloc(&cpu->preg_free_list);
+    stage->prev_pd = cpu->rat[stage->rd];
+    cpu->pregs_valid[stage->pd] = 0;
+    cpu->rat[stage->rd] = stage->pd;
+}
+
+/* Undoes the rename of a squashed instruction if it is still the newest
+ * mapping of its destination */
+static void
+rollback_rename(APEX_CPU *cpu, const CPU_Stage *stage)
+{
+    if (!stage->has_insn || !has_destination(stage->opcode) || cpu->rat[stage->rd] != stage->pd)
+    {
+        return;
+    }
+    cpu->rat[stage->rd] = stage->prev_pd;
+    free_list_release(&cpu->preg_free_list, stage->pd);
+    cpu->pregs_valid[stage->pd] = 1;
+}
+
+/* Value of a source register renamed to preg. PREG_ARCH(cpu) means no
+ * instruction in flight writes areg, so its value is the committed one - which
+ * need not be zero once the functional interpreter has run ahead. */
+static int
+read_operand(const APEX_CPU *cpu, int preg, int areg)
+{
+    return preg == PREG_ARCH(cpu) ? cpu->regs[areg] : cpu->renameTableValues[preg];
+}
+
+/* A physical register that is about to be released: whatever in flight
+ * still names it reads the committed register instead */
+static void
+forget_preg_in_stage(CPU_Stage *stage, int preg, int arch)
+{
+    if (stage->ps1 == preg)
+    {
+        stage->ps1 = arch;
+    }
+    if (stage->ps2 == preg)
+    {
+        stage->ps2 = arch;
+    }
+    if (stage->prev_pd == preg)
+    {
+        stage->prev_pd = arch;
+    }
+    /* STR reads the register it stores through pd */
+    if (stage->opcode == OPCODE_STR && stage->pd == preg)
+    {
+        stage->pd = arch;
+    }
+}
+
+static void
+forget_preg_in_queue(inst_queue *q, int preg, int arch)
+{
+    for (int i = 0; i < count(q); ++i)
+    {
+        forget_preg_in_stage(searchAtIndex(q, i), preg, arch);
+    }
+}
+
+/* Commits the destination of the ROB head: the architectural register takes
+ * its value and the physical register is released at once, so only the
+ * instructions in flight ever hold one */
+static void
+retire_destination(APEX_CPU *cpu, const CPU_Stage *entry)
+{
+    int pd = entry->pd;
+    int arch = PREG_ARCH(cpu);
+
+    cpu->regs[entry->rd] = cpu->renameTableValues[pd];
+    cpu->regs_valid[entry->rd] = 1;
+    if (cpu->rat[entry->rd] == pd)
+    {
+        cpu->rat[entry->rd] = arch;
+    }
+    forget_preg_in_queue(&cpu->reorder_buffer, pd, arch);
+    forget_preg_in_queue(&cpu->issue_queue, pd, arch);
+    forget_preg_in_queue(&cpu->load_store_queue, pd, arch);
+    forget_preg_in_stage(&cpu->dispatch, pd, arch);
+    forget_preg_in_stage(&cpu->issueq, pd, arch);
+    forget_preg_in_stage(&cpu->rob, pd, arch);
+    forget_preg_in_stage(&cpu->lsq, pd, arch);
+    forget_preg_in_stage(&cpu->dcache, pd, arch);
+    free_list_release(&cpu->preg_free_list, pd);
+    cpu->pregs_valid[pd] = 1;
+}
+
+static void
+kill_stage(CPU_Stage *stage)
+{
+    stage->has_insn = FALSE;
+    stage->opcode = OPCODE_NULL;
+    stage->pc = 0;
+}
+
+/* Drops every queue entry younger than rob_tag */
+static void
+squash_queue(APEX_CPU *cpu, inst_queue *q, int rob_tag)
+{
+    int i = 0;
+
+    while (i < count(q))
+    {
+        if (is_younger(cpu, searchAtIndex(q, i)->rob_tag, rob_tag))
+        {
+            remove_any(q, i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+static void
+squash_fu(APEX_CPU *cpu, CPU_Stage *stage, int rob_tag)
+{
+    if (stage->has_insn && is_younger(cpu, stage->rob_tag, rob_tag))
+    {
+        kill_stage(stage);
+    }
+}
+
+/* Drops the BTB entries of the branches that are not among the first keep
+ * instructions of the ROB, including those still in decode or dispatch */
+static void
+squash_btb(APEX_CPU *cpu, int keep)
+{
+    btb_buffer *cursor = cpu->btb_head;
+
+    while (cursor != NULL)
+    {
+        btb_buffer *next = cursor->next;
+
+        if (cursor->data.rob_tag == -1 || queue_age(&cpu->reorder_buffer, cursor->data.rob_tag) >= keep)
+        {
+            cpu->btb_head = remove_any_btb(cpu->btb_head, cursor);
+        }
+        cursor = next;
+    }
+}
+
+/*
+ * Squashes every instruction younger than the one tagged rob_tag.
+ *
+ * Renames are undone youngest first: the instructions still in the dispatch
+ * and ROB latches, then the ROB from its tail back to rob_tag. Each restores
+ * the mapping it replaced and returns its register to the free list.
+ */
+static void
+squash_younger(APEX_CPU *cpu, int rob_tag)
+{
+    int keep = queue_age(&cpu->reorder_buffer, rob_tag) + 1;
+
+    squash_btb(cpu, keep);
+    rollback_rename(cpu, &cpu->dispatch);
+    rollback_rename(cpu, &cpu->rob);
+    while (count(&cpu->reorder_buffer) > keep)
+    {
+        rollback_rename(cpu, queue_back(&cpu->reorder_buffer));
+        queue_pop_back(&cpu->reorder_buffer);
+    }
+    squash_queue(cpu, &cpu->issue_queue, rob_tag);
+    squash_queue(cpu, &cpu->load_store_queue, rob_tag);
+
+    kill_stage(&cpu->decode);
+    kill_stage(&cpu->dispatch);
+    kill_stage(&cpu->issueq);
+    kill_stage(&cpu->rob);
+    kill_stage(&cpu->lsq);
+    squash_fu(cpu, &cpu->intfu, rob_tag);
+    squash_fu(cpu, &cpu->logicalfu, rob_tag);
+    squash_fu(cpu, &cpu->mulfu1, rob_tag);
+    squash_fu(cpu, &cpu->mulfu2, rob_tag);
+    squash_fu(cpu, &cpu->mulfu3, rob_tag);
+    squash_fu(cpu, &cpu->mulfu4, rob_tag);
+    squash_fu(cpu, &cpu->dcache, rob_tag);
+
+    cpu->decode.stalled = 0;
+    cpu->dispatch.stalled = 0;
+    /* Any JUMP or HALT that was holding fetch is gone */
+    cpu->jump_inst = 0;
+    cpu->halt_inst = 0;
+}
+
+/* A flag producer finished: hand its result to the branches waiting on it */
+static void
+wakeup_flag_consumers(APEX_CPU *cpu, int rob_tag, int flag)
+{
+    for (int i = 0; i < count(&cpu->issue_queue); ++i)
+    {
+        CPU_Stage *entry = searchAtIndex(&cpu->issue_queue, i);
+        if (entry->flag_tag == rob_tag)
+        {
+            entry->ps1_value = flag;
+            entry->flag_tag = -1;
+        }
+    }
+    if (cpu->issueq.has_insn && cpu->issueq.flag_tag == rob_tag)
+    {
+        cpu->issueq.ps1_value = flag;
+        cpu->issueq.flag_tag = -1;
+    }
+}
+
+/* BZ and BNZ test the flag of the youngest older CMP. If that
+ * instruction has completed its flag is captured now, otherwise the branch
+ * waits for wakeup_flag_consumers. With none in flight the committed flag
+ * is used. */
+static void
+rename_zero_flag(APEX_CPU *cpu, CPU_Stage *stage)
+{
+    stage->flag_tag = -1;
+    stage->ps1_value = cpu->zero_flag;
+    for (int i = count(&cpu->reorder_buffer) - 1; i >= 0; --i)
+    {
+        CPU_Stage *entry = searchAtIndex(&cpu->reorder_buffer, i);
+        if (entry->opcode == OPCODE_CMP)
+        {
+            if (entry->completed)
+            {
+                stage->ps1_value = entry->result_buffer;
+            }
+            else
+            {
+                stage->flag_tag = entry->rob_tag;
+            }
+            break;
+        }
+    }
+}
+
+/*
+ * Every stage is expanded inline into both cycle functions below, once with
+ * trace set and once without, so the headless loop carries no tracing code.
+ */
+#define APEX_STAGE static inline __attribute__((always_inline))
+
+/* Reports the instruction a stage or queue entry holds this cycle */
+APEX_STAGE void
+trace_stage(APEX_CPU *cpu, const int trace, int stage_id, const CPU_Stage *stage)
+{
+    if (trace == TRACE_TEXT)
+    {
+        APEX_print_stage(stage_id, stage);
+    }
+    else if (trace == TRACE_BINARY)
+    {
+        APEX_trace_stage(cpu->trace_out, stage_id, stage);
+    }
+    else if (trace == TRACE_KANATA && stage_id < STAGE_DISPATCH)
+    {
+        /* The front-end latches are printed after handing their instruction
+         * on, so fetch, decode and dispatch report to the log themselves */
+        APEX_kanata_stage(cpu->kanata_out, stage_id, stage);
+    }
+}
+
+/*
+ * Fetch Stage of APEX Pipeline
+ *
+ * Note: You are free to edit this function according to your implementation
+ */
+APEX_STAGE void
+APEX_fetch(APEX_CPU *cpu, const int trace)
+{
+
+    static const APEX_Instruction no_insn;
+    const APEX_Instruction *current_ins;
+    int index;
+
+    if (cpu->jump_inst == 1 || cpu->halt_inst == 1)
+    {
+        cpu->fetch.flush = 1;
+        cpu->fetch.stalled = 1;
+    }
+    else
+    {
+        cpu->fetch.flush = 0;
+        cpu->fetch.stalled = 0;
+    }
+
+    if (cpu->decode.stalled == 1)
+    {
+        cpu->fetch.stalled = 1;
+    }
+    else
+    {
+        cpu->fetch.stalled = 0;
+    }
+
+    if (cpu->fetch.flush == 1)
+    {
+        cpu->fetch.opcode = 0x0;
+        cpu->fetch.pc = '\0';
+        cpu->fetch.flush = 0;
+        return;
+    }
+
+    if (cpu->fetch_from_next_cycle == TRUE)
+    {
+        cpu->fetch_from_next_cycle = FALSE;
+
+        return;
+    }
+    /* Store current PC in fetch latch */
+    cpu->fetch.pc = cpu->pc;
+
+    /* Past the end of the program fetch yields bubbles */
+    index = get_code_memory_index_from_pc(cpu->pc);
+    if (index >= 0 && index < cpu->code_memory_size)
+    {
+        current_ins = &cpu->code_memory[index];
+    }
+    else
+    {
+        current_ins = &no_insn;
+    }
+    cpu->fetch.opcode = current_ins->opcode;
+    cpu->fetch.rd = current_ins->rd;
+    cpu->fetch.rs1 = current_ins->rs1;
+    cpu->fetch.rs2 = current_ins->rs2;
+    cpu->fetch.imm = current_ins->imm;
+    if (cpu->fetch.opcode == 0)
+    {
+        cpu->fetch.pc = '\0';
+    }
+    if (trace == TRACE_KANATA)
+    {
+        APEX_kanata_fetch(cpu->kanata_out, &cpu->fetch);
+    }
+
+    if (cpu->fetch.has_insn && (!cpu->fetch.stalled))
+    {
+        /* Update PC for next instruction */
+        cpu->pc += 4;
+
+        /* Copy data from fetch latch to decode latch*/
+        if (cpu->decode.stalled == 0)
+        {
+            cpu->decode = cpu->fetch;
+        }
+    }
+
+    if (trace && cpu->fetch.opcode != OPCODE_NULL)
+    {
+        trace_stage(cpu, trace, STAGE_FETCH, &cpu->fetch);
+    }
+}
+
+/*
+ * Decode Stage of APEX Pipeline
+ *
+ * Note: You are free to edit this function according to your implementation
+ */
+APEX_STAGE void
+APEX_decode(APEX_CPU *cpu, const int trace)
+{
+    if (trace == TRACE_TEXT)
+    {
+        printf("In decode %d\t\n", cpu->decode.pc);
+    }
+    else if (trace == TRACE_BINARY)
+    {
+        APEX_trace_decode_pc(cpu->trace_out, cpu->decode.pc);
+    }
+
+    if (cpu->decode.flush == 1)
+    {
+        cpu->decode.opcode = 0x0;
+        cpu->decode.pc = 0000;
+        cpu->decode.flush = 0;
+    }
+    if (trace == TRACE_KANATA && cpu->decode.has_insn && cpu->decode.opcode != OPCODE_NULL)
+    {
+        APEX_kanata_stage(cpu->kanata_out, STAGE_DECODE, &cpu->decode);
+    }
+
+    if (cpu->decode.has_insn && !cpu->decode.stalled && has_destination(cpu->decode.opcode) && free_list_count(&cpu->preg_free_list) == 0)
+    {
+        /* Nothing to rename into, hold the instruction in decode */
+        cpu->decode.stalled = 1;
+    }
+
+    if (cpu->decode.has_insn && (!cpu->decode.stalled))
+    {
+        switch (cpu->decode.opcode)
+        {
+
+        case OPCODE_STR:
+        {
+            cpu->decode.ps1 = cpu->rat[cpu->decode.rs1];
+            cpu->decode.ps2 = cpu->rat[cpu->decode.rs2];
+            cpu->decode.pd = cpu->rat[cpu->decode.rd];
+            break;
+        }
+
+        case OPCODE_STORE:
+        {
+            cpu->decode.ps1 = cpu->rat[cpu->decode.rs1];
+            cpu->decode.ps2 = cpu->rat[cpu->decode.rs2];
+            break;
+        }
+
+        case OPCODE_LDR:
+        {
+
+            cpu->decode.ps1 = cpu->rat[cpu->decode.rs1];
+            cpu->decode.ps2 = cpu->rat[cpu->decode.rs2];
+            rename_destination(cpu, &cpu->decode);
+
+            break;
+        }
+
+        case OPCODE_LOAD:
+        {
+
+            cpu->decode.ps1 = cpu->rat[cpu->decode.rs1];
+            rename_destination(cpu, &cpu->decode);
+
+            break;
+        }
+
+        case OPCODE_CMP:
+        {
+            cpu->decode.ps1 = cpu->rat[cpu->decode.rs1];
+            cpu->decode.ps2 = cpu->rat[cpu->decode.rs2];
+            rename_destination(cpu, &cpu->decode);
+            break;
+        }
+
+        case OPCODE_ADD:
+        case OPCODE_SUB:
+        case OPCODE_MUL:
+        case OPCODE_DIV:
+        case OPCODE_AND:
+        case OPCODE_OR:
+        case OPCODE_XOR:
+        {
+
+            cpu->decode.ps1 = cpu->rat[cpu->decode.rs1];
+            cpu->decode.ps2 = cpu->rat[cpu->decode.rs2];
+            rename_destination(cpu, &cpu->decode);
+
+            break;
+        }
+
+        case OPCODE_ADDL:
+        case OPCODE_SUBL:
+        {
+            cpu->decode.ps1 = cpu->rat[cpu->decode.rs1];
+            rename_destination(cpu, &cpu->decode);
+            break;
+        }
+
+        case OPCODE_MOVC:
+        {
+
+            rename_destination(cpu, &cpu->decode);
+            break;
+        }
+
+        case OPCODE_BNZ:
+        case OPCODE_BZ:
+        {
+            BTB entry;
+            entry.active_flag = 0;
+            entry.inst_pc = cpu->decode.pc;
+            entry.computed_address = 0;
+            entry.taken = 0;
+            entry.rob_tag = -1;
+            cpu->btb_head = enqueue_btb(cpu->btb_head, entry);
+            break;
+        }
+
+        case OPCODE_JUMP:
+        {
+            cpu->jump_inst = 1;
+            cpu->fetch.flush = 1;
+            break;
+        }
+
+        case OPCODE_HALT:
+        {
+            /* Nothing after HALT is fetched unless it gets squashed */
+            cpu->halt_inst = 1;
+            break;
+        }
+        default:
+        {
+            break;
+        }
+        }
+    }
+
+    /* Copy data from decode latch to dispatch latch, unless dispatch is still
+     * holding an instruction it could not send on */
+    if (cpu->decode.stalled == 0)
+    {
+        cpu->dispatch = cpu->decode;
+        cpu->decode.has_insn = FALSE;
+    }
+
+    if (trace && cpu->decode.opcode != OPCODE_NULL)
+    {
+        trace_stage(cpu, trace, STAGE_DECODE, &cpu->decode);
+    }
+}
+
+/* The structure an instruction held in dispatch waits on first */
+static int
+dispatch_stall_cause(const APEX_CPU *cpu)
+{
+    if (queue_full(&cpu->reorder_buffer))
+    {
+        return STALL_ROB_FULL;
+    }
+    if (queue_full(&cpu->issue_queue))
+    {
+        return STALL_IQ_FULL;
+    }
+    return STALL_LSQ_FULL;
+}
+
+APEX_STAGE void
+APEX_dispatch(APEX_CPU *cpu, const int trace)
+{
+
+    if (cpu->dispatch.flush == 1)
+    {
+        cpu->dispatch.opcode = 0x0;
+        cpu->dispatch.pc = 0000;
+        cpu->dispatch.flush = 0;
+    }
+    if (trace == TRACE_KANATA && cpu->dispatch.has_insn && cpu->dispatch.opcode != OPCODE_NULL)
+    {
+        APEX_kanata_stage(cpu->kanata_out, STAGE_DISPATCH, &cpu->dispatch);
+    }
+
+    /* Decode is still stalled from last cycle only if it had no physical
+     * register: a held dispatch would still hold its instruction */
+    cpu->dispatch_stall = cpu->decode.stalled ? STALL_FREE_LIST : STALL_FRONT_END;
+    cpu->dispatch.stalled = 0;
+    if (cpu->dispatch.has_insn && cpu->dispatch.opcode != OPCODE_NULL)
+    {
+        /* The ROB latch is always drained before dispatch runs, so the
+         * instruction will land in the current tail slot */
+        cpu->dispatch.rob_tag = cpu->reorder_buffer.tail;
+        cpu->dispatch.completed = 0;
+        cpu->dispatch.mem_ready = 0;
+        cpu->dispatch.fault = 0;
+        cpu->dispatch.flag_tag = -1;
+
+        switch (cpu->dispatch.opcode)
+        {
+        case OPCODE_LDR:
+        case OPCODE_LOAD:
+        case OPCODE_STR:
+        case OPCODE_STORE:
+        {
+            if (!queue_full(&cpu->issue_queue) && !queue_full(&cpu->reorder_buffer) && !queue_full(&cpu->load_store_queue))
+            {
+                cpu->issueq = cpu->dispatch;
+                cpu->rob = cpu->dispatch;
+                cpu->lsq = cpu->dispatch;
+            }
+            else
+            {
+                cpu->dispatch.stalled = 1;
+            }
+            break;
+        }
+
+        case OPCODE_JUMP:
+        {
+            if (!queue_full(&cpu->issue_queue) && !queue_full(&cpu->reorder_buffer))
+            {
+                cpu->issueq = cpu->dispatch;
+                cpu->rob = cpu->dispatch;
+                cpu->decode.flush = 1;
+            }
+            else
+            {
+                cpu->dispatch.stalled = 1;
+            }
+            break;
+        }
+
+        case OPCODE_BZ:
+        case OPCODE_BNZ:
+        {
+            if (!queue_full(&cpu->issue_queue) && !queue_full(&cpu->reorder_buffer))
+            {
+                rename_zero_flag(cpu, &cpu->dispatch);
+                cpu->btb_head = tag_btb(cpu->btb_head, cpu->dispatch.rob_tag);
+                cpu->issueq = cpu->dispatch;
+                cpu->rob = cpu->dispatch;
+            }
+            else
+            {
+                cpu->dispatch.stalled = 1;
+            }
+            break;
+        }
+
+        default:
+        {
+            if (!queue_full(&cpu->issue_queue) && !queue_full(&cpu->reorder_buffer))
+            {
+                cpu->issueq = cpu->dispatch;
+                cpu->rob = cpu->dispatch;
+            }
+            else
+            {
+                cpu->dispatch.stalled = 1;
+            }
+            break;
+        }
+        }
+
+        if (!cpu->dispatch.stalled)
+        {
+            cpu->dispatch.has_insn = FALSE;
+            cpu->dispatch_stall = STALL_NONE;
+        }
+        else
+        {
+            cpu->dispatch_stall = dispatch_stall_cause(cpu);
+        }
+    }
+
+    /* A stalled dispatch holds decode, which in turn holds fetch */
+    cpu->decode.stalled = cpu->dispatch.stalled;
+
+    if (trace && cpu->dispatch.opcode != OPCODE_NULL)
+    {
+        trace_stage(cpu, trace, STAGE_DISPATCH, &cpu->dispatch);
+    }
+}
+
+APEX_STAGE void
+APEX_lsq(APEX_CPU *cpu, const int trace)
+{
+    if (cpu->lsq.flush == 1)
+    {
+
+        cpu->lsq.opcode = 0x0;
+        cpu->lsq.pc = 0000;
+        cpu->lsq.flush = 0;
+    }
+
+    if (cpu->lsq.opcode != 0x0 && cpu->lsq.has_insn == TRUE)
+    {
+        enqueue(&cpu->load_store_queue, cpu->lsq);
+    }
+
+    for (int i = 0; i < count(&cpu->load_store_queue); ++i)
+    {
+        CPU_Stage *entry = searchAtIndex(&cpu->load_store_queue, i);
+        if (trace && entry->opcode != OPCODE_NULL)
+        {
+            trace_stage(cpu, trace, STAGE_LSQ, entry);
+        }
+    }
+
+    if (count(&cpu->load_store_queue) != 0)
+    {
+
+        CPU_Stage *cursor = queue_front(&cpu->load_store_queue);
+        CPU_Stage *entry = rob_entry(cpu, cursor->rob_tag);
+
+        /* Memory is touched in program order once intfu has produced the
+         * address. Stores also wait until they reach the ROB head, so that a
+         * squashed store never writes memory. */
+        switch (cursor->opcode)
+        {
+
+        case OPCODE_STR:
+        {
+
+            if (cpu->pregs_valid[cursor->pd] && entry->mem_ready && cpu->reorder_buffer.head == cursor->rob_tag)
+            {
+                cursor->result_buffer = entry->result_buffer;
+                cpu->dcache = *cursor;
+                dequeue(&cpu->load_store_queue);
+            }
+            else
+            {
+                cpu->dcache.flush = 1;
+            }
+            break;
+        }
+
+        case OPCODE_STORE:
+        {
+            if (cpu->pregs_valid[cursor->ps1] && entry->mem_ready && cpu->reorder_buffer.head == cursor->rob_tag)
+            {
+                cursor->result_buffer = entry->result_buffer;
+                cpu->dcache = *cursor;
+                dequeue(&cpu->load_store_queue);
+            }
+            else
+            {
+                cpu->dcache.flush = 1;
+            }
+            break;
+        }
+
+        case OPCODE_LDR:
+        case OPCODE_LOAD:
+        {
+            if (entry->mem_ready)
+            {
+                cursor->result_buffer = entry->result_buffer;
+                cpu->dcache = *cursor;
+                dequeue(&cpu->load_store_queue);
+            }
+            else
+            {
+                cpu->dcache.flush = 1;
+            }
+            break;
+        }
+
+        default:
+        {
+            dequeue(&cpu->load_store_queue);
+            break;
+        }
+        }
+    }
+    cpu->lsq.has_insn = FALSE;
+}
+
+APEX_STAGE void
+APEX_issueq(APEX_CPU *cpu, const int trace)
+{
+    if (cpu->issueq.flush == 1)
+    {
+        cpu->issueq.opcode = 0x0;
+        cpu->issueq.pc = 0000;
+        cpu->issueq.flush = 0;
+    }
+
+    if (cpu->issueq.opcode != 0x0 && cpu->issueq.has_insn == TRUE)
+    {
+        enqueue(&cpu->issue_queue, cpu->issueq);
+    }
+
+    for (int i = 0; i < count(&cpu->issue_queue); ++i)
+    {
+        CPU_Stage *entry = searchAtIndex(&cpu->issue_queue, i);
+        if (trace && entry->opcode != OPCODE_NULL)
+        {
+            trace_stage(cpu, trace, STAGE_ISSUEQ, entry);
+        }
+    }
+    int intfuBusyFlag = 0;
+    int mulfuBusyFlag = 0;
+    int logicalBusyFlag = 0;
+    int issued = 0;
+
+    if (count(&cpu->issue_queue) != 0)
+    {
+
+        /* Scan oldest first; at most one instruction leaves the queue per cycle */
+        for (int i = 0; i < count(&cpu->issue_queue) && !issued; ++i)
+        {
+            CPU_Stage *cursor = searchAtIndex(&cpu->issue_queue, i);
+
+            switch (cursor->opcode)
+            {
+
+            case OPCODE_STR:
+            {
+
+                if (cpu->pregs_valid[cursor->ps1] && cpu->pregs_valid[cursor->ps2] && cpu->pregs_valid[cursor->pd] && intfuBusyFlag != 1)
+                {
+                    cursor->ps1_value = read_operand(cpu, cursor->ps1, cursor->rs1);
+                    cursor->ps2_value = read_operand(cpu, cursor->ps2, cursor->rs2);
+                    cpu->intfu = *cursor;
+                    remove_any(&cpu->issue_queue, i);
+                    issued = 1;
+                    intfuBusyFlag = 1;
+                }
+                break;
+            }
+
+            case OPCODE_STORE:
+            {
+                if (cpu->pregs_valid[cursor->ps2] && intfuBusyFlag != 1)
+                {
+                    cursor->ps2_value = read_operand(cpu, cursor->ps2, cursor->rs2);
+                    cpu->intfu = *cursor;
+                    remove_any(&cpu->issue_queue, i);
+                    issued = 1;
+                    intfuBusyFlag = 1;
+                }
+                break;
+            }
+
+            case OPCODE_LDR:
+            {
+                if (cpu->pregs_valid[cursor->ps1] && cpu->pregs_valid[cursor->ps2] && intfuBusyFlag != 1)
+                {
+                    cursor->ps1_value = read_operand(cpu, cursor->ps1, cursor->rs1);
+                    cursor->ps2_value = read_operand(cpu, cursor->ps2, cursor->rs2);
+                    cpu->pregs_valid[cursor->pd] = 0;
+                    cpu->intfu = *cursor;
+                    remove_any(&cpu->issue_queue, i);
+                    issued = 1;
+                    intfuBusyFlag = 1;
+                }
+                break;
+            }
+
+            case OPCODE_LOAD:
+            {
+                if (cpu->pregs_valid[cursor->ps1] && intfuBusyFlag != 1)
+                {
+                    cursor->ps1_value = read_operand(cpu, cursor->ps1, cursor->rs1);
+                    cpu->pregs_valid[cursor->pd] = 0;
+                    cpu->intfu = *cursor;
+                    remove_any(&cpu->issue_queue, i);
+                    issued = 1;
+                    intfuBusyFlag = 1;
+                }
+                break;
+            }
+
+            case OPCODE_ADD:
+            case OPCODE_SUB:
+            case OPCODE_DIV:
+            case OPCODE_CMP:
+            {
+                if (cpu->pregs_valid[cursor->ps1] && cpu->pregs_valid[cursor->ps2] && intfuBusyFlag != 1)
+                {
+                    cursor->ps1_value = read_operand(cpu, cursor->ps1, cursor->rs1);
+                    cursor->ps2_value = read_operand(cpu, cursor->ps2, cursor->rs2);
+                    cpu->pregs_valid[cursor->pd] = 0;
+                    cpu->intfu = *cursor;
+                    remove_any(&cpu->issue_queue, i);
+                    issued = 1;
+
+                    intfuBusyFlag = 1;
+                }
+
+                break;
+            }
+            case OPCODE_AND:
+            case OPCODE_OR:
+            case OPCODE_XOR:
+            {
+                if (cpu->pregs_valid[cursor->ps1] && cpu->pregs_valid[cursor->ps2] && logicalBusyFlag != 1)
+                {
+                    cursor->ps1_value = read_operand(cpu, cursor->ps1, cursor->rs1);
+                    cursor->ps2_value = read_operand(cpu, cursor->ps2, cursor->rs2);
+                    cpu->pregs_valid[cursor->pd] = 0;
+                    cpu->logicalfu = *cursor;
+                    remove_any(&cpu->issue_queue, i);
+                    issued = 1;
+                    logicalBusyFlag = 1;
+                }
+
+                break;
+            }
+
+            case OPCODE_JUMP:
+            {
+                if (intfuBusyFlag != 1)
+                {
+
+                    cpu->intfu = *cursor;
+                    remove_any(&cpu->issue_queue, i);
+                    issued = 1;
+                    intfuBusyFlag = 1;
+                }
+
+                break;
+            }
+
+            case OPCODE_BNZ:
+            case OPCODE_BZ:
+            {
+                /* ps1_value holds the zero flag once flag_tag is cleared */
+                if (cursor->flag_tag == -1 && intfuBusyFlag != 1)
+                {
+                    cpu->intfu = *cursor;
+                    remove_any(&cpu->issue_queue, i);
+                    issued = 1;
+                    intfuBusyFlag = 1;
+                }
+                break;
+            }
+
+            case OPCODE_MUL:
+            {
+
+                if (cpu->pregs_valid[cursor->ps1] && cpu->pregs_valid[cursor->ps2] && mulfuBusyFlag != 1)
+                {
+                    cursor->ps1_value = read_operand(cpu, cursor->ps1, cursor->rs1);
+                    cursor->ps2_value = read_operand(cpu, cursor->ps2, cursor->rs2);
+                    cpu->pregs_valid[cursor->pd] = 0;
+                    /* mulfu1 multiplies; a shorter MUL pipeline starts past it */
+                    cursor->result_buffer = cursor->ps1_value * cursor->ps2_value;
+                    *APEX_mul_entry(cpu) = *cursor;
+                    remove_any(&cpu->issue_queue, i);
+                    issued = 1;
+                    mulfuBusyFlag = 1;
+                }
+
+                break;
+            }
+            case OPCODE_ADDL:
+            case OPCODE_SUBL:
+            {
+                if (cpu->pregs_valid[cursor->ps1] && intfuBusyFlag != 1)
+                {
+                    cursor->ps1_value = read_operand(cpu, cursor->ps1, cursor->rs1);
+                    cpu->pregs_valid[cursor->pd] = 0;
+                    cpu->intfu = *cursor;
+                    remove_any(&cpu->issue_queue, i);
+                    issued = 1;
+                    intfuBusyFlag = 1;
+                }
+
+                break;
+            }
+
+            case OPCODE_MOVC:
+            {
+                if (intfuBusyFlag != 1)
+                {
+                    cpu->intfu = *cursor;
+                    cpu->pregs_valid[cursor->pd] = 0;
+                    remove_any(&cpu->issue_queue, i);
+                    issued = 1;
+                    intfuBusyFlag = 1;
+                }
+                break;
+            }
+
+            default:
+            {
+                remove_any(&cpu->issue_queue, i);
+                issued = 1;
+                break;
+            }
+            }
+        }
+    }
+    cpu->issueq.has_insn = FALSE;
+}
+
+/* Writes back an integer result and marks its ROB entry complete */
+static void
+write_result(APEX_CPU *cpu, const CPU_Stage *stage)
+{
+    cpu->renameTableValues[stage->pd] = stage->result_buffer;
+    cpu->pregs_valid[stage->pd] = 1;
+    rob_entry(cpu, stage->rob_tag)->completed = 1;
+}
+
+APEX_STAGE void
+APEX_intfu(APEX_CPU *cpu, const int trace)
+{
+
+    if (cpu->intfu.flush == 1)
+    {
+        cpu->intfu.opcode = 0x0;
+        cpu->intfu.pc = 0000;
+    }
+    if (cpu->intfu.has_insn)
+    {
+        CPU_Stage *entry = rob_entry(cpu, cpu->intfu.rob_tag);
+        int taken;
+
+        switch (cpu->intfu.opcode)
+        {
+        case OPCODE_CMP:
+        {
+            /* rd reads as zero; the difference only goes to the zero flag */
+            cpu->intfu.result_buffer = cpu->intfu.ps1_value - cpu->intfu.ps2_value;
+            cpu->renameTableValues[cpu->intfu.pd] = 0;
+            cpu->pregs_valid[cpu->intfu.pd] = 1;
+            entry->result_buffer = cpu->intfu.result_buffer;
+            entry->completed = 1;
+            wakeup_flag_consumers(cpu, cpu->intfu.rob_tag, cpu->intfu.result_buffer);
+            break;
+        }
+        case OPCODE_JUMP:
+        {
+            cpu->intfu.result_buffer = cpu->intfu.pc + cpu->intfu.imm;
+            entry->result_buffer = cpu->intfu.result_buffer;
+            entry->completed = 1;
+            cpu->jump_inst = 0;
+            break;
+        }
+        case OPCODE_STR:
+        case OPCODE_LDR:
+        {
+            cpu->intfu.result_buffer = cpu->intfu.ps1_value + cpu->intfu.ps2_value;
+            entry->result_buffer = cpu->intfu.result_buffer;
+            entry->mem_ready = 1;
+            break;
+        }
+        case OPCODE_STORE:
+        {
+            cpu->intfu.result_buffer = cpu->intfu.ps2_value + cpu->intfu.imm;
+            entry->result_buffer = cpu->intfu.result_buffer;
+            entry->mem_ready = 1;
+            break;
+        }
+        case OPCODE_LOAD:
+        {
+            cpu->intfu.result_buffer = cpu->intfu.ps1_value + cpu->intfu.imm;
+            entry->result_buffer = cpu->intfu.result_buffer;
+            entry->mem_ready = 1;
+            break;
+        }
+
+        case OPCODE_ADD:
+        {
+
+            cpu->intfu.result_buffer = cpu->intfu.ps1_value + cpu->intfu.ps2_value;
+            write_result(cpu, &cpu->intfu);
+            break;
+        }
+        case OPCODE_SUB:
+        {
+            cpu->intfu.result_buffer = cpu->intfu.ps1_value - cpu->intfu.ps2_value;
+            write_result(cpu, &cpu->intfu);
+            break;
+        }
+
+        case OPCODE_DIV:
+        {
+            /* Like a bad data address, a division by zero may be down a path
+             * that gets squashed: the ROB entry is marked, and dependents
+             * see 0 until commit stops the run */
+            if (cpu->intfu.ps2_value == 0)
+            {
+                rob_entry(cpu, cpu->intfu.rob_tag)->fault = 1;
+                cpu->intfu.result_buffer = 0;
+            }
+            else
+            {
+                cpu->intfu.result_buffer = cpu->intfu.ps1_value / cpu->intfu.ps2_value;
+            }
+            write_result(cpu, &cpu->intfu);
+            break;
+        }
+        case OPCODE_ADDL:
+        {
+            cpu->intfu.result_buffer = (cpu->intfu.ps1_value) + cpu->intfu.imm;
+            write_result(cpu, &cpu->intfu);
+            break;
+        }
+        case OPCODE_SUBL:
+        {
+            cpu->intfu.result_buffer = cpu->intfu.ps1_value - cpu->intfu.imm;
+            write_result(cpu, &cpu->intfu);
+            break;
+        }
+
+        case OPCODE_MOVC:
+        {
+
+            cpu->intfu.result_buffer = cpu->intfu.imm;
+            write_result(cpu, &cpu->intfu);
+            break;
+        }
+
+        case OPCODE_BZ:
+        case OPCODE_BNZ:
+        {
+            cpu->intfu.result_buffer = cpu->intfu.pc + cpu->intfu.imm;
+            entry->completed = 1;
+
+            if (cpu->intfu.opcode == OPCODE_BZ)
+            {
+                taken = cpu->intfu.ps1_value == 0;
+            }
+            else
+            {
+                taken = cpu->intfu.ps1_value != 0;
+            }
+            if (taken)
+            {
+                /* Fetch runs later this cycle and starts at the target */
+                squash_younger(cpu, cpu->intfu.rob_tag);
+                cpu->pc = cpu->intfu.result_buffer;
+                cpu->branch_refill = 1;
+            }
+            cpu->btb_head = insert_address_btb(cpu->btb_head, cpu->intfu, taken);
+            break;
+        }
+
+        case OPCODE_HALT:
+        {
+            cpu->decode.flush = 1;
+            cpu->fetch.flush = 1;
+            break;
+        }
+        }
+
+        cpu->intfu.has_insn = FALSE;
+        if (trace && cpu->intfu.opcode != OPCODE_NULL)
+        {
+            trace_stage(cpu, trace, STAGE_INTFU, &cpu->intfu);
+        }
+    }
+}
+
+/*
+ * TRUE if the load or store in stage addresses data memory. Otherwise its
+ * ROB entry is marked and memory is left alone: the access may be down a
+ * path that gets squashed, so the run only stops once it reaches commit.
+ */
+static int
+data_access_ok(APEX_CPU *cpu, const CPU_Stage *stage)
+{
+    if (stage->result_buffer >= 0 && stage->result_buffer < cpu->config.data_memory_size)
+    {
+        return TRUE;
+    }
+    rob_entry(cpu, stage->rob_tag)->fault = 1;
+    return FALSE;
+}
+
+APEX_STAGE void
+APEX_dcache(APEX_CPU *cpu, const int trace)
+{
+    if (cpu->dcache.flush == 1)
+    {
+        cpu->dcache.opcode = 0x0;
+        cpu->dcache.pc = 0000;
+    }
+    if (cpu->dcache.has_insn)
+    {
+        switch (cpu->dcache.opcode)
+        {
+        case OPCODE_STR:
+        {
+            if (data_access_ok(cpu, &cpu->dcache))
+            {
+                cpu->data_memory[cpu->dcache.result_buffer] = read_operand(cpu, cpu->dcache.pd, cpu->dcache.rd);
+            }
+            rob_entry(cpu, cpu->dcache.rob_tag)->completed = 1;
+            break;
+        }
+        case OPCODE_STORE:
+        {
+            if (data_access_ok(cpu, &cpu->dcache))
+            {
+                cpu->data_memory[cpu->dcache.result_buffer] = read_operand(cpu, cpu->dcache.ps1, cpu->dcache.rs1);
+            }
+            rob_entry(cpu, cpu->dcache.rob_tag)->completed = 1;
+            break;
+        }
+        case OPCODE_LDR:
+        case OPCODE_LOAD:
+        {
+            cpu->dcache.result_buffer = data_access_ok(cpu, &cpu->dcache) ? cpu->data_memory[cpu->dcache.result_buffer] : 0;
+            write_result(cpu, &cpu->dcache);
+            break;
+        }
+        }
+
+        cpu->dcache.has_insn = FALSE;
+        if (trace && cpu->dcache.opcode != OPCODE_NULL)
+        {
+            trace_stage(cpu, trace, STAGE_DCACHE, &cpu->dcache);
+        }
+    }
+}
+
+APEX_STAGE void
+APEX_logicalfu(APEX_CPU *cpu, const int trace)
+{
+    if (cpu->logicalfu.flush == 1)
+    {
+        cpu->logicalfu.opcode = 0x0;
+        cpu->logicalfu.pc = 0000;
+    }
+    if (cpu->logicalfu.has_insn)
+    {
+        switch (cpu->logicalfu.opcode)
+        {
+        case OPCODE_AND:
+        {
+            cpu->logicalfu.result_buffer = (cpu->logicalfu.ps1_value) & (cpu->logicalfu.ps2_value);
+            write_result(cpu, &cpu->logicalfu);
+            break;
+        }
+        case OPCODE_OR:
+        {
+            cpu->logicalfu.result_buffer = cpu->logicalfu.ps1_value | cpu->logicalfu.ps2_value;
+            write_result(cpu, &cpu->logicalfu);
+            break;
+        }
+        case OPCODE_XOR:
+        {
+            cpu->logicalfu.result_buffer = (cpu->logicalfu.ps1_value) ^ (cpu->logicalfu.ps2_value);
+            write_result(cpu, &cpu->logicalfu);
+            break;
+        }
+        }
+
+        cpu->logicalfu.has_insn = FALSE;
+        if (trace && cpu->logicalfu.opcode != OPCODE_NULL)
+        {
+            trace_stage(cpu, trace, STAGE_LOGICALFU, &cpu->logicalfu);
+        }
+    }
+}
+
+APEX_STAGE void
+APEX_mulfu1(APEX_CPU *cpu, const int trace)
+{
+    if (cpu->mulfu1.flush == 1)
+    {
+        cpu->mulfu1.opcode = 0x0;
+        cpu->mulfu1.pc = 0000;
+    }
+
+    if (cpu->mulfu1.has_insn)
+    {
+
+        switch (cpu->mulfu1.opcode)
+        {
+        case OPCODE_MUL:
+        {
+            cpu->mulfu1.result_buffer = cpu->mulfu1.ps1_value * cpu->mulfu1.ps2_value;
+
+            break;
+        }
+        }
+
+        cpu->mulfu2 = cpu->mulfu1;
+        cpu->mulfu1.has_insn = FALSE;
+        if (trace && cpu->mulfu1.opcode != OPCODE_NULL)
+        {
+            trace_stage(cpu, trace, STAGE_MULFU1, &cpu->mulfu1);
+        }
+    }
+}
+
+APEX_STAGE void
+APEX_mulfu2(APEX_CPU *cpu, const int trace)
+{
+    if (cpu->mulfu2.has_insn)
+    {
+
+        cpu->mulfu3 = cpu->mulfu2;
+        cpu->mulfu2.has_insn = FALSE;
+        if (trace && cpu->mulfu2.opcode != OPCODE_NULL)
+        {
+            trace_stage(cpu, trace, STAGE_MULFU2, &cpu->mulfu2);
+        }
+    }
+}
+
+APEX_STAGE void
+APEX_mulfu3(APEX_CPU *cpu, const int trace)
+{
+    if (cpu->mulfu3.has_insn)
+    {
+
+        cpu->mulfu4 = cpu->mulfu3;
+        cpu->mulfu3.has_insn = FALSE;
+        if (trace && cpu->mulfu3.opcode != OPCODE_NULL)
+        {
+            trace_stage(cpu, trace, STAGE_MULFU3, &cpu->mulfu3);
+        }
+    }
+}
+
+APEX_STAGE void
+APEX_mulfu4(APEX_CPU *cpu, const int trace)
+{
+    if (cpu->mulfu4.has_insn)
+    {
+
+        switch (cpu->mulfu4.opcode)
+        {
+        case OPCODE_MUL:
+        {
+
+            write_result(cpu, &cpu->mulfu4);
+            break;
+        }
+        }
+
+        cpu->mulfu4.has_insn = FALSE;
+
+        if (trace && cpu->mulfu4.opcode != OPCODE_NULL)
+        {
+            trace_stage(cpu, trace, STAGE_MULFU4, &cpu->mulfu4);
+        }
+    }
+}
+
+APEX_STAGE int
+APEX_rob(APEX_CPU *cpu, const int trace)
+{
+    if (cpu->rob.flush == 1)
+    {
+        cpu->rob.opcode = 0x0;
+        cpu->rob.pc = 0000;
+        cpu->rob.flush = 0;
+    }
+
+    if (count(&cpu->reorder_buffer) != 0)
+    {
+        /* A load or store outside data memory, or a division by zero, ends
+         * the run like HALT, but retires nothing */
+        if (queue_front(&cpu->reorder_buffer)->fault)
+        {
+            cpu->fault_pc = queue_front(&cpu->reorder_buffer)->pc;
+            squash_younger(cpu, cpu->reorder_buffer.head);
+            return TRUE;
+        }
+        if (queue_front(&cpu->reorder_buffer)->opcode == OPCODE_HALT)
+        {
+            squash_younger(cpu, cpu->reorder_buffer.head);
+            cpu->insn_completed++;
+            cpu->last_retire = cpu->clock;
+            if (trace && queue_front(&cpu->reorder_buffer)->opcode != OPCODE_NULL)
+            {
+                trace_stage(cpu, trace, STAGE_ROB, queue_front(&cpu->reorder_buffer));
+            }
+            if (trace == TRACE_KANATA)
+            {
+                APEX_kanata_retire(cpu->kanata_out, queue_front(&cpu->reorder_buffer));
+            }
+            return TRUE;
+        }
+    }
+    if (cpu->rob.opcode != 0x0 && cpu->rob.has_insn == TRUE)
+    {
+        enqueue(&cpu->reorder_buffer, cpu->rob);
+        cpu->branch_refill = 0;
+    }
+    for (int i = 0; i < count(&cpu->reorder_buffer); ++i)
+    {
+        CPU_Stage *entry = searchAtIndex(&cpu->reorder_buffer, i);
+        if (trace && entry->opcode != OPCODE_NULL)
+        {
+            trace_stage(cpu, trace, STAGE_ROB, entry);
+        }
+    }
+
+    if (count(&cpu->reorder_buffer) != 0)
+    {
+        CPU_Stage *robhead = queue_front(&cpu->reorder_buffer);
+        int retired = FALSE;
+
+        /* The head retires once its own ROB entry says it has completed */
+        switch (robhead->opcode)
+        {
+        case OPCODE_ADD:
+        case OPCODE_SUB:
+        case OPCODE_MUL:
+        case OPCODE_DIV:
+        case OPCODE_AND:
+        case OPCODE_OR:
+        case OPCODE_XOR:
+        case OPCODE_ADDL:
+        case OPCODE_SUBL:
+        case OPCODE_LDR:
+        case OPCODE_LOAD:
+        case OPCODE_MOVC:
+        {
+            if (robhead->completed)
+            {
+                retire_destination(cpu, robhead);
+                retired = TRUE;
+            }
+
+            break;
+        }
+
+        case OPCODE_CMP:
+        {
+            if (robhead->completed)
+            {
+                cpu->zero_flag = robhead->result_buffer;
+                retire_destination(cpu, robhead);
+                retired = TRUE;
+            }
+
+            break;
+        }
+        case OPCODE_BZ:
+        case OPCODE_BNZ:
+        {
+            if (robhead->completed)
+            {
+                /* The oldest branch in flight owns the first entry */
+                cpu->btb_head = remove_front_btb(cpu->btb_head);
+                retired = TRUE;
+            }
+            break;
+        }
+        case OPCODE_STR:
+        case OPCODE_STORE:
+        {
+            retired = robhead->completed;
+            break;
+        }
+        case OPCODE_JUMP:
+        {
+            if (robhead->completed)
+            {
+                /* Everything behind the JUMP was fetched down the wrong path */
+                squash_younger(cpu, cpu->reorder_buffer.head);
+                cpu->pc = robhead->result_buffer;
+                retired = TRUE;
+            }
+            break;
+        }
+
+        case OPCODE_HALT:
+        {
+
+            break;
+        }
+        default:
+        {
+            retired = TRUE;
+        }
+        }
+
+        if (retired)
+        {
+            if (trace == TRACE_BINARY && has_destination(robhead->opcode))
+            {
+                APEX_trace_reg(cpu->trace_out, robhead->rd, cpu->regs[robhead->rd]);
+            }
+            else if (trace == TRACE_KANATA)
+            {
+                APEX_kanata_retire(cpu->kanata_out, robhead);
+            }
+            dequeue(&cpu->reorder_buffer);
+            cpu->insn_completed++;
+            cpu->last_retire = cpu->clock;
+        }
+        cpu->rob.has_insn = FALSE;
+    }
+
+    /* Default */
+    return 0;
+}
+
+/* Advances the pipeline by one clock cycle. Returns TRUE once HALT retires
+ * or a bad load or store reaches commit. */
+APEX_STAGE int
+APEX_cycle(APEX_CPU *cpu, const int trace)
+{
+    APEX_intfu(cpu, trace);
+    APEX_logicalfu(cpu, trace);
+    APEX_mulfu4(cpu, trace);
+    APEX_mulfu3(cpu, trace);
+    APEX_mulfu2(cpu, trace);
+    APEX_mulfu1(cpu, trace);
+    APEX_dcache(cpu, trace);
+    if (APEX_rob(cpu, trace))
+    {
+        if (cpu->stats)
+        {
+            cpu->dispatch_stall = STALL_FRONT_END;
+            APEX_stats_sample(cpu->stats, cpu);
+        }
+        return TRUE;
+    }
+    APEX_lsq(cpu, trace);
+    APEX_issueq(cpu, trace);
+    APEX_dispatch(cpu, trace);
+    APEX_decode(cpu, trace);
+    APEX_fetch(cpu, trace);
+    if (cpu->stats)
+    {
+        APEX_stats_sample(cpu->stats, cpu);
+    }
+    return FALSE;
+}
+
+static int
+cycle_traced(APEX_CPU *cpu)
+{
+    return APEX_cycle(cpu, TRACE_TEXT);
+}
+
+static int
+cycle_headless(APEX_CPU *cpu)
+{
+    return APEX_cycle(cpu, TRACE_OFF);
+}
+
+static int
+cycle_binary_trace(APEX_CPU *cpu)
+{
+    return APEX_cycle(cpu, TRACE_BINARY);
+}
+
+static int
+cycle_kanata(APEX_CPU *cpu)
+{
+    return APEX_cycle(cpu, TRACE_KANATA);
+}
+
+/*
+ * Cycle skipping for the headless loop
+ *
+ * A blocked pipeline - fetch held, dispatch stalled or drained, nothing in
+ * the queues able to move and the ROB head still waiting - repeats the same
+ * cycle until a function unit produces a result. If the wait is on the MUL
+ * chain, every cycle until mulfu4 writes back only moves the chain along,
+ * so those cycles can be run as just the chain. The checks below are
+ * conservative: a latch with work left, or a one-off update such as a flush
+ * still to be applied, means the cycle is stepped as usual.
+ */
+
+/* Mirrors the issue conditions of APEX_issueq */
+static int
+iq_entry_ready(const APEX_CPU *cpu, const CPU_Stage *entry)
+{
+    const int *valid = cpu->pregs_valid;
+
+    switch (entry->opcode)
+    {
+    case OPCODE_STR:
+        return valid[entry->ps1] && valid[entry->ps2] && valid[entry->pd];
+    case OPCODE_STORE:
+        return valid[entry->ps2];
+    case OPCODE_LDR:
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_DIV:
+    case OPCODE_CMP:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_MUL:
+        return valid[entry->ps1] && valid[entry->ps2];
+    case OPCODE_LOAD:
+    case OPCODE_ADDL:
+    case OPCODE_SUBL:
+        return valid[entry->ps1];
+    case OPCODE_BZ:
+    case OPCODE_BNZ:
+        return entry->flag_tag == -1;
+    }
+    return TRUE;
+}
+
+/* Mirrors the head checks of APEX_lsq */
+static int
+lsq_head_blocked(APEX_CPU *cpu)
+{
+    CPU_Stage *head = queue_front(&cpu->load_store_queue);
+    CPU_Stage *entry = rob_entry(cpu, head->rob_tag);
+    int at_head = cpu->reorder_buffer.head == head->rob_tag;
+
+    switch (head->opcode)
+    {
+    case OPCODE_STR:
+        return !(cpu->pregs_valid[head->pd] && entry->mem_ready && at_head);
+    case OPCODE_STORE:
+        return !(cpu->pregs_valid[head->ps1] && entry->mem_ready && at_head);
+    case OPCODE_LDR:
+    case OPCODE_LOAD:
+        return !entry->mem_ready;
+    }
+    return FALSE;
+}
+
+/* Mirrors the resource checks of APEX_dispatch */
+static int
+dispatch_blocked(const APEX_CPU *cpu)
+{
+    int full = queue_full(&cpu->issue_queue) || queue_full(&cpu->reorder_buffer);
+
+    switch (cpu->dispatch.opcode)
+    {
+    case OPCODE_LDR:
+    case OPCODE_LOAD:
+    case OPCODE_STR:
+    case OPCODE_STORE:
+        return full || queue_full(&cpu->load_store_queue);
+    }
+    return full;
+}
+
+/* A function unit latch whose flush has already cleared it */
+static int
+fu_settled(const CPU_Stage *stage)
+{
+    return !stage->has_insn && (stage->flush != 1 || (stage->opcode == OPCODE_NULL && stage->pc == 0));
+}
+
+static int
+back_end_idle(APEX_CPU *cpu)
+{
+    const CPU_Stage *head;
+
+    if (!fu_settled(&cpu->intfu) || !fu_settled(&cpu->logicalfu) || !fu_settled(&cpu->dcache) || cpu->mulfu4.has_insn)
+    {
+        return FALSE;
+    }
+    if (cpu->rob.flush || cpu->rob.has_insn || cpu->lsq.flush || cpu->lsq.has_insn || cpu->issueq.flush || cpu->issueq.has_insn)
+    {
+        return FALSE;
+    }
+
+    /* ROB head must be waiting for its result */
+    if (count(&cpu->reorder_buffer) == 0)
+    {
+        return FALSE;
+    }
+    head = queue_front(&cpu->reorder_buffer);
+    switch (head->opcode)
+    {
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_MUL:
+    case OPCODE_DIV:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_ADDL:
+    case OPCODE_SUBL:
+    case OPCODE_LDR:
+    case OPCODE_LOAD:
+    case OPCODE_MOVC:
+    case OPCODE_CMP:
+    case OPCODE_BZ:
+    case OPCODE_BNZ:
+    case OPCODE_STR:
+    case OPCODE_STORE:
+    case OPCODE_JUMP:
+        if (head->completed)
+        {
+            return FALSE;
+        }
+        break;
+    default:
+        /* HALT ends the run, the rest retire at once */
+        return FALSE;
+    }
+
+    /* A blocked LSQ head re-arms the dcache flush every cycle */
+    if (count(&cpu->load_store_queue) != 0)
+    {
+        if (!lsq_head_blocked(cpu) || cpu->dcache.flush != 1)
+        {
+            return FALSE;
+        }
+    }
+
+    for (int i = 0; i < count(&cpu->issue_queue); ++i)
+    {
+        if (iq_entry_ready(cpu, searchAtIndex(&cpu->issue_queue, i)))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* Fetch reloads the latch from cpu->pc; idle if that changes nothing */
+static int
+fetch_reload_idle(const APEX_CPU *cpu)
+{
+    static const APEX_Instruction no_insn;
+    const APEX_Instruction *ins = &no_insn;
+    const CPU_Stage *f = &cpu->fetch;
+    int index = get_code_memory_index_from_pc(cpu->pc);
+
+    if (index >= 0 && index < cpu->code_memory_size)
+    {
+        ins = &cpu->code_memory[index];
+    }
+    return f->opcode == ins->opcode && f->rd == ins->rd && f->rs1 == ins->rs1 && f->rs2 == ins->rs2 && f->imm == ins->imm && f->pc == (ins->opcode == OPCODE_NULL ? 0 : cpu->pc);
+}
+
+static int
+front_end_idle(const APEX_CPU *cpu)
+{
+    const CPU_Stage *f = &cpu->fetch;
+    int held = cpu->jump_inst == 1 || cpu->halt_inst == 1;
+
+    if (cpu->decode.flush || cpu->dispatch.flush || f->flush || cpu->fetch_from_next_cycle)
+    {
+        return FALSE;
+    }
+
+    if (cpu->dispatch.has_insn && cpu->dispatch.opcode != OPCODE_NULL)
+    {
+        /* Dispatch stalled on a full queue, holding decode and fetch */
+        const CPU_Stage *d = &cpu->dispatch;
+
+        if (!dispatch_blocked(cpu) || !d->stalled || !cpu->decode.stalled || d->rob_tag != cpu->reorder_buffer.tail || d->completed || d->mem_ready || d->flag_tag != -1)
+        {
+            return FALSE;
+        }
+        if (held)
+        {
+            return f->opcode == OPCODE_NULL && f->pc == 0 && f->stalled;
+        }
+        return f->stalled && fetch_reload_idle(cpu);
+    }
+
+    /* Front end drained behind a JUMP or HALT: decode keeps copying its
+     * empty latch into dispatch */
+    return held && !cpu->dispatch.stalled && !cpu->decode.stalled && !cpu->decode.has_insn && memcmp(&cpu->dispatch, &cpu->decode, sizeof(CPU_Stage)) == 0 && f->opcode == OPCODE_NULL && f->pc == 0 && !f->stalled;
+}
+
+/* Number of cycles from now that would only move the MUL chain: until mulfu4
+ * holds an instruction, or up to limit when the chain is empty too */
+static int
+idle_cycles(APEX_CPU *cpu, int limit)
+{
+    if (!back_end_idle(cpu) || !front_end_idle(cpu))
+    {
+        return 0;
+    }
+    if (cpu->mulfu3.has_insn)
+    {
+        return 1;
+    }
+    if (cpu->mulfu2.has_insn)
+    {
+        return 2;
+    }
+    if (cpu->mulfu1.has_insn)
+    {
+        return 3;
+    }
+    /* Nothing left to wake the pipeline: every cycle to the limit is alike */
+    return limit;
+}
+
+/* Runs n idle cycles, of which only the MUL chain does anything. Dispatch
+ * stays held for the same reason throughout, so the statistics of each are
+ * those of a stepped cycle. */
+static void
+skip_idle_cycles(APEX_CPU *cpu, int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        APEX_mulfu3(cpu, TRACE_OFF);
+        APEX_mulfu2(cpu, TRACE_OFF);
+        APEX_mulfu1(cpu, TRACE_OFF);
+        if (cpu->stats)
+        {
+            APEX_stats_sample(cpu->stats, cpu);
+        }
+    }
+    cpu->clock += n;
+    cpu->cycles_skipped += n;
+}
+
+static void
+print_code_memory(const APEX_CPU *cpu)
+{
+    fprintf(stderr,
+            "APEX_CPU: Initialized APEX CPU, loaded %d instructions\n",
+            cpu->code_memory_size);
+    fprintf(stderr, "APEX_CPU: PC initialized to %d\n", cpu->pc);
+    fprintf(stderr, "APEX_CPU: Printing Code Memory\n");
+    APEX_print_code_memory(cpu->code_memory, cpu->code_memory_size);
+}
+
+/*
+ * Creates an APEX cpu in its reset state, with no program loaded. Its
+ * structures are sized by config, or by the defaults if config is NULL.
+ */
+APEX_CPU *
+APEX_cpu_create(const APEX_Config *config)
+{
+    int i;
+    APEX_CPU *cpu;
+
+    cpu = calloc(1, sizeof(APEX_CPU));
+
+    if (!cpu)
+    {
+        return NULL;
+    }
+    if (config)
+    {
+        cpu->config = *config;
+    }
+    else
+    {
+        APEX_config_defaults(&cpu->config);
+    }
+    cpu->data_memory = calloc(cpu->config.data_memory_size, sizeof(int));
+    if (!cpu->data_memory)
+    {
+        free(cpu);
+        return NULL;
+    }
+
+    /* Initialize PC, Registers and all pipeline stages */
+    cpu->pc = 4000;
+    memset(cpu->regs, 0, sizeof(int) * REG_FILE_SIZE);
+    memset(cpu->renameTableValues, 0, sizeof(cpu->renameTableValues));
+
+    queue_init(&cpu->issue_queue, cpu->config.iq_size);
+    queue_init(&cpu->load_store_queue, cpu->config.lsq_size);
+    queue_init(&cpu->reorder_buffer, cpu->config.rob_size);
+    free_list_init(&cpu->preg_free_list, cpu->config.pregs);
+    free_list_fill(&cpu->preg_free_list);
+    cpu->btb_head = NULL;
+
+    cpu->zero_flag = -9999;
+    cpu->fault_pc = -1;
+    for (i = 0; i < REG_FILE_SIZE; i++)
+    {
+        cpu->regs_valid[i] = 1;
+        cpu->rat[i] = PREG_ARCH(cpu);
+    }
+    for (i = 0; i <= PREG_ARCH(cpu); i++)
+    {
+        cpu->pregs_valid[i] = 1;
+    }
+
+    cpu->single_step = ENABLE_SINGLE_STEP;
+    cpu->debug_messages = ENABLE_DEBUG_MESSAGES;
+    cpu->skip_idle = 1;
+
+    /* To start fetch stage */
+    cpu->fetch.has_insn = TRUE;
+
+    return cpu;
+}
+
+/*
+ * This function creates and initializes APEX cpu.
+ *
+ * Note: You are free to edit this function according to your implementation
+ */
+APEX_CPU *
+APEX_cpu_init(const char *filename, const APEX_Config *config)
+{
+    APEX_CPU *cpu;
+
+    if (!filename)
+    {
+        return NULL;
+    }
+
+    cpu = APEX_cpu_create(config);
+    if (!cpu)
+    {
+        return NULL;
+    }
+
+    /* Map a predecoded image, or parse input file and create code memory */
+    switch (APEX_image_map(filename, cpu))
+    {
+    case APEX_IMAGE_MAPPED:
+        return cpu;
+    case APEX_IMAGE_ERROR:
+        APEX_cpu_stop(cpu);
+        return NULL;
+    }
+    cpu->code_memory = create_code_memory(filename, &cpu->code_memory_size);
+    if (!cpu->code_memory)
+    {
+        APEX_cpu_stop(cpu);
+        return NULL;
+    }
+
+    return cpu;
+}
+
+void printFile(APEX_CPU *cpu)
+{
+
+    printf("\n-----------------REGISTER FILE------------------------------------------------------- \n");
+    printf("|Ar Register|Phy. Register| Value | VALID bit\n");
+    for (int i = 0; i < 16; i++)
+    {
+        printf("|R[%d]\t|\tP[%d]\t|\t=%d\t|\t%d\n", i, cpu->rat[i], cpu->renameTableValues[cpu->rat[i]], cpu->pregs_valid[cpu->rat[i]]);
+    }
+    printf("\n-----------------REGISTER FILE------------------------------------------------------- \n");
+
+    printf("\n-----------------DATA MEMORY-------------- \n");
+    for (int i = 0; i < cpu->config.data_memory_size; i++)
+    {
+        if (cpu->data_memory[i] != 0)
+        {
+
+            printf("| MEM[%d] | Value=%d | \n", i, cpu->data_memory[i]);
+        }
+    }
+    printf("-----------------DATA MEMORY-------------- \n");
+}
+
+/* APEX_RUN_CYCLE_LIMIT or APEX_RUN_INSN_LIMIT once the run has reached a
+ * limit it was given, otherwise -1. The instruction limit counts the
+ * fast-forwarded instructions too. */
+static inline int
+run_limit(const APEX_CPU *cpu)
+{
+    if (cpu->max_cycles && cpu->clock >= cpu->max_cycles)
+    {
+        return APEX_RUN_CYCLE_LIMIT;
+    }
+    if (cpu->max_insns && cpu->insn_fast_forwarded + cpu->insn_completed >= cpu->max_insns)
+    {
+        return APEX_RUN_INSN_LIMIT;
+    }
+    return -1;
+}
+
+/* How a run ends once a cycle reported its end */
+static inline int
+end_status(const APEX_CPU *cpu)
+{
+    return cpu->fault_pc >= 0 ? APEX_RUN_FAULT : APEX_RUN_HALTED;
+}
+
+/* Runs to HALT or a limit without printing or waiting on the user */
+static int
+run_headless(APEX_CPU *cpu)
+{
+    int status;
+
+    while ((status = run_limit(cpu)) < 0)
+    {
+        if (cpu->skip_idle)
+        {
+            int n = idle_cycles(cpu, cpu->max_cycles ? cpu->max_cycles - cpu->clock : 0);
+            if (n)
+            {
+                if (cpu->max_cycles && n > cpu->max_cycles - cpu->clock)
+                {
+                    n = cpu->max_cycles - cpu->clock;
+                }
+                skip_idle_cycles(cpu, n);
+                continue;
+            }
+        }
+        if (cycle_headless(cpu))
+        {
+            cpu->clock++;
+            return end_status(cpu);
+        }
+        cpu->clock++;
+    }
+    return status;
+}
+
+/* Headless run that records every cycle into cpu->trace_out */
+static int
+run_binary_trace(APEX_CPU *cpu)
+{
+    int status;
+
+    while ((status = run_limit(cpu)) < 0)
+    {
+        if (cycle_binary_trace(cpu))
+        {
+            cpu->clock++;
+            status = end_status(cpu);
+            break;
+        }
+        APEX_trace_cycle_end(cpu->trace_out, free_list_count(&cpu->preg_free_list));
+        cpu->clock++;
+    }
+    APEX_trace_end(cpu->trace_out, status, cpu);
+    return status;
+}
+
+/* Headless run that logs every instruction's trip through the pipeline into
+ * cpu->kanata_out */
+static int
+run_kanata(APEX_CPU *cpu)
+{
+    int status;
+
+    while ((status = run_limit(cpu)) < 0)
+    {
+        if (cycle_kanata(cpu))
+        {
+            APEX_kanata_cycle_end(cpu->kanata_out);
+            cpu->clock++;
+            return end_status(cpu);
+        }
+        APEX_kanata_cycle_end(cpu->kanata_out);
+        cpu->clock++;
+    }
+    return status;
+}
+
+static int
+run_interactive(APEX_CPU *cpu)
+{
+    char user_prompt_val;
+    int halted;
+    int status;
+
+    if (cpu->debug_messages)
+    {
+        print_code_memory(cpu);
+    }
+
+    while ((status = run_limit(cpu)) < 0)
+    {
+        if (cpu->debug_messages)
+        {
+            printf("--------------------------------------------\n");
+            printf("Clock Cycle #: %d\n", cpu->clock);
+            printf("--------------------------------------------\n");
+            halted = cycle_traced(cpu);
+        }
+        else
+        {
+            halted = cycle_headless(cpu);
+        }
+        if (halted)
+        {
+            cpu->clock++;
+            return end_status(cpu);
+        }
+
+        if (cpu->debug_messages)
+        {
+            print_reg_file(cpu);
+        }
+
+        if (cpu->single_step)
+        {
+            printf("Press any key to advance CPU Clock or <q> to quit:\n");
+            scanf("%c", &user_prompt_val);
+
+            if ((user_prompt_val == 'Q') || (user_prompt_val == 'q'))
+            {
+                return APEX_RUN_STOPPED;
+            }
+        }
+
+        cpu->clock++;
+    }
+    return status;
+}
+
+/*
+ * APEX CPU simulation loop
+ *
+ * Without tracing or single-stepping the run goes through the headless loop,
+ * which prints nothing until the simulation ends. With a binary trace or a
+ * Kanata log open the pipeline is recorded there instead of printed.
+ */
+int APEX_cpu_run(APEX_CPU *cpu)
+{
+    int status;
+
+    if (cpu->trace_out)
+    {
+        status = run_binary_trace(cpu);
+    }
+    else if (cpu->kanata_out)
+    {
+        status = run_kanata(cpu);
+    }
+    else if (!cpu->debug_messages && !cpu->single_step)
+    {
+        status = run_headless(cpu);
+    }
+    else
+    {
+        status = run_interactive(cpu);
+    }
+
+    if (cpu->quiet)
+    {
+        return status;
+    }
+    switch (status)
+    {
+    case APEX_RUN_HALTED:
+        printf("APEX_CPU: Simulation Complete, cycles = %d instructions = %d\n", cpu->clock, cpu->insn_completed);
+        break;
+    case APEX_RUN_STOPPED:
+        printf("APEX_CPU: Simulation Stopped, cycles = %d instructions = %d\n", cpu->clock, cpu->insn_completed);
+        break;
+    case APEX_RUN_CYCLE_LIMIT:
+        printf("APEX_CPU: Cycle limit reached, cycles = %d instructions = %d\n", cpu->clock, cpu->insn_completed);
+        break;
+    case APEX_RUN_INSN_LIMIT:
+        printf("APEX_CPU: Instruction limit reached, cycles = %d instructions = %d\n", cpu->clock, cpu->insn_completed);
+        break;
+    case APEX_RUN_FAULT:
+        fprintf(stderr, "APEX_Error: Bad data address or division by zero at pc %d\n", cpu->fault_pc);
+        printf("APEX_CPU: Simulation Stopped on a fault, cycles = %d instructions = %d\n", cpu->clock, cpu->insn_completed);
+        break;
+    }
+    if (cpu->trace_out || cpu->kanata_out || (!cpu->debug_messages && !cpu->single_step))
+    {
+        printf("APEX_CPU: IPC = %.3f\n", cpu->clock ? (double)cpu->insn_completed / cpu->clock : 0.0);
+        print_reg_file(cpu);
+    }
+    return status;
+}
+
+/* Cycle limit of the pipeline, which counts cycles in an int */
+static int
+cycle_cap(long long cycles)
+{
+    return cycles < INT_MAX ? (int)cycles : INT_MAX;
+}
+
+/*
+ * Runs the pipeline quietly, from wherever cpu is, until start instructions
+ * have executed - warming it up on those not fast-forwarded - and measures
+ * the next insns. Fast-forwarded instructions count toward start. Each part
+ * gives up after APEX_MEASURE_MAX_CPI cycles per instruction, e.g. once the
+ * program has run off its end. Returns FALSE if nothing retired in the
+ * measured part.
+ */
+int
+APEX_cpu_measure(APEX_CPU *cpu, long long start, long long insns, long long *cycles, long long *retired)
+{
+    long long done = cpu->insn_fast_forwarded + cpu->insn_completed;
+    long long c0;
+
+    cpu->single_step = 0;
+    cpu->debug_messages = 0;
+    cpu->quiet = 1;
+    if (start > done)
+    {
+        cpu->max_insns = start;
+        cpu->max_cycles = cycle_cap(cpu->clock + (start - done) * APEX_MEASURE_MAX_CPI + 1000);
+        APEX_cpu_run(cpu);
+    }
+
+    c0 = cpu->clock;
+    done = cpu->insn_fast_forwarded + cpu->insn_completed;
+    cpu->max_insns = start + insns;
+    cpu->max_cycles = cycle_cap(c0 + insns * APEX_MEASURE_MAX_CPI + 1000);
+    APEX_cpu_run(cpu);
+    *cycles = cpu->clock - c0;
+    *retired = cpu->insn_fast_forwarded + cpu->insn_completed - done;
+    return *retired > 0;
+}
+
+void APEX_cpu_stop(APEX_CPU *cpu)
+{
+    dispose(&cpu->issue_queue);
+    dispose(&cpu->load_store_queue);
+    dispose(&cpu->reorder_buffer);
+    free_list_dispose(&cpu->preg_free_list);
+    dispose_btb(cpu->btb_head);
+    APEX_image_unmap(cpu);
+    free(cpu->data_memory);
+    free(cpu);
 }
\ No newline at end of file
@@ -9,12 +9,17 @@
 #ifndef _APEX_CPU_H_
 #define _APEX_CPU_H_
 
+#include "apex_config.h"
 #include "apex_macros.h"
+#include "UDstructs.h"
+
+/* RAT value for a register whose committed value lives in the architectural
+ * register file: the physical register past the last, which is always valid */
+#define PREG_ARCH(cpu) ((cpu)->config.pregs)
 
 /* Format of an APEX instruction  */
 typedef struct APEX_Instruction
 {
-    char opcode_str[128];
     int opcode;
     int rd;
     int rs1;
@@ -22,34 +27,35 @@ typedef struct APEX_Instruction
     int imm;
 } APEX_Instruction;
 
-/* Model of CPU stage latch */
+/* Model of CPU stage latch
+ *
+ * Every pipeline latch and queue entry carries one of these compact
+ * micro-ops by value, so it is kept small. The mnemonic is not stored; the
+ * printers look it up in APEX_opcode_names by opcode. */
 typedef struct CPU_Stage
 {
-    int trial;
     int pc;
-    char opcode_str[128];
-    int opcode;
-    int rs1;
-    int rs2;
-    int rd;
-    int ps1;
-    int ps2;
-    int pd;
     int imm;
-    int rs1_value;
-    int rs2_value;
-    int rd_value;
     int ps1_value;
     int ps2_value;
     int result_buffer;
-    int memory_address;
-    int has_insn;
-    int stalled;
-    int flush;
-    int instype;
-
-    // int zero_flag;
-
+    unsigned int seq; /* Kanata id of the dynamic instruction, set only while logging */
+    short ps1;
+    short ps2;
+    short pd;
+    short prev_pd; /* Mapping of rd that pd replaced at rename */
+    short rob_tag;  /* Slot of the instruction in the reorder buffer */
+    short flag_tag; /* BZ/BNZ: ROB tag of the CMP still owing the flag, or -1 */
+    unsigned char opcode;
+    signed char rs1;
+    signed char rs2;
+    signed char rd;
+    unsigned char has_insn;
+    unsigned char stalled;
+    unsigned char flush;
+    unsigned char completed; /* ROB entry: result produced, may retire */
+    unsigned char mem_ready; /* ROB entry: memory address computed */
+    unsigned char fault;     /* ROB entry: address outside data memory, or division by zero */
 } CPU_Stage;
 
 /* Model of APEX CPU */
@@ -57,31 +63,37 @@ typedef struct APEX_CPU
 {
     int pc;                  /* Current program counter */
     int clock;               /* Clock cycles elapsed */
+    APEX_Config config;      /* Sizes the structures below were created with */
     int insn_completed;      /* Instructions retired */
+    long long insn_fast_forwarded; /* Instructions run by the functional interpreter before the pipeline */
     int regs[REG_FILE_SIZE]; /* Integer register file */
     int regs_valid[REG_FILE_SIZE];
-    int pregs_valid[PREGS_FILE_SIZE];
-    int mem_valid[4096];
+    int pregs_valid[PREGS_MAX + 1];
     int code_memory_size;              /* Number of instruction in the input file */
     APEX_Instruction *code_memory;     /* Code Memory */
-    int data_memory[DATA_MEMORY_SIZE]; /* Data Memory */
+    void *code_map;                    /* Program image code_memory points into, or NULL if it is malloc'd */
+    long long code_map_size;
+    int *data_memory;                  /* Data Memory, config.data_memory_size words */
     int single_step;                   /* Wait for user input after every cycle */
+    int debug_messages;                /* Print pipeline contents every cycle */
+    int quiet;                         /* Print nothing at all, e.g. in batch runs */
+    int max_cycles;                    /* Stop after this many cycles, 0 for no limit */
+    long long max_insns;               /* Stop once this many instructions have executed, 0 for no limit */
+    struct APEX_Trace *trace_out;      /* Binary trace being recorded, or NULL */
+    struct APEX_Kanata *kanata_out;    /* Kanata pipeline log being written, or NULL */
+    struct APEX_Stats *stats;          /* Statistics being gathered, or NULL */
+    int dispatch_stall;                /* STALL_* outcome of dispatch this cycle */
+    int branch_refill;                 /* A taken BZ/BNZ flushed the ROB's younger entries, none has come since */
+    int skip_idle;                     /* Headless runs jump over cycles that only move the MUL chain */
+    int cycles_skipped;                /* Cycles run that way */
+    int last_retire;                   /* Cycle the last instruction retired on */
     int zero_flag;
-    int branch_taken_stage; /* {TRUE, FALSE} Used by BZ and BNZ to branch */
     int fetch_from_next_cycle;
-    int renameTableValues[PREGS_FILE_SIZE + 1];
-    int branch_taken;
-    int jump_inst;
-    int jumpval[60000];
-    int cmp_completed;
-    int mulstage;
-    int mreadybit[60000];
-    int lsInstComplete[60000];
-    int cmpvalue[60000];
-    int branchreadybit[60000];
-    int intbusy;
-    int mulbusy;
-    int branchcomplete;
+    int renameTableValues[PREGS_MAX + 1];
+    int rat[REG_FILE_SIZE]; /* Architectural to physical map, PREG_ARCH once committed */
+    int jump_inst; /* A JUMP is in flight, fetch waits for its target */
+    int halt_inst; /* A HALT was decoded, nothing more is fetched */
+    int fault_pc;  /* Instruction that stopped the run with APEX_RUN_FAULT, or -1 */
     /* Pipeline stages */
     CPU_Stage fetch;
     CPU_Stage decode;
@@ -100,11 +112,23 @@ typedef struct APEX_CPU
     CPU_Stage rob;
     CPU_Stage lsq;
     // CPU_Stage memory2;
+
+    /* Out-of-order structures */
+    inst_queue issue_queue;
+    inst_queue load_store_queue;
+    inst_queue reorder_buffer;
+    free_list preg_free_list;
+    btb_buffer *btb_head;
 } APEX_CPU;
 
+extern const char *const APEX_opcode_names[OPCODE_COUNT];
+
 APEX_Instruction *create_code_memory(const char *filename, int *size);
-APEX_CPU *APEX_cpu_init(const char *filename);
-void APEX_cpu_run(APEX_CPU *cpu);
+APEX_CPU *APEX_cpu_create(const APEX_Config *config);
+APEX_CPU *APEX_cpu_init(const char *filename, const APEX_Config *config);
+CPU_Stage *APEX_mul_entry(APEX_CPU *cpu);
+int APEX_cpu_run(APEX_CPU *cpu);
+int APEX_cpu_measure(APEX_CPU *cpu, long long start, long long insns, long long *cycles, long long *retired);
 // int APEX_run_at_choice(APEX_CPU *cpu, int z);
 void APEX_cpu_stop(APEX_CPU *cpu);
 #endif
@@ -0,0 +1,576 @@
+/*
+ * apex_dse.c
+ * Builds the design points of a sweep, simulates them on the batch pool
+ * and finds the Pareto frontier
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apex_dse.h"
+#include "apex_macros.h"
+
+/* xorshift64*, as in apex_simpoint.c: the same seed gives the same sample
+ * on every host */
+static unsigned long long
+next_random(unsigned long long *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+static double
+random_unit(unsigned long long *state)
+{
+    return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Sets the value of range r in config; the values were checked when the
+ * range was added */
+static void
+apply_value(APEX_Config *config, const APEX_DSE_Range *r, int value)
+{
+    char setting[64];
+
+    snprintf(setting, sizeof(setting), "%s=%d", r->key, value);
+    APEX_config_set(config, setting, "");
+}
+
+void
+APEX_dse_init(APEX_DSE *dse, const APEX_Config *base)
+{
+    memset(dse, 0, sizeof(*dse));
+    dse->base = *base;
+}
+
+static int
+add_value(APEX_DSE_Range *r, long v, const char *spec)
+{
+    if (r->count == DSE_MAX_VALUES)
+    {
+        fprintf(stderr, "APEX_Error: %s has more than %d values\n", spec, DSE_MAX_VALUES);
+        return -1;
+    }
+    r->values[r->count++] = (int)v;
+    return 0;
+}
+
+/*
+ * Adds a swept key from key=VALUES, where VALUES is a comma-separated list,
+ * LO:HI for every integer from LO to HI, LO:HI:STEP, or LO:HI:*F for LO
+ * multiplied by F up to HI. Every value must be one --set would take.
+ */
+int
+APEX_dse_add_range(APEX_DSE *dse, const char *spec)
+{
+    const char *eq = strchr(spec, '=');
+    APEX_DSE_Range *r;
+    APEX_Config check = dse->base;
+    const char *p;
+    char *end;
+    int i;
+
+    if (!eq || eq == spec || (size_t)(eq - spec) >= sizeof(r->key))
+    {
+        fprintf(stderr, "APEX_Error: Range %s is not of the form key=VALUES\n", spec);
+        return -1;
+    }
+    if (dse->dims == DSE_MAX_DIMS)
+    {
+        fprintf(stderr, "APEX_Error: At most %d keys can be swept\n", DSE_MAX_DIMS);
+        return -1;
+    }
+    r = &dse->ranges[dse->dims];
+    memset(r, 0, sizeof(*r));
+    memcpy(r->key, spec, eq - spec);
+    for (i = 0; i < dse->dims; ++i)
+    {
+        if (strcmp(dse->ranges[i].key, r->key) == 0)
+        {
+            fprintf(stderr, "APEX_Error: %s is swept twice\n", r->key);
+            return -1;
+        }
+    }
+
+    p = eq + 1;
+    if (strchr(p, ':'))
+    {
+        long lo, hi, step = 1, v;
+        int geometric = FALSE;
+
+        lo = strtol(p, &end, 10);
+        if (end == p || *end != ':')
+        {
+            goto bad;
+        }
+        p = end + 1;
+        hi = strtol(p, &end, 10);
+        if (end == p || (*end != ':' && *end != '\0'))
+        {
+            goto bad;
+        }
+        if (*end == ':')
+        {
+            p = end + 1;
+            if (*p == '*')
+            {
+                geometric = TRUE;
+                p++;
+            }
+            step = strtol(p, &end, 10);
+            if (end == p || *end != '\0' || step < (geometric ? 2 : 1))
+            {
+                goto bad;
+            }
+        }
+        if (lo > hi || lo < 1)
+        {
+            goto bad;
+        }
+        for (v = lo; v <= hi; v = geometric ? v * step : v + step)
+        {
+            if (add_value(r, v, spec) < 0)
+            {
+                return -1;
+            }
+        }
+    }
+    else
+    {
+        while (TRUE)
+        {
+            long v = strtol(p, &end, 10);
+
+            if (end == p || (*end != ',' && *end != '\0'))
+            {
+                goto bad;
+            }
+            if (add_value(r, v, spec) < 0)
+            {
+                return -1;
+            }
+            if (*end == '\0')
+            {
+                break;
+            }
+            p = end + 1;
+        }
+    }
+
+    for (i = 0; i < r->count; ++i)
+    {
+        char setting[64];
+
+        snprintf(setting, sizeof(setting), "%s=%d", r->key, r->values[i]);
+        if (APEX_config_set(&check, setting, "--range ") < 0)
+        {
+            return -1;
+        }
+    }
+    dse->dims++;
+    return 0;
+
+bad:
+    fprintf(stderr, "APEX_Error: Range %s: values must be a list a,b,c or LO:HI[:STEP | :*FACTOR] from 1 up\n", spec);
+    return -1;
+}
+
+/* Appends the point with the given value indices */
+static void
+add_point(APEX_DSE *dse, const int *index)
+{
+    APEX_DSE_Point *pt = &dse->points[dse->count++];
+    int d;
+
+    memset(pt, 0, sizeof(*pt));
+    pt->config = dse->base;
+    for (d = 0; d < dse->dims; ++d)
+    {
+        pt->index[d] = index[d];
+        apply_value(&pt->config, &dse->ranges[d], dse->ranges[d].values[index[d]]);
+    }
+    pt->area = APEX_dse_area(&pt->config);
+}
+
+/* Orders points by their value indices, the first range most significant */
+static int
+by_index(const void *a, const void *b)
+{
+    const APEX_DSE_Point *x = a;
+    const APEX_DSE_Point *y = b;
+    int d;
+
+    for (d = 0; d < DSE_MAX_DIMS; ++d)
+    {
+        if (x->index[d] != y->index[d])
+        {
+            return x->index[d] < y->index[d] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/* Every combination of the ranges' values. Returns the number of points. */
+int
+APEX_dse_cross(APEX_DSE *dse)
+{
+    int index[DSE_MAX_DIMS] = {0};
+    long long total = 1;
+    int d;
+
+    for (d = 0; d < dse->dims; ++d)
+    {
+        total *= dse->ranges[d].count;
+        if (total > DSE_MAX_POINTS)
+        {
+            fprintf(stderr, "APEX_Error: The cross product has more than %d points; sample it with --sample\n",
+                    DSE_MAX_POINTS);
+            return -1;
+        }
+    }
+    dse->points = calloc(total, sizeof(APEX_DSE_Point));
+    if (!dse->points)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory building design points\n");
+        return -1;
+    }
+
+    /* Counts through the indices like an odometer, the last range fastest */
+    while (TRUE)
+    {
+        add_point(dse, index);
+        for (d = dse->dims - 1; d >= 0; --d)
+        {
+            if (++index[d] < dse->ranges[d].count)
+            {
+                break;
+            }
+            index[d] = 0;
+        }
+        if (d < 0)
+        {
+            break;
+        }
+    }
+    return dse->count;
+}
+
+/* A Latin-hypercube sample of n points, in the order of the cross product.
+ * Points that fall on the same values are kept once, so there may be
+ * fewer. Returns their number. */
+int
+APEX_dse_sample(APEX_DSE *dse, int n, unsigned long long seed)
+{
+    int *strata[DSE_MAX_DIMS];
+    unsigned long long state = seed ? seed : DSE_SEED;
+    int i, d;
+
+    if (n < 1 || n > DSE_MAX_POINTS)
+    {
+        fprintf(stderr, "APEX_Error: The sample size must be from 1 to %d\n", DSE_MAX_POINTS);
+        return -1;
+    }
+    dse->points = calloc(n, sizeof(APEX_DSE_Point));
+    if (!dse->points)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory building design points\n");
+        return -1;
+    }
+
+    /* Each range gets its own shuffle of the n strata */
+    for (d = 0; d < dse->dims; ++d)
+    {
+        strata[d] = malloc(n * sizeof(int));
+        if (!strata[d])
+        {
+            fprintf(stderr, "APEX_Error: Out of memory building design points\n");
+            exit(1);
+        }
+        for (i = 0; i < n; ++i)
+        {
+            strata[d][i] = i;
+        }
+        for (i = n - 1; i > 0; --i)
+        {
+            int j = (int)(next_random(&state) % (unsigned long long)(i + 1));
+            int t = strata[d][i];
+
+            strata[d][i] = strata[d][j];
+            strata[d][j] = t;
+        }
+    }
+
+    /* Point i takes a random place in its stratum of every range */
+    for (i = 0; i < n; ++i)
+    {
+        int index[DSE_MAX_DIMS];
+
+        for (d = 0; d < dse->dims; ++d)
+        {
+            double at = (strata[d][i] + random_unit(&state)) / n;
+
+            index[d] = (int)(at * dse->ranges[d].count);
+            if (index[d] >= dse->ranges[d].count)
+            {
+                index[d] = dse->ranges[d].count - 1;
+            }
+        }
+        add_point(dse, index);
+    }
+
+    for (d = 0; d < dse->dims; ++d)
+    {
+        free(strata[d]);
+    }
+
+    qsort(dse->points, dse->count, sizeof(APEX_DSE_Point), by_index);
+    for (i = 1, n = 1; i < dse->count; ++i)
+    {
+        if (by_index(&dse->points[i], &dse->points[n - 1]) != 0)
+        {
+            dse->points[n++] = dse->points[i];
+        }
+    }
+    dse->count = n;
+    return dse->count;
+}
+
+double
+APEX_dse_area(const APEX_Config *config)
+{
+    return DSE_AREA_IQ * config->iq_size + DSE_AREA_ROB * config->rob_size + DSE_AREA_LSQ * config->lsq_size +
+           DSE_AREA_PREG * config->pregs + DSE_AREA_MUL * MUL_STAGES_MAX / config->mul_stages;
+}
+
+/* Marks the points no other point beats on both area and IPC. Sorted by
+ * area, then by IPC from the best, a point is on the frontier if its IPC
+ * is above that of every point before it, and above zero. */
+static int
+by_area(const void *a, const void *b)
+{
+    const APEX_DSE_Point *x = *(const APEX_DSE_Point *const *)a;
+    const APEX_DSE_Point *y = *(const APEX_DSE_Point *const *)b;
+
+    if (x->area != y->area)
+    {
+        return x->area < y->area ? -1 : 1;
+    }
+    if (x->ipc != y->ipc)
+    {
+        return x->ipc > y->ipc ? -1 : 1;
+    }
+    return x < y ? -1 : 1;
+}
+
+static void
+mark_pareto(APEX_DSE *dse)
+{
+    APEX_DSE_Point **order = malloc(dse->count * sizeof(APEX_DSE_Point *));
+    double best = 0.0;
+    int i;
+
+    if (!order)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory ranking design points\n");
+        exit(1);
+    }
+    for (i = 0; i < dse->count; ++i)
+    {
+        order[i] = &dse->points[i];
+    }
+    qsort(order, dse->count, sizeof(APEX_DSE_Point *), by_area);
+    for (i = 0; i < dse->count; ++i)
+    {
+        if (!order[i]->failed && order[i]->ipc > best)
+        {
+            order[i]->pareto = TRUE;
+            best = order[i]->ipc;
+        }
+    }
+    free(order);
+}
+
+/*
+ * Simulates every point on every workload, on threads workers or one per
+ * online CPU if threads is 0. A workload's own settings hold unless the
+ * sweep changes the same key.
+ */
+int
+APEX_dse_run(APEX_DSE *dse, int threads)
+{
+    const int nwork = dse->workloads.count;
+    APEX_Batch batch;
+    int i, w, d;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.config = dse->base;
+    batch.jobs = calloc((size_t)dse->count * nwork, sizeof(APEX_Job));
+    if (!batch.jobs)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory starting the sweep\n");
+        return -1;
+    }
+    for (i = 0; i < dse->count; ++i)
+    {
+        for (w = 0; w < nwork; ++w)
+        {
+            const APEX_Job *work = &dse->workloads.jobs[w];
+            APEX_Job *job = &batch.jobs[batch.count++];
+
+            job->filename = strdup(work->filename);
+            job->max_cycles = work->max_cycles;
+            job->fast_forward = work->fast_forward;
+            job->config = work->config;
+            for (d = 0; d < dse->dims; ++d)
+            {
+                apply_value(&job->config, &dse->ranges[d], dse->ranges[d].values[dse->points[i].index[d]]);
+            }
+        }
+    }
+
+    APEX_batch_run(&batch, threads);
+    dse->threads = batch.threads;
+    dse->seconds = batch.seconds;
+
+    for (i = 0; i < dse->count; ++i)
+    {
+        APEX_DSE_Point *pt = &dse->points[i];
+        double log_sum = 0.0;
+
+        pt->failed = 0;
+        for (w = 0; w < nwork; ++w)
+        {
+            const APEX_Job *job = &batch.jobs[(size_t)i * nwork + w];
+
+            if (job->status == APEX_JOB_FAILED || job->status == APEX_JOB_STUCK || job->cycles == 0 ||
+                job->insns == 0)
+            {
+                pt->failed++;
+                continue;
+            }
+            log_sum += log((double)job->insns / job->cycles);
+        }
+        pt->ipc = pt->failed ? 0.0 : exp(log_sum / nwork);
+    }
+    APEX_batch_free(&batch);
+    mark_pareto(dse);
+    return 0;
+}
+
+/* The swept values of a point, as key=value pairs */
+static void
+format_point(const APEX_DSE *dse, const APEX_DSE_Point *pt, char *buf, size_t size)
+{
+    size_t len = 0;
+    int d;
+
+    buf[0] = '\0';
+    for (d = 0; d < dse->dims && len < size; ++d)
+    {
+        len += snprintf(buf + len, size - len, "%s%s=%d", d ? " " : "", dse->ranges[d].key,
+                        dse->ranges[d].values[pt->index[d]]);
+    }
+}
+
+static void
+print_point(const APEX_DSE *dse, const APEX_DSE_Point *pt)
+{
+    char settings[512];
+
+    format_point(dse, pt, settings, sizeof(settings));
+    if (pt->failed)
+    {
+        printf("%-6d %9.1f %7s %c  %s (%d workloads failed)\n", (int)(pt - dse->points), pt->area, "-",
+               ' ', settings, pt->failed);
+        return;
+    }
+    printf("%-6d %9.1f %7.3f %c  %s\n", (int)(pt - dse->points), pt->area, pt->ipc, pt->pareto ? '*' : ' ',
+           settings);
+}
+
+void
+APEX_dse_report(const APEX_DSE *dse)
+{
+    const APEX_DSE_Point **frontier = malloc(dse->count * sizeof(APEX_DSE_Point *));
+    char base[512];
+    int count = 0;
+    int i;
+
+    if (!frontier)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory printing the sweep\n");
+        exit(1);
+    }
+    printf("%-6s %9s %7s %c  %s\n", "Point", "Area", "IPC", 'P', "Settings");
+    for (i = 0; i < dse->count; ++i)
+    {
+        print_point(dse, &dse->points[i]);
+        if (dse->points[i].pareto)
+        {
+            frontier[count++] = &dse->points[i];
+        }
+    }
+
+    APEX_config_format(&dse->base, NULL, base, sizeof(base));
+    printf("APEX_DSE: %d points x %d workloads = %d simulations on %d threads in %.3f s\n", dse->count,
+           dse->workloads.count, dse->count * dse->workloads.count, dse->threads, dse->seconds);
+    printf("APEX_DSE: base configuration %s\n", base);
+    printf("APEX_DSE: Pareto frontier (*), %d points by area\n", count);
+
+    /* Along the frontier, IPC rises with area */
+    qsort(frontier, count, sizeof(APEX_DSE_Point *), by_area);
+    printf("%-6s %9s %7s %c  %s\n", "Point", "Area", "IPC", ' ', "Settings");
+    for (i = 0; i < count; ++i)
+    {
+        print_point(dse, frontier[i]);
+    }
+    free(frontier);
+}
+
+int
+APEX_dse_write_csv(const APEX_DSE *dse, const char *filename)
+{
+    FILE *fp = fopen(filename, "w");
+    int i, d;
+
+    if (!fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to create %s\n", filename);
+        return -1;
+    }
+    fprintf(fp, "point");
+    for (d = 0; d < dse->dims; ++d)
+    {
+        fprintf(fp, ",%s", dse->ranges[d].key);
+    }
+    fprintf(fp, ",area,ipc,failed,pareto\n");
+    for (i = 0; i < dse->count; ++i)
+    {
+        const APEX_DSE_Point *pt = &dse->points[i];
+
+        fprintf(fp, "%d", i);
+        for (d = 0; d < dse->dims; ++d)
+        {
+            fprintf(fp, ",%d", dse->ranges[d].values[pt->index[d]]);
+        }
+        fprintf(fp, ",%.1f,%.4f,%d,%d\n", pt->area, pt->ipc, pt->failed, pt->pareto);
+    }
+    if (fclose(fp) != 0)
+    {
+        fprintf(stderr, "APEX_Error: Unable to write %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+void
+APEX_dse_free(APEX_DSE *dse)
+{
+    APEX_batch_free(&dse->workloads);
+    free(dse->points);
+    dse->points = NULL;
+    dse->count = 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * apex_dse.h
+ * Design-space exploration: one workload set simulated at many
+ * configurations, ranked by IPC against an area proxy
+ *
+ * Each swept key of apex_config.h takes a list of values. The design
+ * points are their full cross product, or a Latin-hypercube sample of it:
+ * N points in which every key's range is cut into N equal strata and each
+ * stratum is used exactly once. Every point runs every workload as one job
+ * of a batch, so the whole sweep shares the work-stealing pool of
+ * apex_batch.h. A point scores the geometric mean of its workloads' IPC.
+ *
+ * The area proxy counts every structure in units of one ROB entry. Issue
+ * queue and LSQ entries are searched associatively every cycle (wakeup,
+ * address match), so they cost more than the ROB's indexed storage; a
+ * physical register adds a register file word and its rename tag. The
+ * multiplier does the same work in fewer stages with proportionally more
+ * logic per stage. Data memory is not part of the core and is not counted.
+ *
+ * A point is on the Pareto frontier if no other point has at least its
+ * IPC with less area, or more IPC with no more area.
+ */
+#ifndef _APEX_DSE_H_
+#define _APEX_DSE_H_
+
+#include "apex_batch.h"
+#include "apex_config.h"
+
+#define DSE_MAX_DIMS 8
+#define DSE_MAX_VALUES 64
+#define DSE_MAX_POINTS 100000
+#define DSE_SEED 0x2545f4914f6cdd1dULL
+
+/* Area proxy weights, per entry, register or MUL pipeline */
+#define DSE_AREA_IQ 4.0
+#define DSE_AREA_ROB 1.0
+#define DSE_AREA_LSQ 3.0
+#define DSE_AREA_PREG 1.5
+#define DSE_AREA_MUL 24.0 /* At MUL_STAGES_MAX stages; scales as MUL_STAGES_MAX / mul_stages */
+
+/* Values one key is swept over */
+typedef struct APEX_DSE_Range
+{
+    char key[32];
+    int values[DSE_MAX_VALUES];
+    int count;
+} APEX_DSE_Range;
+
+typedef struct APEX_DSE_Point
+{
+    int index[DSE_MAX_DIMS]; /* Value of each range, as an index into it */
+    APEX_Config config;      /* The base configuration with the swept values */
+    double area;
+    double ipc;   /* Geometric mean over the workloads */
+    int failed;   /* Workloads that could not run, got stuck or retired nothing */
+    int pareto;
+} APEX_DSE_Point;
+
+typedef struct APEX_DSE
+{
+    APEX_Config base;
+    APEX_DSE_Range ranges[DSE_MAX_DIMS];
+    int dims;
+    APEX_Batch workloads; /* Job list, never run itself */
+    APEX_DSE_Point *points;
+    int count;
+    int threads;
+    double seconds;
+} APEX_DSE;
+
+void APEX_dse_init(APEX_DSE *dse, const APEX_Config *base);
+int APEX_dse_add_range(APEX_DSE *dse, const char *spec);
+int APEX_dse_cross(APEX_DSE *dse);
+int APEX_dse_sample(APEX_DSE *dse, int n, unsigned long long seed);
+double APEX_dse_area(const APEX_Config *config);
+int APEX_dse_run(APEX_DSE *dse, int threads);
+void APEX_dse_report(const APEX_DSE *dse);
+int APEX_dse_write_csv(const APEX_DSE *dse, const char *filename);
+void APEX_dse_free(APEX_DSE *dse);
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * apex_dse_main.c
+ * apex_dse: sweeps the microarchitecture configuration over a workload set
+ * and reports IPC against area with the Pareto frontier
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apex_dse.h"
+
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr, "APEX_Help: Usage %s --range key=VALUES... [--sample N [--seed S]] [--threads N] [--max-cycles N]\n", prog);
+    fprintf(stderr, "           %*s [--config FILE] [--set key=value]... [--out FILE] <job_list>\n", (int)strlen(prog), "");
+    fprintf(stderr, "           VALUES is a,b,c or LO:HI[:STEP] or LO:HI:*FACTOR\n");
+}
+
+int
+main(int argc, char const *argv[])
+{
+    APEX_Config base;
+    APEX_DSE dse;
+    const char *ranges[DSE_MAX_DIMS];
+    const char *job_list = NULL;
+    const char *out = NULL;
+    int nranges = 0;
+    int sample = 0;
+    unsigned long long seed = 0;
+    int threads = 0;
+    int max_cycles = APEX_BATCH_MAX_CYCLES;
+    int i, count;
+
+    APEX_config_defaults(&base);
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--range") == 0 && i + 1 < argc)
+        {
+            if (nranges == DSE_MAX_DIMS)
+            {
+                fprintf(stderr, "APEX_Error: At most %d keys can be swept\n", DSE_MAX_DIMS);
+                exit(1);
+            }
+            ranges[nranges++] = argv[++i];
+        }
+        else if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc)
+        {
+            sample = atoi(argv[++i]);
+            if (sample < 1)
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoull(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-cycles") == 0 && i + 1 < argc)
+        {
+            max_cycles = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--config") == 0 && i + 1 < argc)
+        {
+            if (APEX_config_load(&base, argv[++i]) < 0)
+            {
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--set") == 0 && i + 1 < argc)
+        {
+            if (APEX_config_set(&base, argv[++i], "--set ") < 0)
+            {
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            out = argv[++i];
+        }
+        else if (!job_list && argv[i][0] != '-')
+        {
+            job_list = argv[i];
+        }
+        else
+        {
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+    if (!job_list || nranges == 0)
+    {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    /* The ranges are checked against the final base configuration */
+    APEX_dse_init(&dse, &base);
+    for (i = 0; i < nranges; ++i)
+    {
+        if (APEX_dse_add_range(&dse, ranges[i]) < 0)
+        {
+            exit(1);
+        }
+    }
+    if (APEX_batch_load(&dse.workloads, job_list, max_cycles, &base) < 0)
+    {
+        exit(1);
+    }
+    if (dse.workloads.count == 0)
+    {
+        fprintf(stderr, "APEX_Error: %s has no workloads\n", job_list);
+        exit(1);
+    }
+
+    count = sample ? APEX_dse_sample(&dse, sample, seed) : APEX_dse_cross(&dse);
+    if (count < 0 || APEX_dse_run(&dse, threads) < 0)
+    {
+        APEX_dse_free(&dse);
+        exit(1);
+    }
+    APEX_dse_report(&dse);
+    if (out && APEX_dse_write_csv(&dse, out) == 0)
+    {
+        printf("APEX_DSE: results written to %s\n", out);
+    }
+    APEX_dse_free(&dse);
+    return 0;
+}
@@ -0,0 +1,250 @@
+/*
+ * apex_functional.c
+ * Architectural interpreter: executes instructions straight from code
+ * memory with the semantics the pipeline commits, and nothing else
+ */
+#include <stdio.h>
+
+#include "apex_functional.h"
+
+/* TRUE if addr names one of the mem_size words of data memory */
+static int
+data_address_ok(int addr, int mem_size)
+{
+    return addr >= 0 && addr < mem_size;
+}
+
+/*
+ * Executes up to max_insns instructions from cpu->pc and leaves the
+ * architectural state where the last one put it. cpu->pc is the next
+ * instruction to run, or the faulting one after APEX_FUNC_FAULT.
+ *
+ * The register file is worked on in a local copy, which the compiler can
+ * keep apart from data memory, and written back once at the end.
+ *
+ * Expanded once per caller: with bbv NULL the plain run carries no
+ * profiling code, otherwise every instruction adds one to bbv[block_of[i]].
+ */
+static inline __attribute__((always_inline)) int
+functional_loop(APEX_CPU *cpu, long long max_insns, const int *block_of, unsigned int *bbv)
+{
+    const APEX_Instruction *code = cpu->code_memory;
+    const int code_size = cpu->code_memory_size;
+    int *mem = cpu->data_memory;
+    const int mem_size = cpu->config.data_memory_size;
+    int regs[REG_FILE_SIZE];
+    int pc = cpu->pc;
+    int flag = cpu->zero_flag;
+    int status = APEX_FUNC_LIMIT;
+    long long n = 0;
+    int i;
+
+    for (i = 0; i < REG_FILE_SIZE; ++i)
+    {
+        regs[i] = cpu->regs[i];
+    }
+
+    while (n < max_insns)
+    {
+        /* Same pc to slot mapping as fetch */
+        int index = (pc - 4000) / 4;
+        const APEX_Instruction *ins;
+        int addr;
+
+        if (index < 0 || index >= code_size)
+        {
+            status = APEX_FUNC_OFF_END;
+            break;
+        }
+        ins = &code[index];
+        if (bbv)
+        {
+            bbv[block_of[index]]++;
+        }
+
+        switch (ins->opcode)
+        {
+        case OPCODE_ADD:
+            regs[ins->rd] = regs[ins->rs1] + regs[ins->rs2];
+            break;
+        case OPCODE_SUB:
+            regs[ins->rd] = regs[ins->rs1] - regs[ins->rs2];
+            break;
+        case OPCODE_MUL:
+            regs[ins->rd] = regs[ins->rs1] * regs[ins->rs2];
+            break;
+        case OPCODE_DIV:
+            if (regs[ins->rs2] == 0)
+            {
+                status = APEX_FUNC_FAULT;
+                goto out;
+            }
+            regs[ins->rd] = regs[ins->rs1] / regs[ins->rs2];
+            break;
+        case OPCODE_AND:
+            regs[ins->rd] = regs[ins->rs1] & regs[ins->rs2];
+            break;
+        case OPCODE_OR:
+            regs[ins->rd] = regs[ins->rs1] | regs[ins->rs2];
+            break;
+        case OPCODE_XOR:
+            regs[ins->rd] = regs[ins->rs1] ^ regs[ins->rs2];
+            break;
+        case OPCODE_ADDL:
+            regs[ins->rd] = regs[ins->rs1] + ins->imm;
+            break;
+        case OPCODE_SUBL:
+            regs[ins->rd] = regs[ins->rs1] - ins->imm;
+            break;
+        case OPCODE_MOVC:
+            regs[ins->rd] = ins->imm;
+            break;
+        case OPCODE_CMP:
+            /* The difference only goes to the flag; rd reads as zero */
+            flag = regs[ins->rs1] - regs[ins->rs2];
+            regs[ins->rd] = 0;
+            break;
+        case OPCODE_LOAD:
+            addr = regs[ins->rs1] + ins->imm;
+            if (!data_address_ok(addr, mem_size))
+            {
+                status = APEX_FUNC_FAULT;
+                goto out;
+            }
+            regs[ins->rd] = mem[addr];
+            break;
+        case OPCODE_LDR:
+            addr = regs[ins->rs1] + regs[ins->rs2];
+            if (!data_address_ok(addr, mem_size))
+            {
+                status = APEX_FUNC_FAULT;
+                goto out;
+            }
+            regs[ins->rd] = mem[addr];
+            break;
+        case OPCODE_STORE:
+            addr = regs[ins->rs2] + ins->imm;
+            if (!data_address_ok(addr, mem_size))
+            {
+                status = APEX_FUNC_FAULT;
+                goto out;
+            }
+            mem[addr] = regs[ins->rs1];
+            break;
+        case OPCODE_STR:
+            addr = regs[ins->rs1] + regs[ins->rs2];
+            if (!data_address_ok(addr, mem_size))
+            {
+                status = APEX_FUNC_FAULT;
+                goto out;
+            }
+            mem[addr] = regs[ins->rd];
+            break;
+        case OPCODE_BZ:
+            if (flag == 0)
+            {
+                pc += ins->imm;
+                n++;
+                continue;
+            }
+            break;
+        case OPCODE_BNZ:
+            if (flag != 0)
+            {
+                pc += ins->imm;
+                n++;
+                continue;
+            }
+            break;
+        case OPCODE_JUMP:
+            /* Like intfu, the target is relative to the JUMP itself */
+            pc += ins->imm;
+            n++;
+            continue;
+        case OPCODE_HALT:
+            n++;
+            status = APEX_FUNC_HALTED;
+            goto out;
+        default:
+            /* NOP, JAL: retire without effect */
+            break;
+        }
+        pc += 4;
+        n++;
+    }
+
+out:
+    for (i = 0; i < REG_FILE_SIZE; ++i)
+    {
+        cpu->regs[i] = regs[i];
+    }
+    cpu->pc = pc;
+    cpu->zero_flag = flag;
+    cpu->insn_fast_forwarded += n;
+    return status;
+}
+
+int
+APEX_functional_run(APEX_CPU *cpu, long long max_insns)
+{
+    return functional_loop(cpu, max_insns, NULL, NULL);
+}
+
+/* Same as APEX_functional_run, also counting the instructions executed in
+ * each basic block: block_of maps a code memory index to its block */
+int
+APEX_functional_profile(APEX_CPU *cpu, long long max_insns, const int *block_of, unsigned int *bbv)
+{
+    return functional_loop(cpu, max_insns, block_of, bbv);
+}
+
+/*
+ * Splits code memory into basic blocks and writes the block of every
+ * instruction to block_of. A block starts at the first instruction, after
+ * every BZ, BNZ, JUMP and HALT, and at every target of a branch that lies
+ * in the program. Returns the number of blocks.
+ */
+int
+APEX_functional_blocks(const APEX_CPU *cpu, int *block_of)
+{
+    const int size = cpu->code_memory_size;
+    int blocks = 0;
+    int i, target;
+
+    for (i = 0; i < size; ++i)
+    {
+        block_of[i] = 0;
+    }
+    for (i = 0; i < size; ++i)
+    {
+        switch (cpu->code_memory[i].opcode)
+        {
+        case OPCODE_BZ:
+        case OPCODE_BNZ:
+        case OPCODE_JUMP:
+            target = (4 * i + cpu->code_memory[i].imm) / 4;
+            if (target >= 0 && target < size)
+            {
+                block_of[target] = 1;
+            }
+            /* fall through */
+        case OPCODE_HALT:
+            if (i + 1 < size)
+            {
+                block_of[i + 1] = 1;
+            }
+            break;
+        }
+    }
+
+    /* Leader flags become block numbers */
+    for (i = 0; i < size; ++i)
+    {
+        if (i == 0 || block_of[i])
+        {
+            blocks++;
+        }
+        block_of[i] = blocks - 1;
+    }
+    return blocks;
+}
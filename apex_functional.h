@@ -0,0 +1,25 @@
+/*
+ * apex_functional.h
+ * Architectural interpreter of the APEX ISA
+ *
+ * Runs a program one instruction at a time on the architectural state of an
+ * APEX_CPU - pc, regs, zero flag and data memory - with no rename, queues or
+ * timing. The pipeline can take over from wherever it stops, so a run can
+ * fast-forward through a prefix of the program at functional speed.
+ */
+#ifndef _APEX_FUNCTIONAL_H_
+#define _APEX_FUNCTIONAL_H_
+
+#include "apex_cpu.h"
+
+/* Ways APEX_functional_run can end */
+#define APEX_FUNC_LIMIT 0   /* Ran the requested number of instructions */
+#define APEX_FUNC_HALTED 1  /* Executed HALT */
+#define APEX_FUNC_OFF_END 2 /* pc left the program; fetch only finds bubbles there */
+#define APEX_FUNC_FAULT 3   /* Bad data address or division by zero at cpu->pc */
+
+int APEX_functional_run(APEX_CPU *cpu, long long max_insns);
+int APEX_functional_profile(APEX_CPU *cpu, long long max_insns, const int *block_of, unsigned int *bbv);
+int APEX_functional_blocks(const APEX_CPU *cpu, int *block_of);
+
+#endif
@@ -0,0 +1,223 @@
+/*
+ * apex_image.c
+ * Writes predecoded program images and maps them into a CPU
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "apex_image.h"
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+static void
+put_u32(unsigned char *b, unsigned int v)
+{
+    b[0] = v & 0xff;
+    b[1] = (v >> 8) & 0xff;
+    b[2] = (v >> 16) & 0xff;
+    b[3] = v >> 24;
+}
+
+static unsigned int
+get_u32(const unsigned char *b)
+{
+    return b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int)b[3] << 24);
+}
+
+static unsigned int
+checksum(const unsigned char *b, size_t n)
+{
+    unsigned int sum = FNV_OFFSET;
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        sum = (sum ^ b[i]) * FNV_PRIME;
+    }
+    return sum;
+}
+
+/* Records map straight onto APEX_Instruction only on little-endian hosts
+ * with no padding in it */
+static int
+records_are_native(void)
+{
+    const unsigned int one = 1;
+
+    return *(const unsigned char *)&one == 1 && sizeof(APEX_Instruction) == IMAGE_RECORD_SIZE;
+}
+
+/* Writes the image next to filename and renames it into place, so a
+ * simulator mapping the old one never sees it half written */
+int
+APEX_image_write(const char *filename, const APEX_Instruction *code, int size)
+{
+    size_t body = (size_t)size * IMAGE_RECORD_SIZE;
+    unsigned char *buf = calloc(IMAGE_HEADER_SIZE + body, 1);
+    char *tmp = malloc(strlen(filename) + 5);
+    FILE *fp;
+    int i, ok;
+
+    if (!buf || !tmp)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory writing %s\n", filename);
+        free(buf);
+        free(tmp);
+        return -1;
+    }
+
+    for (i = 0; i < size; ++i)
+    {
+        unsigned char *r = buf + IMAGE_HEADER_SIZE + (size_t)i * IMAGE_RECORD_SIZE;
+
+        put_u32(r, (unsigned int)code[i].opcode);
+        put_u32(r + 4, (unsigned int)code[i].rd);
+        put_u32(r + 8, (unsigned int)code[i].rs1);
+        put_u32(r + 12, (unsigned int)code[i].rs2);
+        put_u32(r + 16, (unsigned int)code[i].imm);
+    }
+    memcpy(buf, IMAGE_MAGIC, 4);
+    put_u32(buf + 4, IMAGE_VERSION);
+    put_u32(buf + 8, IMAGE_RECORD_SIZE);
+    put_u32(buf + 12, (unsigned int)size);
+    put_u32(buf + 16, checksum(buf + IMAGE_HEADER_SIZE, body));
+
+    sprintf(tmp, "%s.tmp", filename);
+    fp = fopen(tmp, "wb");
+    ok = fp && fwrite(buf, 1, IMAGE_HEADER_SIZE + body, fp) == IMAGE_HEADER_SIZE + body;
+    if (fp && fclose(fp) != 0)
+    {
+        ok = FALSE;
+    }
+    if (!ok || rename(tmp, filename) != 0)
+    {
+        fprintf(stderr, "APEX_Error: Unable to write program image %s\n", filename);
+        remove(tmp);
+        ok = FALSE;
+    }
+    free(tmp);
+    free(buf);
+    return ok ? 0 : -1;
+}
+
+/*
+ * Maps the image in filename as the code memory of cpu. Files that do not
+ * start with the image magic, or cannot be opened, are left for the
+ * assembly parser.
+ */
+int
+APEX_image_map(const char *filename, APEX_CPU *cpu)
+{
+    unsigned char magic[4];
+    const unsigned char *base, *records;
+    struct stat st;
+    unsigned int count;
+    void *map;
+    int fd, i;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return APEX_IMAGE_NOT_IMAGE;
+    }
+    if (pread(fd, magic, 4, 0) != 4 || memcmp(magic, IMAGE_MAGIC, 4) != 0)
+    {
+        close(fd);
+        return APEX_IMAGE_NOT_IMAGE;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < IMAGE_HEADER_SIZE)
+    {
+        fprintf(stderr, "APEX_Error: %s is a truncated program image\n", filename);
+        close(fd);
+        return APEX_IMAGE_ERROR;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        fprintf(stderr, "APEX_Error: Unable to map program image %s\n", filename);
+        return APEX_IMAGE_ERROR;
+    }
+    base = map;
+    records = base + IMAGE_HEADER_SIZE;
+    count = get_u32(base + 12);
+
+    if (get_u32(base + 4) != IMAGE_VERSION || get_u32(base + 8) != IMAGE_RECORD_SIZE)
+    {
+        fprintf(stderr, "APEX_Error: %s is program image version %u, this simulator reads version %d\n",
+                filename, get_u32(base + 4), IMAGE_VERSION);
+        munmap(map, st.st_size);
+        return APEX_IMAGE_ERROR;
+    }
+    if (count == 0 || count > (1u << 24) ||
+        (unsigned long long)st.st_size != IMAGE_HEADER_SIZE + (unsigned long long)count * IMAGE_RECORD_SIZE ||
+        checksum(records, (size_t)count * IMAGE_RECORD_SIZE) != get_u32(base + 16))
+    {
+        fprintf(stderr, "APEX_Error: %s is a truncated or corrupt program image\n", filename);
+        munmap(map, st.st_size);
+        return APEX_IMAGE_ERROR;
+    }
+    for (i = 0; i < (int)count; ++i)
+    {
+        unsigned int opcode = get_u32(records + (size_t)i * IMAGE_RECORD_SIZE);
+
+        if (opcode == OPCODE_NULL || opcode >= OPCODE_COUNT)
+        {
+            fprintf(stderr, "APEX_Error: %s has an invalid opcode %u at instruction %d\n", filename, opcode, i);
+            munmap(map, st.st_size);
+            return APEX_IMAGE_ERROR;
+        }
+    }
+
+    cpu->code_memory_size = (int)count;
+    if (records_are_native())
+    {
+        /* The code memory is never written, so the shared mapping is enough */
+        cpu->code_memory = (APEX_Instruction *)records;
+        cpu->code_map = map;
+        cpu->code_map_size = st.st_size;
+        return APEX_IMAGE_MAPPED;
+    }
+
+    cpu->code_memory = calloc(count, sizeof(APEX_Instruction));
+    if (!cpu->code_memory)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory loading %s\n", filename);
+        munmap(map, st.st_size);
+        return APEX_IMAGE_ERROR;
+    }
+    for (i = 0; i < (int)count; ++i)
+    {
+        const unsigned char *r = records + (size_t)i * IMAGE_RECORD_SIZE;
+
+        cpu->code_memory[i].opcode = (int)get_u32(r);
+        cpu->code_memory[i].rd = (int)get_u32(r + 4);
+        cpu->code_memory[i].rs1 = (int)get_u32(r + 8);
+        cpu->code_memory[i].rs2 = (int)get_u32(r + 12);
+        cpu->code_memory[i].imm = (int)get_u32(r + 16);
+    }
+    munmap(map, st.st_size);
+    return APEX_IMAGE_MAPPED;
+}
+
+/* Releases the code memory of cpu, whichever way it was loaded */
+void
+APEX_image_unmap(APEX_CPU *cpu)
+{
+    if (cpu->code_map)
+    {
+        munmap(cpu->code_map, cpu->code_map_size);
+        cpu->code_map = NULL;
+    }
+    else
+    {
+        free(cpu->code_memory);
+    }
+    cpu->code_memory = NULL;
+}
@@ -0,0 +1,36 @@
+/*
+ * apex_image.h
+ * Predecoded program images, written by apex_asm and mapped by the simulator
+ *
+ * An image is the parsed code memory of a program, so starting a run on it
+ * costs no parsing at all. It is a 32-byte header followed by one
+ * fixed-width record per instruction, all little-endian 32-bit words:
+ *
+ *   "APXI" version record_size count checksum 0 0 0   opcode rd rs1 rs2 imm ...
+ *
+ * The checksum is FNV-1a over the records. A record has the layout of
+ * APEX_Instruction on little-endian hosts, where the simulator maps the file
+ * read-only and runs straight out of the mapping; every run of the same
+ * image, in any process, shares its pages. Elsewhere the records are
+ * decoded into a private copy.
+ */
+#ifndef _APEX_IMAGE_H_
+#define _APEX_IMAGE_H_
+
+#include "apex_cpu.h"
+
+#define IMAGE_MAGIC "APXI"
+#define IMAGE_VERSION 1
+#define IMAGE_HEADER_SIZE 32
+#define IMAGE_RECORD_SIZE 20
+
+/* Results of APEX_image_map */
+#define APEX_IMAGE_MAPPED 0
+#define APEX_IMAGE_ERROR -1    /* An image, but not one this simulator can run */
+#define APEX_IMAGE_NOT_IMAGE 1 /* Not an image at all; parse it as assembly */
+
+int APEX_image_write(const char *filename, const APEX_Instruction *code, int size);
+int APEX_image_map(const char *filename, APEX_CPU *cpu);
+void APEX_image_unmap(APEX_CPU *cpu);
+
+#endif
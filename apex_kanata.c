@@ -0,0 +1,308 @@
+/*
+ * apex_kanata.c
+ * Writes the Kanata pipeline log: the simulator reports every stage that
+ * holds an instruction each cycle, and a stage command is written only when
+ * an instruction moves on. An instruction that no stage reports for a whole
+ * cycle has been squashed and is closed as flushed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apex_kanata.h"
+
+/* Lane 0 stage names shown by Konata. STAGE_ROB stands for the wait between
+ * producing a result and committing. */
+static const char *const kanata_stage_names[STAGE_COUNT] = {
+    [STAGE_FETCH] = "F",
+    [STAGE_DECODE] = "D",
+    [STAGE_DISPATCH] = "Ds",
+    [STAGE_ISSUEQ] = "IQ",
+    [STAGE_INTFU] = "intfu",
+    [STAGE_LOGICALFU] = "logicalfu",
+    [STAGE_MULFU1] = "mulfu1",
+    [STAGE_MULFU2] = "mulfu2",
+    [STAGE_MULFU3] = "mulfu3",
+    [STAGE_MULFU4] = "mulfu4",
+    [STAGE_LSQ] = "LSQ",
+    [STAGE_DCACHE] = "dcache",
+    [STAGE_ROB] = "Cm",
+};
+
+/* Order of the stages along the pipeline; an instruction only moves forward */
+static const int kanata_stage_rank[STAGE_COUNT] = {
+    [STAGE_FETCH] = 0,
+    [STAGE_DECODE] = 1,
+    [STAGE_DISPATCH] = 2,
+    [STAGE_ISSUEQ] = 3,
+    [STAGE_INTFU] = 4,
+    [STAGE_LOGICALFU] = 4,
+    [STAGE_MULFU1] = 4,
+    [STAGE_MULFU2] = 5,
+    [STAGE_MULFU3] = 6,
+    [STAGE_MULFU4] = 7,
+    [STAGE_LSQ] = 8,
+    [STAGE_DCACHE] = 9,
+    [STAGE_ROB] = 10,
+};
+
+/* Writes out the cycles passed since the last command */
+static void
+kanata_sync(APEX_Kanata *k)
+{
+    if (k->idle)
+    {
+        fprintf(k->fp, "C\t%d\n", k->idle);
+        k->idle = 0;
+    }
+}
+
+/* Hover text of a finished instruction: the cycle of every stage it saw */
+static void
+kanata_lifecycle(APEX_Kanata *k, const kanata_record *rec, const char *end)
+{
+    int rank, i;
+
+    fprintf(k->fp, "L\t%u\t1\t", rec->id);
+    for (rank = 0; rank <= kanata_stage_rank[STAGE_ROB]; ++rank)
+    {
+        for (i = 0; i < STAGE_COUNT; ++i)
+        {
+            if (kanata_stage_rank[i] == rank && rec->enter[i] >= 0)
+            {
+                fprintf(k->fp, "%s %d, ", kanata_stage_names[i], rec->enter[i]);
+            }
+        }
+    }
+    fprintf(k->fp, "%s %d\n", end, k->cycle);
+}
+
+static void
+kanata_flush(APEX_Kanata *k, kanata_record *rec)
+{
+    kanata_sync(k);
+    kanata_lifecycle(k, rec, "flushed");
+    fprintf(k->fp, "R\t%u\t0\t1\n", rec->id);
+    rec->live = FALSE;
+    k->flushed++;
+}
+
+/* Finds the record of the instruction a stage holds. The first time it is
+ * seen past dispatch the record moves to the slot of its ROB entry. */
+static kanata_record *
+kanata_find(APEX_Kanata *k, int stage_id, const CPU_Stage *stage)
+{
+    kanata_record *front = &k->front[stage->seq % KANATA_FRONT_SLOTS];
+    kanata_record *rec;
+
+    if (!front->live || front->id != stage->seq)
+    {
+        front = NULL;
+    }
+    if (kanata_stage_rank[stage_id] <= kanata_stage_rank[STAGE_DISPATCH])
+    {
+        return front;
+    }
+    if (stage->rob_tag < 0 || stage->rob_tag >= k->rob_size)
+    {
+        return NULL;
+    }
+
+    rec = &k->rob[stage->rob_tag];
+    if (rec->live && rec->id == stage->seq)
+    {
+        return rec;
+    }
+    if (!front)
+    {
+        return NULL;
+    }
+    if (rec->live)
+    {
+        kanata_flush(k, rec);
+    }
+    *rec = *front;
+    front->live = FALSE;
+    return rec;
+}
+
+int
+APEX_kanata_open(APEX_Kanata *k, const char *filename, int rob_size)
+{
+    memset(k, 0, sizeof(*k));
+    k->rob = calloc(rob_size, sizeof(kanata_record));
+    k->rob_size = rob_size;
+    if (!k->rob)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory starting Kanata log\n");
+        return -1;
+    }
+    k->fp = fopen(filename, "w");
+    if (!k->fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to create Kanata log %s\n", filename);
+        free(k->rob);
+        k->rob = NULL;
+        return -1;
+    }
+    fprintf(k->fp, "Kanata\t0004\nC=\t0\n");
+    return 0;
+}
+
+/* Called each cycle with the instruction fetch just read. Gives it a Kanata
+ * id in stage->seq, or the id it already has if fetch is holding it. */
+void
+APEX_kanata_fetch(APEX_Kanata *k, CPU_Stage *stage)
+{
+    kanata_record *rec;
+    int i;
+
+    if (stage->opcode == OPCODE_NULL)
+    {
+        return;
+    }
+    if (k->has_fetch)
+    {
+        rec = &k->front[k->fetch_id % KANATA_FRONT_SLOTS];
+        if (rec->live && rec->id == k->fetch_id && rec->stage == STAGE_FETCH && rec->pc == stage->pc)
+        {
+            stage->seq = rec->id;
+            rec->seen = k->cycle;
+            return;
+        }
+    }
+
+    rec = &k->front[k->next_id % KANATA_FRONT_SLOTS];
+    if (rec->live)
+    {
+        kanata_flush(k, rec);
+    }
+    rec->id = k->next_id++;
+    rec->pc = stage->pc;
+    rec->live = TRUE;
+    rec->stage = STAGE_FETCH;
+    rec->seen = k->cycle;
+    for (i = 0; i < STAGE_COUNT; ++i)
+    {
+        rec->enter[i] = -1;
+    }
+    rec->enter[STAGE_FETCH] = k->cycle;
+    stage->seq = rec->id;
+    k->fetch_id = rec->id;
+    k->has_fetch = TRUE;
+
+    kanata_sync(k);
+    fprintf(k->fp, "I\t%u\t%u\t0\n", rec->id, rec->id);
+    fprintf(k->fp, "L\t%u\t0\t%d: ", rec->id, rec->pc);
+    APEX_print_instruction(k->fp, stage);
+    fprintf(k->fp, "\nS\t%u\t0\t%s\n", rec->id, kanata_stage_names[STAGE_FETCH]);
+}
+
+/*
+ * Called for every stage and queue entry that holds an instruction this
+ * cycle. STAGE_ROB reports each ROB entry: it keeps the instruction alive
+ * and, once its result is in, marks the wait for commit.
+ */
+void
+APEX_kanata_stage(APEX_Kanata *k, int stage_id, const CPU_Stage *stage)
+{
+    kanata_record *rec = kanata_find(k, stage_id, stage);
+
+    if (!rec)
+    {
+        return;
+    }
+    rec->seen = k->cycle;
+
+    if (stage_id == STAGE_ROB && !stage->completed)
+    {
+        return;
+    }
+    /* Memory instructions sit in the LSQ from dispatch on, but only wait
+     * there once intfu has computed their address */
+    if (stage_id == STAGE_LSQ && rec->stage != STAGE_INTFU)
+    {
+        return;
+    }
+    /* One stage per cycle: the stages run back to front, so an instruction
+     * handed on this cycle is reported again by the stage it went to */
+    if (kanata_stage_rank[stage_id] <= kanata_stage_rank[rec->stage] || rec->enter[rec->stage] == k->cycle)
+    {
+        return;
+    }
+
+    rec->stage = stage_id;
+    rec->enter[stage_id] = k->cycle;
+    kanata_sync(k);
+    fprintf(k->fp, "S\t%u\t0\t%s\n", rec->id, kanata_stage_names[stage_id]);
+}
+
+/* Called as the ROB head retires */
+void
+APEX_kanata_retire(APEX_Kanata *k, const CPU_Stage *stage)
+{
+    kanata_record *rec = kanata_find(k, STAGE_ROB, stage);
+
+    if (!rec)
+    {
+        return;
+    }
+    kanata_sync(k);
+    kanata_lifecycle(k, rec, "commit");
+    fprintf(k->fp, "R\t%u\t%u\t0\n", rec->id, k->retired++);
+    rec->live = FALSE;
+}
+
+/* Closes the instructions squashed this cycle and moves to the next one */
+void
+APEX_kanata_cycle_end(APEX_Kanata *k)
+{
+    int i;
+
+    for (i = 0; i < KANATA_FRONT_SLOTS; ++i)
+    {
+        if (k->front[i].live && k->front[i].seen != k->cycle)
+        {
+            kanata_flush(k, &k->front[i]);
+        }
+    }
+    for (i = 0; i < k->rob_size; ++i)
+    {
+        if (k->rob[i].live && k->rob[i].seen != k->cycle)
+        {
+            kanata_flush(k, &k->rob[i]);
+        }
+    }
+    k->cycle++;
+    k->idle++;
+}
+
+/* Closes whatever is still in flight as flushed, e.g. behind HALT */
+void
+APEX_kanata_close(APEX_Kanata *k)
+{
+    int i;
+
+    if (!k->fp)
+    {
+        return;
+    }
+    for (i = 0; i < KANATA_FRONT_SLOTS; ++i)
+    {
+        if (k->front[i].live)
+        {
+            kanata_flush(k, &k->front[i]);
+        }
+    }
+    for (i = 0; i < k->rob_size; ++i)
+    {
+        if (k->rob[i].live)
+        {
+            kanata_flush(k, &k->rob[i]);
+        }
+    }
+    fclose(k->fp);
+    k->fp = NULL;
+    free(k->rob);
+    k->rob = NULL;
+}
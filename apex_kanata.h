@@ -0,0 +1,54 @@
+/*
+ * apex_kanata.h
+ * Pipeline log in the Kanata format read by the Konata viewer
+ *
+ * Every dynamic instruction gets a record holding the cycle it entered each
+ * stage, from fetch to commit. Records of instructions not yet dispatched
+ * sit in a few front-end slots; from dispatch on a record lives in the slot
+ * of its ROB entry. Commands are written as the run goes, so the log costs
+ * the same memory however long the run is.
+ */
+#ifndef _APEX_KANATA_H_
+#define _APEX_KANATA_H_
+
+#include <stdio.h>
+
+#include "apex_cpu.h"
+#include "apex_trace.h"
+
+/* Fetch, decode and dispatch latches, plus instructions squashed this cycle */
+#define KANATA_FRONT_SLOTS 8
+
+typedef struct kanata_record
+{
+    unsigned int id; /* Kanata id, also CPU_Stage.seq of the instruction */
+    int pc;
+    int live;
+    int stage;              /* STAGE_* the instruction is in, STAGE_ROB while it waits to commit */
+    int seen;               /* Last cycle any stage held the instruction */
+    int enter[STAGE_COUNT]; /* Cycle the instruction entered each stage, -1 if never */
+} kanata_record;
+
+typedef struct APEX_Kanata
+{
+    FILE *fp;
+    int cycle;
+    int idle; /* Cycles passed since the last command */
+    unsigned int next_id;
+    unsigned int fetch_id; /* Instruction in the fetch latch, if has_fetch */
+    int has_fetch;
+    unsigned int retired;
+    unsigned int flushed;
+    kanata_record front[KANATA_FRONT_SLOTS];
+    kanata_record *rob; /* One record per ROB slot */
+    int rob_size;
+} APEX_Kanata;
+
+int APEX_kanata_open(APEX_Kanata *k, const char *filename, int rob_size);
+void APEX_kanata_fetch(APEX_Kanata *k, CPU_Stage *stage);
+void APEX_kanata_stage(APEX_Kanata *k, int stage_id, const CPU_Stage *stage);
+void APEX_kanata_retire(APEX_Kanata *k, const CPU_Stage *stage);
+void APEX_kanata_cycle_end(APEX_Kanata *k);
+void APEX_kanata_close(APEX_Kanata *k);
+
+#endif
@@ -12,12 +12,25 @@
 #define FALSE 0x0
 #define TRUE 0x1
 
-/* Integers */
-#define DATA_MEMORY_SIZE 4096
+/* Defaults of the runtime configuration (apex_config.h) */
+#define DATA_MEMORY_SIZE 4096 /* Integers */
+#define PREGS_FILE_SIZE 15
+#define IQ_SIZE 8
+#define ROB_SIZE 16
+#define LSQ_SIZE 4
+#define MUL_STAGES 4
+
+/* Largest values a configuration may give them */
+#define DATA_MEMORY_MAX (1 << 24)
+#define PREGS_MAX 256
+#define IQ_MAX 1024
+#define ROB_MAX 1024
+#define LSQ_MAX 1024
+#define MUL_STAGES_MAX 4 /* mulfu1 to mulfu4 */
 
 /* Size of integer register file */
 #define REG_FILE_SIZE 16
-#define PREGS_FILE_SIZE 15
+
 /* Numeric OPCODE identifiers for instructions */
 #define OPCODE_ADD 0xf
 #define OPCODE_SUB 0x1
@@ -41,6 +54,17 @@
 #define OPCODE_NOP 0x13
 #define OPCODE_JAL 0x14
 #define OPCODE_JUMP 0x15
+#define OPCODE_COUNT 0x16
+
+/* Ways APEX_cpu_run can end */
+#define APEX_RUN_HALTED 0      /* HALT retired */
+#define APEX_RUN_STOPPED 1     /* User quit in single-step mode */
+#define APEX_RUN_CYCLE_LIMIT 2 /* max_cycles elapsed */
+#define APEX_RUN_INSN_LIMIT 3  /* max_insns instructions executed */
+#define APEX_RUN_FAULT 4       /* A bad data address or division by zero reached commit */
+
+/* Cycles per instruction after which APEX_cpu_measure calls a run stuck */
+#define APEX_MEASURE_MAX_CPI 100
 
 /* Set this flag to 1 to enable debug messages */
 #define ENABLE_DEBUG_MESSAGES 1
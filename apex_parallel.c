@@ -0,0 +1,461 @@
+/*
+ * apex_parallel.c
+ * Functional pass with periodic architectural snapshots, feeding one
+ * detailed simulation per segment to a pool of threads
+ *
+ * Segments are handed out in order from a shared counter. They all cost
+ * about the same, so there is nothing for work stealing to even out.
+ *
+ * The workers start with the pass rather than after it. A segment is handed
+ * out once the pass has run past its end, which settles its length. Every
+ * snapshot holds a copy of data memory, so the pass waits while
+ * PARALLEL_SNAPSHOTS(...) of them are still waiting to be simulated; memory
+ * then stays bounded however long the run.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "apex_cpu.h"
+#include "apex_functional.h"
+#include "apex_parallel.h"
+
+/*
+ * Snapshots held at once. Up to 1 + ceil(overlap / segment) of them belong
+ * to segments the pass has not yet run past, so this always leaves one
+ * ready for a worker beyond those the threads are busy with.
+ */
+#define PARALLEL_SNAPSHOTS(threads, segment, overlap) \
+    ((threads) + 2 + (int)(((overlap) + (segment) - 1) / (segment)))
+
+typedef struct parallel_segment
+{
+    long long from;  /* Instruction the snapshot was taken at: start less the overlap */
+    long long start; /* First instruction measured */
+    long long insns; /* Instructions in the segment */
+    int pc;
+    int zero_flag;
+    int regs[REG_FILE_SIZE];
+    int *data_memory; /* Freed once a worker has copied it */
+
+    long long cycles;
+    long long retired;
+    double seconds;
+    int worker;
+    int ok;
+} parallel_segment;
+
+typedef struct parallel_pool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t ready_cond; /* A segment is ready, or the pass has ended */
+    pthread_cond_t freed_cond; /* A snapshot was released */
+    parallel_segment **segments; /* Reallocated by the pass, so only read under the lock */
+    int capacity;
+    int count; /* Snapshots taken */
+    int ready; /* Segments with a settled length, always the first ones */
+    int next;  /* Next segment to hand out */
+    int held;  /* Snapshots not yet released */
+    int limit;
+    int done;  /* The pass has ended; count and ready are final */
+    const APEX_Instruction *code;
+    int code_size;
+    const APEX_Config *config;
+} parallel_pool;
+
+typedef struct parallel_worker
+{
+    parallel_pool *pool;
+    int id;
+    pthread_t thread;
+} parallel_worker;
+
+static double
+now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Snapshots the state of the pass as a new segment, once fewer than the
+ * limit are held */
+static void
+take_snapshot(parallel_pool *pool, const APEX_CPU *cpu, long long start)
+{
+    parallel_segment *seg = calloc(1, sizeof(parallel_segment));
+
+    if (!seg || !(seg->data_memory = malloc(cpu->config.data_memory_size * sizeof(int))))
+    {
+        fprintf(stderr, "APEX_Error: Out of memory taking snapshots\n");
+        exit(1);
+    }
+    seg->from = cpu->insn_fast_forwarded;
+    seg->start = start;
+    seg->pc = cpu->pc;
+    seg->zero_flag = cpu->zero_flag;
+    memcpy(seg->regs, cpu->regs, sizeof(seg->regs));
+    memcpy(seg->data_memory, cpu->data_memory, cpu->config.data_memory_size * sizeof(int));
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->held >= pool->limit)
+    {
+        pthread_cond_wait(&pool->freed_cond, &pool->lock);
+    }
+    if (pool->count == pool->capacity)
+    {
+        pool->capacity = pool->capacity ? pool->capacity * 2 : 64;
+        pool->segments = realloc(pool->segments, pool->capacity * sizeof(parallel_segment *));
+        if (!pool->segments)
+        {
+            fprintf(stderr, "APEX_Error: Out of memory taking snapshots\n");
+            exit(1);
+        }
+    }
+    pool->segments[pool->count++] = seg;
+    pool->held++;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void
+release_snapshot(parallel_pool *pool, parallel_segment *seg)
+{
+    pthread_mutex_lock(&pool->lock);
+    free(seg->data_memory);
+    seg->data_memory = NULL;
+    pool->held--;
+    pthread_cond_signal(&pool->freed_cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* Hands out every segment that ends at or before instruction pos */
+static void
+settle(parallel_pool *pool, long long pos, long long segment)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->ready < pool->count && pool->segments[pool->ready]->start + segment <= pos)
+    {
+        pool->segments[pool->ready++]->insns = segment;
+        pthread_cond_broadcast(&pool->ready_cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* Ends the pass at total instructions: the last segments get what is left
+ * of the run, and those it never reached are dropped */
+static void
+finish_pass(parallel_pool *pool, long long total, long long segment)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->count > pool->ready && pool->segments[pool->count - 1]->start >= total)
+    {
+        parallel_segment *seg = pool->segments[--pool->count];
+
+        free(seg->data_memory);
+        free(seg);
+        pool->held--;
+    }
+    for (; pool->ready < pool->count; pool->ready++)
+    {
+        parallel_segment *seg = pool->segments[pool->ready];
+
+        seg->insns = total - seg->start < segment ? total - seg->start : segment;
+    }
+    pool->done = TRUE;
+    pthread_cond_broadcast(&pool->ready_cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Runs the pass on to instruction target, or to the end of the run if
+ * target is negative, handing out segments as it passes their ends.
+ * Returns the APEX_FUNC_* status; LIMIT once target is reached.
+ */
+static int
+advance(parallel_pool *pool, APEX_CPU *cpu, long long target, long long segment)
+{
+    int status = APEX_FUNC_LIMIT;
+
+    while (status == APEX_FUNC_LIMIT && (target < 0 || cpu->insn_fast_forwarded < target))
+    {
+        long long stop = cpu->insn_fast_forwarded + segment;
+        int ready;
+
+        pthread_mutex_lock(&pool->lock);
+        ready = pool->ready;
+        if (ready < pool->count && pool->segments[ready]->start + segment < stop)
+        {
+            stop = pool->segments[ready]->start + segment;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        if (target >= 0 && target < stop)
+        {
+            stop = target;
+        }
+
+        status = APEX_functional_run(cpu, stop - cpu->insn_fast_forwarded);
+        settle(pool, cpu->insn_fast_forwarded, segment);
+    }
+    return status;
+}
+
+/*
+ * Runs the program functionally, snapshotting overlap instructions before
+ * every multiple of the segment length. Returns the APEX_FUNC_* status the
+ * run ended with, and the instructions it executed in *total.
+ */
+static int
+functional_pass(parallel_pool *pool, APEX_CPU *cpu, const APEX_Parallel_Options *opt, long long *total)
+{
+    int status = APEX_FUNC_LIMIT;
+    long long start;
+
+    for (start = 0; !opt->max_insns || start < opt->max_insns; start += opt->segment)
+    {
+        long long from = start > opt->overlap ? start - opt->overlap : 0;
+
+        status = advance(pool, cpu, from, opt->segment);
+        if (status != APEX_FUNC_LIMIT)
+        {
+            break;
+        }
+        take_snapshot(pool, cpu, start);
+    }
+
+    /* On to the end of the run, which settles the length of the last segments */
+    if (status == APEX_FUNC_LIMIT)
+    {
+        status = advance(pool, cpu, opt->max_insns ? opt->max_insns : -1, opt->segment);
+    }
+    *total = cpu->insn_fast_forwarded;
+    return status;
+}
+
+/* Starts an empty pipeline on the snapshot of a segment and measures it */
+static void
+simulate_segment(parallel_pool *pool, parallel_segment *seg)
+{
+    APEX_CPU *cpu = APEX_cpu_create(pool->config);
+    double start = now_seconds();
+
+    if (!cpu)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory starting a segment\n");
+        exit(1);
+    }
+    /* Borrowed, never written: every segment runs on the one code memory */
+    cpu->code_memory = (APEX_Instruction *)pool->code;
+    cpu->code_memory_size = pool->code_size;
+    cpu->pc = seg->pc;
+    cpu->zero_flag = seg->zero_flag;
+    memcpy(cpu->regs, seg->regs, sizeof(cpu->regs));
+    memcpy(cpu->data_memory, seg->data_memory, cpu->config.data_memory_size * sizeof(int));
+    cpu->insn_fast_forwarded = seg->from;
+    release_snapshot(pool, seg);
+
+    seg->ok = APEX_cpu_measure(cpu, seg->start, seg->insns, &seg->cycles, &seg->retired);
+    cpu->code_memory = NULL;
+    APEX_cpu_stop(cpu);
+    seg->seconds = now_seconds() - start;
+}
+
+static void *
+worker_main(void *arg)
+{
+    parallel_worker *self = arg;
+    parallel_pool *pool = self->pool;
+    parallel_segment *seg;
+
+    while (TRUE)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->next == pool->ready && !pool->done)
+        {
+            pthread_cond_wait(&pool->ready_cond, &pool->lock);
+        }
+        seg = pool->next < pool->ready ? pool->segments[pool->next++] : NULL;
+        pthread_mutex_unlock(&pool->lock);
+        if (!seg)
+        {
+            break;
+        }
+        simulate_segment(pool, seg);
+        seg->worker = self->id;
+    }
+    return NULL;
+}
+
+void
+APEX_parallel_defaults(APEX_Parallel_Options *opt)
+{
+    opt->segment = PARALLEL_SEGMENT;
+    opt->overlap = PARALLEL_OVERLAP;
+    opt->threads = 0;
+    opt->max_insns = PARALLEL_MAX_INSNS;
+    opt->verify = FALSE;
+    APEX_config_defaults(&opt->config);
+}
+
+/* Runs one program time-parallel and prints the per-segment and stitched
+ * results */
+int
+APEX_parallel_run(const char *filename, const APEX_Parallel_Options *opt)
+{
+    parallel_pool pool;
+    parallel_worker *workers;
+    APEX_CPU *code_cpu, *pass_cpu;
+    long long total = 0, cycles = 0, retired = 0;
+    double start, pass_time, detail_time;
+    int threads = opt->threads;
+    int status, i, w;
+
+    if (opt->segment <= 0 || opt->overlap < 0 || opt->max_insns < 0)
+    {
+        fprintf(stderr, "APEX_Error: Segment, overlap and instruction limit must be positive\n");
+        return 1;
+    }
+
+    /* The segments share one read-only copy of the program to start from;
+     * the pass runs on a second one */
+    code_cpu = APEX_cpu_init(filename, &opt->config);
+    pass_cpu = code_cpu ? APEX_cpu_init(filename, &opt->config) : NULL;
+    if (!pass_cpu)
+    {
+        fprintf(stderr, "APEX_Error: Unable to initialize CPU\n");
+        if (code_cpu)
+        {
+            APEX_cpu_stop(code_cpu);
+        }
+        return 1;
+    }
+    if (threads <= 0)
+    {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (opt->max_insns && threads > (opt->max_insns + opt->segment - 1) / opt->segment)
+    {
+        threads = (int)((opt->max_insns + opt->segment - 1) / opt->segment);
+    }
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+
+    memset(&pool, 0, sizeof(pool));
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.ready_cond, NULL);
+    pthread_cond_init(&pool.freed_cond, NULL);
+    pool.limit = PARALLEL_SNAPSHOTS(threads, opt->segment, opt->overlap);
+    pool.code = code_cpu->code_memory;
+    pool.code_size = code_cpu->code_memory_size;
+    pool.config = &opt->config;
+    workers = calloc(threads, sizeof(parallel_worker));
+    if (!workers)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory starting workers\n");
+        exit(1);
+    }
+
+    start = now_seconds();
+    for (w = 0; w < threads; ++w)
+    {
+        workers[w].pool = &pool;
+        workers[w].id = w;
+        if (pthread_create(&workers[w].thread, NULL, worker_main, &workers[w]) != 0)
+        {
+            fprintf(stderr, "APEX_Error: Unable to start worker thread\n");
+            exit(1);
+        }
+    }
+
+    status = functional_pass(&pool, pass_cpu, opt, &total);
+    pass_time = now_seconds() - start;
+    if (status == APEX_FUNC_FAULT)
+    {
+        /* Nothing more is handed out; the workers finish what they hold */
+        fprintf(stderr, "APEX_Error: Bad data address or division by zero at pc %d in the functional pass\n",
+                pass_cpu->pc);
+        pthread_mutex_lock(&pool.lock);
+        pool.ready = pool.next;
+        pool.done = TRUE;
+        pthread_cond_broadcast(&pool.ready_cond);
+        pthread_mutex_unlock(&pool.lock);
+    }
+    else
+    {
+        if (status == APEX_FUNC_OFF_END)
+        {
+            fprintf(stderr, "APEX_Parallel: program runs past its end after %lld instructions\n", total);
+        }
+        finish_pass(&pool, total, opt->segment);
+    }
+    APEX_cpu_stop(pass_cpu);
+
+    for (w = 0; w < threads; ++w)
+    {
+        pthread_join(workers[w].thread, NULL);
+    }
+    detail_time = now_seconds() - start;
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.ready_cond);
+    pthread_cond_destroy(&pool.freed_cond);
+    free(workers);
+
+    if (status == APEX_FUNC_FAULT || pool.count == 0)
+    {
+        if (status != APEX_FUNC_FAULT)
+        {
+            fprintf(stderr, "APEX_Error: %s executed no instructions\n", filename);
+        }
+        for (i = 0; i < pool.count; ++i)
+        {
+            free(pool.segments[i]->data_memory);
+            free(pool.segments[i]);
+        }
+        free(pool.segments);
+        APEX_cpu_stop(code_cpu);
+        return 1;
+    }
+
+    printf("%-7s %12s %10s %10s %7s %9s %6s\n", "Segment", "Start", "Insns", "Cycles", "CPI", "Time(s)", "Thread");
+    for (i = 0; i < pool.count; ++i)
+    {
+        const parallel_segment *seg = pool.segments[i];
+
+        printf("%-7d %12lld %10lld %10lld %7.3f %9.4f %6d%s\n", i, seg->start, seg->retired, seg->cycles,
+               seg->retired ? (double)seg->cycles / seg->retired : 0.0, seg->seconds, seg->worker,
+               seg->ok ? "" : "  (nothing retired)");
+        cycles += seg->cycles;
+        retired += seg->retired;
+    }
+
+    printf("APEX_Parallel: %d segments of %lld instructions, %lld warm-up overlap, %d threads\n",
+           pool.count, opt->segment, opt->overlap, threads);
+    printf("APEX_Parallel: cycles = %lld instructions = %lld IPC = %.4f\n",
+           cycles, retired, cycles ? (double)retired / cycles : 0.0);
+    printf("APEX_Parallel: functional pass %.3f s, detailed %.3f s\n", pass_time, detail_time);
+
+    if (opt->verify)
+    {
+        long long seq_cycles, seq_retired;
+
+        start = now_seconds();
+        APEX_cpu_measure(code_cpu, 0, total, &seq_cycles, &seq_retired);
+        detail_time = now_seconds() - start;
+        printf("APEX_Parallel: sequential cycles = %lld instructions = %lld, error = %.3f%%, %.3f s\n",
+               seq_cycles, seq_retired, seq_cycles ? 100.0 * (cycles - seq_cycles) / seq_cycles : 0.0,
+               detail_time);
+    }
+
+    for (i = 0; i < pool.count; ++i)
+    {
+        free(pool.segments[i]);
+    }
+    free(pool.segments);
+    APEX_cpu_stop(code_cpu);
+    return 0;
+}
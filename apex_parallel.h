@@ -0,0 +1,35 @@
+/*
+ * apex_parallel.h
+ * Time-parallel simulation of one long run
+ *
+ * A functional pass over the program takes an architectural snapshot - pc,
+ * registers, zero flag and data memory - a little before the start of each
+ * segment of N instructions. Every segment is then simulated in detail on
+ * its own thread: the pipeline starts empty at the snapshot, warms up on
+ * the overlap and is measured from the segment's first instruction to its
+ * last. The run's cycle count is the sum of the segments'.
+ */
+#ifndef _APEX_PARALLEL_H_
+#define _APEX_PARALLEL_H_
+
+#include "apex_config.h"
+
+/* Defaults of the options */
+#define PARALLEL_SEGMENT 1000000
+#define PARALLEL_OVERLAP 10000
+#define PARALLEL_MAX_INSNS 100000000LL
+
+typedef struct APEX_Parallel_Options
+{
+    long long segment;   /* Instructions per segment */
+    long long overlap;   /* Detailed warm-up instructions before each segment */
+    int threads;         /* Worker threads, 0 for one per online CPU */
+    long long max_insns; /* Simulate at most this many instructions, 0 to run to HALT */
+    int verify;          /* Also simulate the run sequentially and report the error */
+    APEX_Config config;  /* Microarchitecture of the detailed simulations */
+} APEX_Parallel_Options;
+
+void APEX_parallel_defaults(APEX_Parallel_Options *opt);
+int APEX_parallel_run(const char *filename, const APEX_Parallel_Options *opt);
+
+#endif
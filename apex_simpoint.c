@@ -0,0 +1,560 @@
+/*
+ * apex_simpoint.c
+ * Basic-block vector profiling, k-means clustering and the detailed
+ * simulation of the chosen intervals
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "apex_cpu.h"
+#include "apex_functional.h"
+#include "apex_simpoint.h"
+
+/* Dimensions the vectors are projected to, as in SimPoint */
+#define SIMPOINT_DIMS 15
+/* k-means runs from this many random starts and keeps the best */
+#define SIMPOINT_RESTARTS 5
+#define SIMPOINT_ITERATIONS 100
+/* The smallest k whose spread is at most this fraction of k = 1's wins */
+#define SIMPOINT_SPREAD 0.1
+#define SIMPOINT_SEED 0x9e3779b97f4a7c15ULL
+
+/* The profile: one projected, normalised vector per interval */
+typedef struct simpoint_profile
+{
+    int count;
+    int capacity;
+    int dims;
+    long long *start; /* First instruction of each interval */
+    long long *insns; /* Instructions in each interval; only the last may be short */
+    double *vec;      /* count x dims */
+    long long total;
+    int blocks;
+} simpoint_profile;
+
+typedef struct simpoint_clusters
+{
+    int k;
+    int *member; /* Cluster of each interval */
+    double *centre;
+    double spread; /* Weighted sum of squared distances to the centres */
+} simpoint_clusters;
+
+static double
+now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift64*: the same seed gives the same simpoints on every host */
+static unsigned long long
+next_random(unsigned long long *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+/* Uniform in [0, 1) */
+static double
+random_unit(unsigned long long *state)
+{
+    return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void *
+xcalloc(size_t n, size_t size)
+{
+    void *p = calloc(n ? n : 1, size);
+
+    if (!p)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory in sampled simulation\n");
+        exit(1);
+    }
+    return p;
+}
+
+static double
+distance2(const double *a, const double *b, int dims)
+{
+    double d = 0;
+    int i;
+
+    for (i = 0; i < dims; ++i)
+    {
+        d += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+    return d;
+}
+
+static void
+profile_append(simpoint_profile *p, long long start, long long insns, const unsigned int *counts,
+               const double *projection)
+{
+    double *v;
+    int b, d;
+
+    if (p->count == p->capacity)
+    {
+        p->capacity = p->capacity ? p->capacity * 2 : 256;
+        p->start = realloc(p->start, p->capacity * sizeof(long long));
+        p->insns = realloc(p->insns, p->capacity * sizeof(long long));
+        p->vec = realloc(p->vec, (size_t)p->capacity * p->dims * sizeof(double));
+        if (!p->start || !p->insns || !p->vec)
+        {
+            fprintf(stderr, "APEX_Error: Out of memory in sampled simulation\n");
+            exit(1);
+        }
+    }
+    p->start[p->count] = start;
+    p->insns[p->count] = insns;
+
+    /* Each block's share of the interval, projected if there are many */
+    v = &p->vec[(size_t)p->count * p->dims];
+    for (d = 0; d < p->dims; ++d)
+    {
+        v[d] = 0;
+    }
+    for (b = 0; b < p->blocks; ++b)
+    {
+        double share = (double)counts[b] / insns;
+
+        if (!counts[b])
+        {
+            continue;
+        }
+        if (!projection)
+        {
+            v[b] = share;
+            continue;
+        }
+        for (d = 0; d < p->dims; ++d)
+        {
+            v[d] += share * projection[(size_t)b * p->dims + d];
+        }
+    }
+    p->count++;
+}
+
+/* Runs the program on the functional interpreter, one interval at a time */
+static int
+profile_run(const char *filename, const APEX_SimPoint_Options *opt, simpoint_profile *p)
+{
+    APEX_CPU *cpu = APEX_cpu_init(filename, &opt->config);
+    unsigned long long seed = SIMPOINT_SEED;
+    double *projection = NULL;
+    unsigned int *counts;
+    int *block_of;
+    int status = APEX_FUNC_LIMIT;
+    int i;
+
+    if (!cpu)
+    {
+        fprintf(stderr, "APEX_Error: Unable to initialize CPU\n");
+        return -1;
+    }
+
+    block_of = xcalloc(cpu->code_memory_size, sizeof(int));
+    p->blocks = APEX_functional_blocks(cpu, block_of);
+    counts = xcalloc(p->blocks, sizeof(unsigned int));
+    p->dims = p->blocks;
+    if (p->blocks > SIMPOINT_DIMS)
+    {
+        p->dims = SIMPOINT_DIMS;
+        projection = xcalloc((size_t)p->blocks * SIMPOINT_DIMS, sizeof(double));
+        for (i = 0; i < p->blocks * SIMPOINT_DIMS; ++i)
+        {
+            projection[i] = 2 * random_unit(&seed) - 1;
+        }
+    }
+
+    while (status == APEX_FUNC_LIMIT && (!opt->max_insns || p->total < opt->max_insns))
+    {
+        long long budget = opt->interval;
+        long long n;
+
+        if (opt->max_insns && budget > opt->max_insns - p->total)
+        {
+            budget = opt->max_insns - p->total;
+        }
+        status = APEX_functional_profile(cpu, budget, block_of, counts);
+        n = cpu->insn_fast_forwarded - p->total;
+        if (n > 0)
+        {
+            profile_append(p, p->total, n, counts, projection);
+            memset(counts, 0, p->blocks * sizeof(unsigned int));
+        }
+        p->total = cpu->insn_fast_forwarded;
+    }
+
+    if (status == APEX_FUNC_FAULT)
+    {
+        fprintf(stderr, "APEX_Error: Bad data address or division by zero at pc %d while profiling\n", cpu->pc);
+    }
+    else if (status == APEX_FUNC_OFF_END)
+    {
+        fprintf(stderr, "APEX_SimPoint: program runs past its end after %lld instructions\n", p->total);
+    }
+    free(projection);
+    free(counts);
+    free(block_of);
+    APEX_cpu_stop(cpu);
+    return status == APEX_FUNC_FAULT ? -1 : 0;
+}
+
+/* One run of weighted k-means from a k-means++ start */
+static void
+kmeans(const simpoint_profile *p, int k, unsigned long long *seed, simpoint_clusters *c)
+{
+    const int n = p->count;
+    const int dims = p->dims;
+    double *best = xcalloc(n, sizeof(double));
+    double *mass = xcalloc(k, sizeof(double));
+    int i, j, d, iter;
+
+    /* k-means++: each further centre is an interval picked with probability
+     * proportional to its squared distance from the nearest centre so far */
+    memcpy(c->centre, &p->vec[(size_t)(next_random(seed) % n) * dims], dims * sizeof(double));
+    for (i = 0; i < n; ++i)
+    {
+        best[i] = distance2(&p->vec[(size_t)i * dims], c->centre, dims);
+    }
+    for (j = 1; j < k; ++j)
+    {
+        double total = 0, pick;
+
+        for (i = 0; i < n; ++i)
+        {
+            total += best[i];
+        }
+        pick = random_unit(seed) * total;
+        for (i = 0; i < n - 1 && (pick -= best[i]) > 0; ++i)
+        {
+        }
+        memcpy(&c->centre[(size_t)j * dims], &p->vec[(size_t)i * dims], dims * sizeof(double));
+        for (i = 0; i < n; ++i)
+        {
+            double dist = distance2(&p->vec[(size_t)i * dims], &c->centre[(size_t)j * dims], dims);
+            if (dist < best[i])
+            {
+                best[i] = dist;
+            }
+        }
+    }
+
+    for (iter = 0; iter < SIMPOINT_ITERATIONS; ++iter)
+    {
+        int changed = 0;
+
+        c->spread = 0;
+        for (i = 0; i < n; ++i)
+        {
+            int nearest = 0;
+            double nearest_d = -1;
+
+            for (j = 0; j < k; ++j)
+            {
+                double dist = distance2(&p->vec[(size_t)i * dims], &c->centre[(size_t)j * dims], dims);
+                if (nearest_d < 0 || dist < nearest_d)
+                {
+                    nearest = j;
+                    nearest_d = dist;
+                }
+            }
+            changed |= iter == 0 || c->member[i] != nearest;
+            c->member[i] = nearest;
+            c->spread += nearest_d * p->insns[i];
+        }
+        if (!changed)
+        {
+            break;
+        }
+
+        /* Centres move to the instruction-weighted mean of their members;
+         * one left empty stays where it is */
+        memset(mass, 0, k * sizeof(double));
+        for (i = 0; i < n; ++i)
+        {
+            mass[c->member[i]] += p->insns[i];
+        }
+        for (j = 0; j < k; ++j)
+        {
+            if (mass[j] > 0)
+            {
+                memset(&c->centre[(size_t)j * dims], 0, dims * sizeof(double));
+            }
+        }
+        for (i = 0; i < n; ++i)
+        {
+            j = c->member[i];
+            for (d = 0; d < dims; ++d)
+            {
+                c->centre[(size_t)j * dims + d] += p->vec[(size_t)i * dims + d] * p->insns[i] / mass[j];
+            }
+        }
+    }
+    free(mass);
+    free(best);
+}
+
+static void
+clusters_alloc(simpoint_clusters *c, const simpoint_profile *p, int k)
+{
+    c->k = k;
+    c->member = xcalloc(p->count, sizeof(int));
+    c->centre = xcalloc((size_t)k * p->dims, sizeof(double));
+    c->spread = 0;
+}
+
+static void
+clusters_free(simpoint_clusters *c)
+{
+    free(c->member);
+    free(c->centre);
+}
+
+/* Best of several k-means runs for every k up to max_clusters; keeps the
+ * smallest k that accounts for most of the spread of the vectors */
+static void
+choose_clusters(const simpoint_profile *p, int max_clusters, simpoint_clusters *out, double *spread1)
+{
+    unsigned long long seed = SIMPOINT_SEED;
+    int k, r;
+
+    memset(out, 0, sizeof(*out));
+    if (max_clusters > p->count)
+    {
+        max_clusters = p->count;
+    }
+    if (max_clusters < 1)
+    {
+        max_clusters = 1;
+    }
+
+    for (k = 1; k <= max_clusters; ++k)
+    {
+        simpoint_clusters best, run;
+
+        clusters_alloc(&best, p, k);
+        clusters_alloc(&run, p, k);
+        for (r = 0; r < SIMPOINT_RESTARTS; ++r)
+        {
+            kmeans(p, k, &seed, &run);
+            if (r == 0 || run.spread < best.spread)
+            {
+                simpoint_clusters t = best;
+                best = run;
+                run = t;
+            }
+        }
+        clusters_free(&run);
+
+        if (k == 1)
+        {
+            *spread1 = best.spread;
+        }
+        if (k == max_clusters || best.spread <= SIMPOINT_SPREAD * *spread1)
+        {
+            *out = best;
+            return;
+        }
+        clusters_free(&best);
+    }
+}
+
+/* Detailed simulation of an interval after warming the pipeline up on the
+ * instructions just before it. Returns FALSE if nothing retired in it. */
+static int
+simulate_interval(const char *filename, const APEX_Config *config, long long start, long long insns,
+                  long long warmup, long long *cycles, long long *retired)
+{
+    APEX_CPU *cpu = APEX_cpu_init(filename, config);
+    int ok;
+
+    *cycles = 0;
+    *retired = 0;
+    if (!cpu)
+    {
+        return FALSE;
+    }
+    if (warmup > start)
+    {
+        warmup = start;
+    }
+    if (start - warmup > 0 && APEX_functional_run(cpu, start - warmup) != APEX_FUNC_LIMIT)
+    {
+        APEX_cpu_stop(cpu);
+        return FALSE;
+    }
+    ok = APEX_cpu_measure(cpu, start, insns, cycles, retired);
+    APEX_cpu_stop(cpu);
+    return ok;
+}
+
+/* Interval of cluster j nearest its centre, or with second set the nearest
+ * other than the first */
+static int
+nearest_member(const simpoint_profile *p, const simpoint_clusters *c, int j, int skip)
+{
+    int best = -1;
+    double best_d = 0;
+    int i;
+
+    for (i = 0; i < p->count; ++i)
+    {
+        double dist;
+
+        if (c->member[i] != j || i == skip)
+        {
+            continue;
+        }
+        dist = distance2(&p->vec[(size_t)i * p->dims], &c->centre[(size_t)j * p->dims], p->dims);
+        if (best < 0 || dist < best_d)
+        {
+            best = i;
+            best_d = dist;
+        }
+    }
+    return best;
+}
+
+void
+APEX_simpoint_defaults(APEX_SimPoint_Options *opt)
+{
+    opt->interval = SIMPOINT_INTERVAL;
+    opt->max_clusters = SIMPOINT_MAX_CLUSTERS;
+    opt->warmup = SIMPOINT_WARMUP;
+    opt->max_insns = SIMPOINT_MAX_INSNS;
+    opt->verify = FALSE;
+    APEX_config_defaults(&opt->config);
+}
+
+/*
+ * Profiles, clusters and simulates one program and prints the report.
+ *
+ * The error estimate treats each cluster as a stratum: the CPIs of its two
+ * intervals nearest the centre give its spread, and the clusters' spreads,
+ * weighted like their CPIs, add up to a standard error of the estimate.
+ */
+int
+APEX_simpoint_run(const char *filename, const APEX_SimPoint_Options *opt)
+{
+    simpoint_profile prof;
+    simpoint_clusters clusters;
+    double spread1 = 0;
+    double cpi = 0, variance = 0;
+    double start_time, profile_time, detail_time;
+    long long detailed = 0, warmed = 0;
+    int result = 1;
+    int j;
+
+    if (opt->interval <= 0 || opt->max_clusters <= 0 || opt->warmup < 0 || opt->max_insns < 0)
+    {
+        fprintf(stderr, "APEX_Error: Interval, clusters, warm-up and instruction limit must be positive\n");
+        return 1;
+    }
+
+    /* Every exit from here on goes through out, which frees both */
+    memset(&prof, 0, sizeof(prof));
+    memset(&clusters, 0, sizeof(clusters));
+    start_time = now_seconds();
+    if (profile_run(filename, opt, &prof) < 0)
+    {
+        goto out;
+    }
+    profile_time = now_seconds() - start_time;
+    if (prof.count == 0)
+    {
+        fprintf(stderr, "APEX_Error: %s executed no instructions\n", filename);
+        goto out;
+    }
+    printf("APEX_SimPoint: profiled %lld instructions in %.3f s: %d intervals of %lld, %d basic blocks\n",
+           prof.total, profile_time, prof.count, opt->interval, prof.blocks);
+
+    choose_clusters(&prof, opt->max_clusters, &clusters, &spread1);
+    printf("APEX_SimPoint: k = %d (spread %.4g, %.4g with one cluster)\n", clusters.k, clusters.spread, spread1);
+
+    printf("%-7s %7s %9s %9s %12s %10s %10s %7s\n", "Cluster", "Weight", "Intervals", "Simpoint",
+           "Start", "Cycles", "Insns", "CPI");
+    start_time = now_seconds();
+    for (j = 0; j < clusters.k; ++j)
+    {
+        long long mass = 0, cycles, retired, cycles2, retired2;
+        int members = 0;
+        int rep = nearest_member(&prof, &clusters, j, -1);
+        int second = nearest_member(&prof, &clusters, j, rep);
+        double weight, cpi_j;
+        int i;
+
+        if (rep < 0)
+        {
+            continue;
+        }
+        for (i = 0; i < prof.count; ++i)
+        {
+            if (clusters.member[i] == j)
+            {
+                mass += prof.insns[i];
+                members++;
+            }
+        }
+        weight = (double)mass / prof.total;
+
+        if (!simulate_interval(filename, &opt->config, prof.start[rep], prof.insns[rep], opt->warmup, &cycles, &retired))
+        {
+            fprintf(stderr, "APEX_Error: Interval %d retired nothing in the pipeline\n", rep);
+            goto out;
+        }
+        cpi_j = (double)cycles / retired;
+        cpi += weight * cpi_j;
+        detailed += retired;
+        warmed += prof.start[rep] < opt->warmup ? prof.start[rep] : opt->warmup;
+        printf("%-7d %7.4f %9d %9d %12lld %10lld %10lld %7.3f\n", j, weight, members, rep,
+               prof.start[rep], cycles, retired, cpi_j);
+
+        if (second >= 0 &&
+            simulate_interval(filename, &opt->config, prof.start[second], prof.insns[second], opt->warmup, &cycles2, &retired2))
+        {
+            double diff = cpi_j - (double)cycles2 / retired2;
+
+            variance += weight * weight * diff * diff / 2;
+            detailed += retired2;
+            warmed += prof.start[second] < opt->warmup ? prof.start[second] : opt->warmup;
+        }
+    }
+    detail_time = now_seconds() - start_time;
+
+    printf("APEX_SimPoint: weighted CPI = %.4f +- %.4f (95%%), IPC = %.4f\n",
+           cpi, 1.96 * sqrt(variance), cpi > 0 ? 1 / cpi : 0.0);
+    printf("APEX_SimPoint: %lld of %lld instructions simulated in detail (%.2f%%) plus %lld warm-up, %.3f s\n",
+           detailed, prof.total, 100.0 * detailed / prof.total, warmed, detail_time);
+
+    if (opt->verify)
+    {
+        long long cycles, retired;
+        double full_cpi;
+
+        start_time = now_seconds();
+        simulate_interval(filename, &opt->config, 0, prof.total, 0, &cycles, &retired);
+        full_cpi = retired ? (double)cycles / retired : 0.0;
+        printf("APEX_SimPoint: full detailed CPI = %.4f over %lld instructions, error = %.2f%%, %.3f s\n",
+               full_cpi, retired, full_cpi > 0 ? 100.0 * (cpi - full_cpi) / full_cpi : 0.0,
+               now_seconds() - start_time);
+    }
+    result = 0;
+
+out:
+    clusters_free(&clusters);
+    free(prof.start);
+    free(prof.insns);
+    free(prof.vec);
+    return result;
+}
@@ -0,0 +1,38 @@
+/*
+ * apex_simpoint.h
+ * Sampled simulation: only representative intervals of a run go through
+ * the pipeline
+ *
+ * The functional interpreter profiles the whole run as a basic-block
+ * vector per fixed-size interval of instructions. The vectors are randomly
+ * projected down to a few dimensions and clustered with k-means; from each
+ * cluster the interval nearest its centre is simulated in detail, after a
+ * short detailed warm-up. The CPI of the run is the average of theirs,
+ * weighted by the instructions each cluster covers. A second interval of
+ * every cluster with more than one gives an error estimate.
+ */
+#ifndef _APEX_SIMPOINT_H_
+#define _APEX_SIMPOINT_H_
+
+#include "apex_config.h"
+
+/* Defaults of the options */
+#define SIMPOINT_INTERVAL 10000
+#define SIMPOINT_MAX_CLUSTERS 10
+#define SIMPOINT_WARMUP 1000
+#define SIMPOINT_MAX_INSNS 100000000LL
+
+typedef struct APEX_SimPoint_Options
+{
+    long long interval;  /* Instructions per interval */
+    int max_clusters;    /* Largest k tried */
+    long long warmup;    /* Detailed instructions run before each measured interval */
+    long long max_insns; /* Profile at most this many instructions, 0 to run to HALT */
+    int verify;          /* Also simulate the whole profile in detail and report the true error */
+    APEX_Config config;  /* Microarchitecture of the detailed simulations */
+} APEX_SimPoint_Options;
+
+void APEX_simpoint_defaults(APEX_SimPoint_Options *opt);
+int APEX_simpoint_run(const char *filename, const APEX_SimPoint_Options *opt);
+
+#endif
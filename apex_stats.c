@@ -0,0 +1,226 @@
+/*
+ * apex_stats.c
+ * Gathers and prints the per-cycle statistics of the pipeline
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "apex_stats.h"
+
+static const char *const stall_names[STALL_COUNT] = {
+    [STALL_NONE] = "dispatched",
+    [STALL_ROB_FULL] = "ROB full",
+    [STALL_IQ_FULL] = "IQ full",
+    [STALL_LSQ_FULL] = "LSQ full",
+    [STALL_FREE_LIST] = "free list empty",
+    [STALL_FRONT_END] = "front end empty",
+};
+
+static const char *const cpi_names[CPI_COUNT] = {
+    [CPI_BASE] = "base",
+    [CPI_FRONTEND] = "frontend",
+    [CPI_BAD_SPECULATION] = "bad speculation",
+    [CPI_BACKEND_CORE] = "backend core",
+    [CPI_BACKEND_MEMORY] = "backend memory",
+};
+
+static const char *const fu_names[STATS_FU_COUNT] = {
+    [STATS_FU_INTFU] = "intfu",
+    [STATS_FU_LOGICALFU] = "logicalfu",
+    [STATS_FU_MUL] = "mulfu",
+    [STATS_FU_DCACHE] = "dcache",
+};
+
+static int
+fu_busy(const CPU_Stage *stage)
+{
+    return stage->has_insn && stage->opcode != OPCODE_NULL;
+}
+
+/* Starts gathering on a CPU that may already have run, printing a CPI stack
+ * every interval cycles if interval is not 0 */
+void
+APEX_stats_start(APEX_Stats *stats, const APEX_CPU *cpu, long long interval)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->config = cpu->config;
+    stats->interval = interval;
+    stats->last_retired = cpu->insn_completed;
+}
+
+/* What the commit slot of the cycle went to. Nothing after the ROB stage
+ * changes the ROB within a cycle, so its state at the end of the cycle is
+ * the one commit saw. */
+static int
+commit_slot(APEX_Stats *stats, const APEX_CPU *cpu)
+{
+    const CPU_Stage *head;
+
+    if (cpu->insn_completed != stats->last_retired)
+    {
+        stats->last_retired = cpu->insn_completed;
+        return CPI_BASE;
+    }
+    if (count(&cpu->reorder_buffer) == 0)
+    {
+        return cpu->branch_refill ? CPI_BAD_SPECULATION : CPI_FRONTEND;
+    }
+    head = &cpu->reorder_buffer.entry[cpu->reorder_buffer.head];
+    switch (head->opcode)
+    {
+    case OPCODE_LOAD:
+    case OPCODE_STORE:
+    case OPCODE_LDR:
+    case OPCODE_STR:
+        return CPI_BACKEND_MEMORY;
+    }
+    return CPI_BACKEND_CORE;
+}
+
+static void
+print_cpi_row(const char *label, const long long *cpi)
+{
+    long long cycles = 0;
+    int i;
+
+    for (i = 0; i < CPI_COUNT; ++i)
+    {
+        cycles += cpi[i];
+    }
+    printf("%-20s %10lld %10lld", label, cycles, cpi[CPI_BASE]);
+    if (cpi[CPI_BASE] == 0)
+    {
+        printf("  (nothing retired)\n");
+        return;
+    }
+    printf(" %7.3f", (double)cycles / cpi[CPI_BASE]);
+    for (i = 0; i < CPI_COUNT; ++i)
+    {
+        printf(" %8.3f", (double)cpi[i] / cpi[CPI_BASE]);
+    }
+    printf("\n");
+}
+
+static void
+print_cpi_header(const char *label)
+{
+    printf("%-20s %10s %10s %7s %8s %8s %8s %8s %8s\n", label, "Cycles", "Insns", "CPI", "Base", "Frontend",
+           "BadSpec", "Core", "Memory");
+}
+
+/* Called once at the end of every cycle, after dispatch has set
+ * cpu->dispatch_stall */
+void
+APEX_stats_sample(APEX_Stats *stats, const APEX_CPU *cpu)
+{
+    int slot = commit_slot(stats, cpu);
+
+    stats->cpi[slot]++;
+    stats->interval_cpi[slot]++;
+    stats->cycles++;
+    stats->dispatch[cpu->dispatch_stall]++;
+    stats->iq[count(&cpu->issue_queue)]++;
+    stats->rob[count(&cpu->reorder_buffer)]++;
+    stats->lsq[count(&cpu->load_store_queue)]++;
+    stats->free_list[free_list_count(&cpu->preg_free_list)]++;
+
+    /* A unit's latch holds the instruction it executes next cycle */
+    stats->fu_busy[STATS_FU_INTFU] += fu_busy(&cpu->intfu);
+    stats->fu_busy[STATS_FU_LOGICALFU] += fu_busy(&cpu->logicalfu);
+    stats->fu_busy[STATS_FU_MUL] += fu_busy(APEX_mul_entry((APEX_CPU *)cpu));
+    stats->fu_busy[STATS_FU_DCACHE] += fu_busy(&cpu->dcache);
+
+    if (stats->interval && stats->cycles % stats->interval == 0)
+    {
+        char label[32];
+
+        if (stats->cycles == stats->interval)
+        {
+            print_cpi_header("APEX_CPI: up to");
+        }
+        snprintf(label, sizeof(label), "APEX_CPI: %lld", stats->cycles);
+        print_cpi_row(label, stats->interval_cpi);
+        memset(stats->interval_cpi, 0, sizeof(stats->interval_cpi));
+        /* Shown as the run goes even when standard output is not a terminal */
+        fflush(stdout);
+    }
+}
+
+static double
+percent(long long part, long long whole)
+{
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+/* One line per structure: mean occupancy, then the share of cycles at each
+ * occupancy that occurred */
+static void
+print_histogram(const char *name, const long long *hist, int size, long long cycles)
+{
+    double sum = 0.0;
+    int n;
+
+    for (n = 0; n <= size; ++n)
+    {
+        sum += (double)n * hist[n];
+    }
+    printf("  %-9s %2d  mean %5.2f  |", name, size, cycles ? sum / cycles : 0.0);
+    for (n = 0; n <= size; ++n)
+    {
+        if (hist[n])
+        {
+            printf(" %d:%.1f%%", n, percent(hist[n], cycles));
+        }
+    }
+    printf("\n");
+}
+
+void
+APEX_stats_report(const APEX_Stats *stats)
+{
+    char config[256];
+    int i;
+
+    /* The last, partial interval */
+    if (stats->interval && stats->cycles % stats->interval)
+    {
+        char label[32];
+
+        if (stats->cycles < stats->interval)
+        {
+            print_cpi_header("APEX_CPI: up to");
+        }
+        snprintf(label, sizeof(label), "APEX_CPI: %lld", stats->cycles);
+        print_cpi_row(label, stats->interval_cpi);
+    }
+
+    APEX_config_format(&stats->config, NULL, config, sizeof(config));
+    printf("APEX_Stats: configuration %s\n", config);
+    printf("APEX_Stats: %lld cycles\n", stats->cycles);
+    printf("APEX_Stats: dispatch\n");
+    for (i = 0; i < STALL_COUNT; ++i)
+    {
+        printf("  %-16s %12lld  %5.1f%%\n", stall_names[i], stats->dispatch[i],
+               percent(stats->dispatch[i], stats->cycles));
+    }
+
+    printf("APEX_Stats: occupancy at the end of the cycle (size, mean | share of cycles at each count)\n");
+    print_histogram("IQ", stats->iq, stats->config.iq_size, stats->cycles);
+    print_histogram("ROB", stats->rob, stats->config.rob_size, stats->cycles);
+    print_histogram("LSQ", stats->lsq, stats->config.lsq_size, stats->cycles);
+    print_histogram("free list", stats->free_list, stats->config.pregs, stats->cycles);
+
+    printf("APEX_Stats: CPI stack, one commit slot per cycle\n");
+    for (i = 0; i < CPI_COUNT; ++i)
+    {
+        printf("  %-16s %12lld  %5.1f%%  CPI %.3f\n", cpi_names[i], stats->cpi[i], percent(stats->cpi[i], stats->cycles),
+               stats->cpi[CPI_BASE] ? (double)stats->cpi[i] / stats->cpi[CPI_BASE] : 0.0);
+    }
+
+    printf("APEX_Stats: function unit utilization\n");
+    for (i = 0; i < STATS_FU_COUNT; ++i)
+    {
+        printf("  %-16s %12lld  %5.1f%%\n", fu_names[i], stats->fu_busy[i],
+               percent(stats->fu_busy[i], stats->cycles));
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * apex_stats.h
+ * Per-cycle statistics of the pipeline
+ *
+ * Every cycle is put down to one dispatch outcome: an instruction left for
+ * the IQ and ROB, or the cause of there being none. A held instruction
+ * waits on the ROB before the IQ, and on the IQ before the LSQ, so a cycle
+ * with several of them full goes to the first. Alongside, the occupancy of
+ * the IQ, ROB, LSQ and free list is sampled at the end of every cycle, and
+ * intfu, logicalfu, the first MUL stage and dcache count as busy in the
+ * cycles they hold an instruction to execute. The report starts with the
+ * configuration the CPU was created with.
+ *
+ * The commit slot of every cycle also goes into a CPI stack. A cycle in
+ * which the ROB head retires is base. Otherwise the head says what the slot
+ * waited on: a load or store at the head is backend memory, anything else
+ * backend core. With the ROB empty the slot is lost to the front end, or to
+ * bad speculation if a taken BZ/BNZ flushed the pipeline and nothing of the
+ * right path has reached the ROB yet. Each part divided by the instructions
+ * retired gives its share of the CPI.
+ */
+#ifndef _APEX_STATS_H_
+#define _APEX_STATS_H_
+
+#include "apex_cpu.h"
+
+/* Dispatch outcome of a cycle */
+#define STALL_NONE 0      /* An instruction was dispatched */
+#define STALL_ROB_FULL 1  /* Dispatch held an instruction, the ROB was full */
+#define STALL_IQ_FULL 2   /* ... the IQ was full */
+#define STALL_LSQ_FULL 3  /* ... a load or store found the LSQ full */
+#define STALL_FREE_LIST 4 /* Decode held its instruction with no physical register to rename into */
+#define STALL_FRONT_END 5 /* Nothing reached dispatch: fetch waited on a JUMP, refilled after a flush, or stopped at HALT */
+#define STALL_COUNT 6
+
+/* Use of a cycle's commit slot */
+#define CPI_BASE 0
+#define CPI_FRONTEND 1
+#define CPI_BAD_SPECULATION 2
+#define CPI_BACKEND_CORE 3
+#define CPI_BACKEND_MEMORY 4
+#define CPI_COUNT 5
+
+/* Function units whose utilization is counted */
+#define STATS_FU_INTFU 0
+#define STATS_FU_LOGICALFU 1
+#define STATS_FU_MUL 2
+#define STATS_FU_DCACHE 3
+#define STATS_FU_COUNT 4
+
+typedef struct APEX_Stats
+{
+    APEX_Config config;
+    long long cycles;
+    long long dispatch[STALL_COUNT];
+    long long iq[IQ_MAX + 1]; /* Cycles ending with this many entries */
+    long long rob[ROB_MAX + 1];
+    long long lsq[LSQ_MAX + 1];
+    long long free_list[PREGS_MAX + 1];
+    long long fu_busy[STATS_FU_COUNT];
+    long long cpi[CPI_COUNT];
+
+    long long interval;                /* Cycles per printed CPI stack, 0 for none */
+    long long interval_cpi[CPI_COUNT]; /* CPI stack of the interval so far */
+    int last_retired;                  /* cpu->insn_completed at the last sample */
+} APEX_Stats;
+
+void APEX_stats_start(APEX_Stats *stats, const APEX_CPU *cpu, long long interval);
+void APEX_stats_sample(APEX_Stats *stats, const APEX_CPU *cpu);
+void APEX_stats_report(const APEX_Stats *stats);
+
+#endif
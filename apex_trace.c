@@ -0,0 +1,760 @@
+/*
+ * apex_trace.c
+ * Binary pipeline trace writer and reader, and the textual stage printers
+ * shared by the simulator and the apex_trace decoder
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "apex_trace.h"
+
+#define TRACE_BLOCK_SIZE (1 << 18) /* Bytes per ring block, one write each */
+#define TRACE_RING_BLOCKS 16
+#define TRACE_POLL_US 100 /* Idle writer thread and stalled simulator recheck this often */
+
+const char *const APEX_stage_names[STAGE_COUNT] = {
+    [STAGE_INTFU] = "intfu",
+    [STAGE_LOGICALFU] = "logicalfu",
+    [STAGE_MULFU4] = "mulfu4",
+    [STAGE_MULFU3] = "mulfu3",
+    [STAGE_MULFU2] = "mulfu2",
+    [STAGE_MULFU1] = "mulfu1",
+    [STAGE_DCACHE] = "dcache",
+    [STAGE_ROB] = "ROB ",
+    [STAGE_LSQ] = "LSQ",
+    [STAGE_ISSUEQ] = "Issueq",
+    [STAGE_DISPATCH] = "Dispatch/RF",
+    [STAGE_DECODE] = "Decode/RF",
+    [STAGE_FETCH] = "Fetch",
+};
+
+/* Prints an instruction as written in the program */
+void
+APEX_print_instruction(FILE *fp, const CPU_Stage *stage)
+{
+    const char *opcode_str = APEX_opcode_names[stage->opcode];
+
+    switch (stage->opcode)
+    {
+    case OPCODE_STR:
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_MUL:
+    case OPCODE_DIV:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_LDR:
+    case OPCODE_CMP:
+    {
+        fprintf(fp, "%s,R%d,R%d,R%d", opcode_str, stage->rd, stage->rs1,
+                stage->rs2);
+        break;
+    }
+
+    case OPCODE_MOVC:
+    {
+        fprintf(fp, "%s,R%d,#%d", opcode_str, stage->rd, stage->imm);
+        break;
+    }
+
+    case OPCODE_LOAD:
+    case OPCODE_ADDL:
+    case OPCODE_SUBL:
+
+    {
+        fprintf(fp, "%s,R%d,R%d,#%d ", opcode_str, stage->rd, stage->rs1,
+                stage->imm);
+        break;
+    }
+
+    case OPCODE_STORE:
+    {
+        fprintf(fp, "%s,R%d,R%d,#%d ", opcode_str, stage->rs1, stage->rs2,
+                stage->imm);
+        break;
+    }
+
+    case OPCODE_BZ:
+    case OPCODE_BNZ:
+    {
+        fprintf(fp, "%s,#%d ", opcode_str, stage->imm);
+        break;
+    }
+    case OPCODE_JUMP:
+    {
+        fprintf(fp, "%s R%d,#%d ", opcode_str, stage->rs1, stage->imm);
+        break;
+    }
+
+    case OPCODE_HALT:
+    {
+        fprintf(fp, "%s", opcode_str);
+        break;
+    }
+
+    case OPCODE_NULL:
+    {
+        fprintf(fp, " ");
+        break;
+    }
+    case OPCODE_NOP:
+        fprintf(fp, "%s", opcode_str);
+    }
+}
+
+static void
+print_instruction_with_renamed_registers(const CPU_Stage *stage)
+{
+    const char *opcode_str = APEX_opcode_names[stage->opcode];
+
+    switch (stage->opcode)
+    {
+    case OPCODE_STR:
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_MUL:
+    case OPCODE_DIV:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_LDR:
+    case OPCODE_CMP:
+    {
+        printf("%s,R%d,R%d,R%d\t\t%s,P%d,P%d,P%d", opcode_str, stage->rd, stage->rs1,
+               stage->rs2, opcode_str, stage->pd, stage->ps1, stage->ps2);
+        break;
+    }
+
+    case OPCODE_MOVC:
+    {
+        printf("%s,R%d,#%d\t\t%s,P%d,#%d", opcode_str, stage->rd, stage->imm, opcode_str, stage->pd, stage->imm);
+        break;
+    }
+
+    case OPCODE_LOAD:
+    case OPCODE_ADDL:
+    case OPCODE_SUBL:
+    {
+        printf("%s,R%d,R%d,#%d\t\t%s,P%d,P%d,#%d", opcode_str, stage->rd, stage->rs1,
+               stage->imm, opcode_str, stage->pd, stage->ps1, stage->imm);
+        break;
+    }
+
+    case OPCODE_STORE:
+    {
+        printf("%s,R%d,R%d,#%d\t%s,P%d,P%d,#%d", opcode_str, stage->rs1, stage->rs2,
+               stage->imm, opcode_str, stage->ps1, stage->ps2, stage->imm);
+        break;
+    }
+
+    case OPCODE_BZ:
+    case OPCODE_BNZ:
+    {
+        printf("%s,#%d", opcode_str, stage->imm);
+        break;
+    }
+
+    case OPCODE_HALT:
+    {
+        printf("%s", opcode_str);
+        break;
+    }
+    case OPCODE_JUMP:
+    {
+        printf("%s R%d,#%d\t", opcode_str, stage->rs1, stage->imm);
+        break;
+    }
+
+    case OPCODE_NULL:
+    {
+        printf(" ");
+        break;
+    }
+    case OPCODE_NOP:
+        printf("%s", opcode_str);
+    }
+}
+
+static void
+print_stage_content(const char *name, const CPU_Stage *stage)
+{
+    printf("%-15s: pc(%d) ", name, stage->pc);
+
+    print_instruction_with_renamed_registers(stage);
+
+    printf("\n");
+}
+
+static void
+print_stage_content_for_fetch(const char *name, const CPU_Stage *stage)
+{
+    printf("%-15s: pc(%d) ", name, stage->pc);
+    APEX_print_instruction(stdout, stage);
+    printf("\n");
+}
+
+/* Prints one stage line the way the interactive trace shows it */
+void
+APEX_print_stage(int stage_id, const CPU_Stage *stage)
+{
+    if (stage_id == STAGE_FETCH)
+    {
+        print_stage_content_for_fetch(APEX_stage_names[stage_id], stage);
+    }
+    else
+    {
+        print_stage_content(APEX_stage_names[stage_id], stage);
+    }
+}
+
+void
+APEX_print_regs(const int *regs, int free_regs, int pregs)
+{
+    int i;
+
+    printf("----------\n%s\n----------\n", "Registers:");
+
+    for (i = 0; i < REG_FILE_SIZE / 2; ++i)
+    {
+        printf("R%-3d[%-3d] ", i, regs[i]);
+    }
+
+    printf("\n");
+
+    for (i = (REG_FILE_SIZE / 2); i < REG_FILE_SIZE; ++i)
+    {
+        printf("R%-3d[%-3d] ", i, regs[i]);
+    }
+
+    printf("\n");
+    printf("Free physical registers: %d/%d\n", free_regs, pregs);
+}
+
+void
+APEX_print_code_memory(const APEX_Instruction *code, int size)
+{
+    int i;
+
+    printf("%-9s %-9s %-9s %-9s %-9s\n", "opcode_str", "rd", "rs1", "rs2",
+           "imm");
+
+    for (i = 0; i < size; ++i)
+    {
+        printf("%-9s %-9d %-9d %-9d %-9d\n", APEX_opcode_names[code[i].opcode],
+               code[i].rd, code[i].rs1, code[i].rs2, code[i].imm);
+    }
+}
+
+/* ====================== Writer ====================== */
+
+/*
+ * The simulator thread encodes events straight into a block of the ring and
+ * hands full blocks to a writer thread, which drains them to the file. The
+ * ring is single producer, single consumer: the simulator only advances
+ * tail, the writer only advances head, so no locks are taken.
+ */
+struct trace_block
+{
+    unsigned char *data;
+    int len;
+};
+
+struct trace_ring
+{
+    struct trace_block blocks[TRACE_RING_BLOCKS];
+    _Atomic unsigned int head; /* Next block the writer thread drains */
+    _Atomic unsigned int tail; /* Next block the simulator publishes */
+    _Atomic int done;
+    unsigned char *scratch; /* Header, and events that are being dropped */
+    pthread_t thread;
+    FILE *fp;
+    long long bytes;
+};
+
+static void
+sleep_us(long us)
+{
+    struct timespec ts = {0, us * 1000};
+
+    nanosleep(&ts, NULL);
+}
+
+static long long
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *
+trace_writer_main(void *arg)
+{
+    struct trace_ring *ring = arg;
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    while (TRUE)
+    {
+        if (head == atomic_load_explicit(&ring->tail, memory_order_acquire))
+        {
+            if (atomic_load_explicit(&ring->done, memory_order_acquire) && head == atomic_load_explicit(&ring->tail, memory_order_acquire))
+            {
+                break;
+            }
+            sleep_us(TRACE_POLL_US);
+            continue;
+        }
+
+        struct trace_block *block = &ring->blocks[head % TRACE_RING_BLOCKS];
+        fwrite(block->data, 1, block->len, ring->fp);
+        ring->bytes += block->len;
+        atomic_store_explicit(&ring->head, ++head, memory_order_release);
+    }
+    return NULL;
+}
+
+/* Every block opens with a sync point so the decoder can pick up the stream
+ * after blocks were dropped: deltas restart from zero and the register file
+ * is restated. */
+static void
+trace_write_sync(APEX_Trace *t)
+{
+    int i;
+
+    t->last_pc = 0;
+    t->last_tag = 0;
+    t->decode_pc = -1;
+    trace_put_byte(t, TRACE_EV_SYNC);
+    trace_put_uvarint(t, t->cpu->clock);
+    trace_put_uvarint(t, (unsigned int)t->dropped);
+    for (i = 0; i < REG_FILE_SIZE; ++i)
+    {
+        trace_put_svarint(t, t->cpu->regs[i]);
+    }
+}
+
+/* Points the encoder at the next free block. With the ring full, either wait
+ * for the writer thread or, under TRACE_DROP, encode into scratch space whose
+ * events are counted as dropped. */
+static void
+trace_begin_block(APEX_Trace *t, int policy)
+{
+    struct trace_ring *ring = t->ring;
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    long long start = 0;
+
+    while (tail - atomic_load_explicit(&ring->head, memory_order_acquire) >= TRACE_RING_BLOCKS)
+    {
+        if (policy == TRACE_DROP)
+        {
+            t->dropping = TRUE;
+            t->buf = ring->scratch;
+            goto begin;
+        }
+        if (!start)
+        {
+            start = now_ns();
+            t->stalls++;
+        }
+        sleep_us(TRACE_POLL_US);
+    }
+    if (start)
+    {
+        t->stall_ns += now_ns() - start;
+    }
+    t->dropping = FALSE;
+    t->buf = ring->blocks[tail % TRACE_RING_BLOCKS].data;
+
+begin:
+    t->len = 0;
+    t->block_events = t->events;
+    trace_write_sync(t);
+}
+
+/* Hands the current block to the writer thread, or counts its events as
+ * dropped if it never got a place in the ring */
+static void
+trace_publish(APEX_Trace *t)
+{
+    struct trace_ring *ring = t->ring;
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (t->dropping)
+    {
+        t->dropped += t->events - t->block_events;
+    }
+    else
+    {
+        ring->blocks[tail % TRACE_RING_BLOCKS].len = t->len;
+        atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    }
+}
+
+static void
+trace_write_header(APEX_Trace *t, int pregs)
+{
+    int i;
+
+    memcpy(t->buf, TRACE_MAGIC, 4);
+    t->len = 4;
+    trace_put_byte(t, TRACE_VERSION);
+    trace_put_uvarint(t, pregs);
+    trace_put_uvarint(t, t->code_size);
+    for (i = 0; i < t->code_size; ++i)
+    {
+        if (t->len + TRACE_EVENT_MAX > t->cap)
+        {
+            fwrite(t->buf, 1, t->len, t->ring->fp);
+            t->ring->bytes += t->len;
+            t->len = 0;
+        }
+        trace_put_byte(t, t->code[i].opcode);
+        trace_put_svarint(t, t->code[i].rd);
+        trace_put_svarint(t, t->code[i].rs1);
+        trace_put_svarint(t, t->code[i].rs2);
+        trace_put_svarint(t, t->code[i].imm);
+    }
+    fwrite(t->buf, 1, t->len, t->ring->fp);
+    t->ring->bytes += t->len;
+}
+
+/* Opens a trace of cpu's run. policy says what to do when the writer thread
+ * falls behind: TRACE_STALL waits for it, TRACE_DROP discards events. */
+int
+APEX_trace_open(APEX_Trace *t, const char *filename, const APEX_CPU *cpu, int policy)
+{
+    struct trace_ring *ring;
+    int i;
+
+    memset(t, 0, sizeof(*t));
+    ring = calloc(1, sizeof(*ring));
+    if (!ring)
+    {
+        return -1;
+    }
+    ring->fp = fopen(filename, "wb");
+    if (!ring->fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to create trace file %s\n", filename);
+        free(ring);
+        return -1;
+    }
+    ring->scratch = malloc(TRACE_BLOCK_SIZE);
+    for (i = 0; i < TRACE_RING_BLOCKS; ++i)
+    {
+        ring->blocks[i].data = malloc(TRACE_BLOCK_SIZE);
+        if (!ring->blocks[i].data || !ring->scratch)
+        {
+            fprintf(stderr, "APEX_Error: Out of memory for trace buffers\n");
+            exit(1);
+        }
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->done, FALSE);
+
+    t->ring = ring;
+    t->policy = policy;
+    t->cpu = cpu;
+    t->cap = TRACE_BLOCK_SIZE;
+    t->code = cpu->code_memory;
+    t->code_size = cpu->code_memory_size;
+
+    t->buf = ring->scratch;
+    trace_write_header(t, cpu->config.pregs);
+
+    if (pthread_create(&ring->thread, NULL, trace_writer_main, ring) != 0)
+    {
+        fprintf(stderr, "APEX_Error: Unable to start trace writer thread\n");
+        exit(1);
+    }
+    trace_begin_block(t, policy);
+    return 0;
+}
+
+/* Called by the inline encoders when the current block is full */
+void
+APEX_trace_flush(APEX_Trace *t)
+{
+    trace_publish(t);
+    trace_begin_block(t, t->policy);
+}
+
+/* Last event of a run: how it ended and the final counts */
+void
+APEX_trace_end(APEX_Trace *t, int status, const APEX_CPU *cpu)
+{
+    trace_reserve(t);
+    trace_put_byte(t, TRACE_EV_END);
+    trace_put_uvarint(t, status);
+    trace_put_uvarint(t, cpu->clock);
+    trace_put_uvarint(t, cpu->insn_completed);
+    t->events++;
+}
+
+/* Publishes what is left, waiting for room even under TRACE_DROP so the end
+ * of the run is never lost, then stops the writer thread */
+void
+APEX_trace_close(APEX_Trace *t)
+{
+    struct trace_ring *ring = t->ring;
+    int i;
+
+    if (!ring)
+    {
+        return;
+    }
+    if (t->dropping)
+    {
+        /* The scratch block starts with its own sync point, so it can be
+         * moved into the ring as it is */
+        unsigned char *scratch = t->buf;
+        int len = t->len;
+
+        trace_begin_block(t, TRACE_STALL);
+        memcpy(t->buf, scratch, len);
+        t->len = len;
+    }
+    trace_publish(t);
+
+    atomic_store_explicit(&ring->done, TRUE, memory_order_release);
+    pthread_join(ring->thread, NULL);
+    fclose(ring->fp);
+    t->bytes = ring->bytes;
+
+    for (i = 0; i < TRACE_RING_BLOCKS; ++i)
+    {
+        free(ring->blocks[i].data);
+    }
+    free(ring->scratch);
+    free(ring);
+    t->ring = NULL;
+    t->buf = NULL;
+}
+
+/* ====================== Reader ====================== */
+
+static int
+get_uvarint(FILE *fp, unsigned int *v)
+{
+    unsigned int result = 0;
+    int shift = 0;
+    int c;
+
+    do
+    {
+        c = getc(fp);
+        if (c == EOF || shift > 28)
+        {
+            return -1;
+        }
+        result |= (unsigned int)(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    *v = result;
+    return 0;
+}
+
+static int
+get_svarint(FILE *fp, int *v)
+{
+    unsigned int u;
+
+    if (get_uvarint(fp, &u) < 0)
+    {
+        return -1;
+    }
+    *v = (int)(u >> 1) ^ -(int)(u & 1);
+    return 0;
+}
+
+int
+APEX_trace_open_read(APEX_Trace_Reader *r, const char *filename)
+{
+    char magic[4];
+    unsigned int version, pregs, size;
+    int i, rd, rs1, rs2, imm, opcode;
+
+    memset(r, 0, sizeof(*r));
+    r->fp = fopen(filename, "rb");
+    if (!r->fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to open trace file %s\n", filename);
+        return -1;
+    }
+    if (fread(magic, 1, 4, r->fp) != 4 || memcmp(magic, TRACE_MAGIC, 4) != 0 || (version = getc(r->fp)) != TRACE_VERSION || get_uvarint(r->fp, &pregs) < 0 || get_uvarint(r->fp, &size) < 0)
+    {
+        fprintf(stderr, "APEX_Error: %s is not an APEX trace\n", filename);
+        APEX_trace_close_read(r);
+        return -1;
+    }
+    r->pregs = pregs;
+    r->code_size = size;
+    r->code = calloc(size ? size : 1, sizeof(APEX_Instruction));
+    for (i = 0; i < r->code_size; ++i)
+    {
+        opcode = getc(r->fp);
+        if (opcode == EOF || get_svarint(r->fp, &rd) < 0 || get_svarint(r->fp, &rs1) < 0 || get_svarint(r->fp, &rs2) < 0 || get_svarint(r->fp, &imm) < 0)
+        {
+            fprintf(stderr, "APEX_Error: %s: truncated trace header\n", filename);
+            APEX_trace_close_read(r);
+            return -1;
+        }
+        r->code[i].opcode = opcode;
+        r->code[i].rd = rd;
+        r->code[i].rs1 = rs1;
+        r->code[i].rs2 = rs2;
+        r->code[i].imm = imm;
+    }
+    return 0;
+}
+
+/* Reads the next event. Returns 1 on success, 0 at the end of the trace and
+ * -1 if the trace is truncated or corrupt. */
+int
+APEX_trace_next(APEX_Trace_Reader *r, APEX_Trace_Event *ev)
+{
+    int kind = getc(r->fp);
+    unsigned int u1, u2, u3;
+    int s1, s2, s3, s4, s5;
+
+    if (kind == EOF)
+    {
+        return 0;
+    }
+    memset(ev, 0, sizeof(*ev));
+    ev->cycle = r->cycle;
+
+    if (kind < TRACE_EV_STAGE_RAW + STAGE_COUNT && (kind & 0x0f) < STAGE_COUNT)
+    {
+        CPU_Stage *insn = &ev->insn;
+
+        ev->kind = TRACE_EV_STAGE;
+        ev->stage = kind & 0x0f;
+        if (kind >= TRACE_EV_STAGE_RAW)
+        {
+            int opcode = getc(r->fp);
+            if (opcode == EOF || get_svarint(r->fp, &s1) < 0 || get_svarint(r->fp, &s2) < 0 || get_svarint(r->fp, &s3) < 0 || get_svarint(r->fp, &s4) < 0)
+            {
+                return -1;
+            }
+            insn->opcode = opcode;
+            insn->rd = s1;
+            insn->rs1 = s2;
+            insn->rs2 = s3;
+            insn->imm = s4;
+        }
+        if (get_svarint(r->fp, &s1) < 0 || get_svarint(r->fp, &s2) < 0 || get_svarint(r->fp, &s3) < 0 || get_svarint(r->fp, &s4) < 0 || get_svarint(r->fp, &s5) < 0)
+        {
+            return -1;
+        }
+        r->last_pc += s1;
+        r->last_tag += s2;
+        insn->pc = r->last_pc;
+        insn->rob_tag = r->last_tag;
+        insn->pd = s3;
+        insn->ps1 = s4;
+        insn->ps2 = s5;
+        insn->has_insn = TRUE;
+        if (kind < TRACE_EV_STAGE_RAW)
+        {
+            int index = (insn->pc - 4000) / 4;
+            if (index < 0 || index >= r->code_size)
+            {
+                return -1;
+            }
+            insn->opcode = r->code[index].opcode;
+            insn->rd = r->code[index].rd;
+            insn->rs1 = r->code[index].rs1;
+            insn->rs2 = r->code[index].rs2;
+            insn->imm = r->code[index].imm;
+        }
+        return 1;
+    }
+
+    ev->kind = kind;
+    switch (kind)
+    {
+    case TRACE_EV_CYCLE_END:
+    {
+        if (get_uvarint(r->fp, &u1) < 0)
+        {
+            return -1;
+        }
+        ev->free_regs = u1;
+        r->cycle++;
+        return 1;
+    }
+    case TRACE_EV_DECODE_PC:
+    {
+        if (get_svarint(r->fp, &s1) < 0)
+        {
+            return -1;
+        }
+        ev->insn.pc = s1;
+        return 1;
+    }
+    case TRACE_EV_REG:
+    {
+        if (get_uvarint(r->fp, &u1) < 0 || get_svarint(r->fp, &s1) < 0 || u1 >= REG_FILE_SIZE)
+        {
+            return -1;
+        }
+        ev->rd = u1;
+        ev->value = s1;
+        return 1;
+    }
+    case TRACE_EV_END:
+    {
+        if (get_uvarint(r->fp, &u1) < 0 || get_uvarint(r->fp, &u2) < 0 || get_uvarint(r->fp, &u3) < 0)
+        {
+            return -1;
+        }
+        ev->status = u1;
+        ev->cycle = u2;
+        ev->insns = u3;
+        return 1;
+    }
+    case TRACE_EV_SYNC:
+    {
+        int i;
+
+        if (get_uvarint(r->fp, &u1) < 0 || get_uvarint(r->fp, &u2) < 0)
+        {
+            return -1;
+        }
+        for (i = 0; i < REG_FILE_SIZE; ++i)
+        {
+            if (get_svarint(r->fp, &ev->regs[i]) < 0)
+            {
+                return -1;
+            }
+        }
+        r->cycle = u1;
+        r->last_pc = 0;
+        r->last_tag = 0;
+        ev->cycle = u1;
+        ev->dropped = u2;
+        return 1;
+    }
+    }
+    return -1;
+}
+
+void
+APEX_trace_close_read(APEX_Trace_Reader *r)
+{
+    if (r->fp)
+    {
+        fclose(r->fp);
+    }
+    free(r->code);
+    r->fp = NULL;
+    r->code = NULL;
+}
@@ -0,0 +1,270 @@
+/*
+ * apex_trace.h
+ * Binary pipeline trace: writer used by the simulator, reader used by the
+ * apex_trace tool, and the textual stage printers both share
+ *
+ * A trace file is a header followed by a stream of events. The header holds
+ * the program image, so an event for an instruction that matches its code
+ * memory entry only needs the pc (as a delta), ROB tag and physical
+ * registers. All numbers are LEB128 varints, signed ones zigzag encoded.
+ *
+ *   header: "APXT" version  pregs  code_size  { opcode rd rs1 rs2 imm }*
+ *   events: kind byte, then the fields of that kind
+ *
+ * The simulator only encodes events into memory. A writer thread drains the
+ * encoded blocks to the file, so tracing costs the cycle loop little more
+ * than the encoding. Each block opens with a sync event, which lets the
+ * stream resume cleanly when blocks were dropped.
+ */
+#ifndef _APEX_TRACE_H_
+#define _APEX_TRACE_H_
+
+#include <stdio.h>
+
+#include "apex_cpu.h"
+
+#define TRACE_MAGIC "APXT"
+#define TRACE_VERSION 2
+
+/* How a cycle function reports what happens in the pipeline */
+#define TRACE_OFF 0
+#define TRACE_TEXT 1
+#define TRACE_BINARY 2
+#define TRACE_KANATA 3
+
+/* Stage ids, in the order the stages print within a cycle */
+#define STAGE_INTFU 0
+#define STAGE_LOGICALFU 1
+#define STAGE_MULFU4 2
+#define STAGE_MULFU3 3
+#define STAGE_MULFU2 4
+#define STAGE_MULFU1 5
+#define STAGE_DCACHE 6
+#define STAGE_ROB 7
+#define STAGE_LSQ 8
+#define STAGE_ISSUEQ 9
+#define STAGE_DISPATCH 10
+#define STAGE_DECODE 11
+#define STAGE_FETCH 12
+#define STAGE_COUNT 13
+
+/* Event kinds */
+#define TRACE_EV_STAGE 0x00     /* + stage id: instruction matching code memory */
+#define TRACE_EV_STAGE_RAW 0x10 /* + stage id: instruction with explicit fields */
+#define TRACE_EV_CYCLE_END 0x20 /* free_regs */
+#define TRACE_EV_DECODE_PC 0x21 /* pc latched in decode, sent when it changes */
+#define TRACE_EV_REG 0x22       /* rd value: register written at retirement */
+#define TRACE_EV_END 0x23       /* status cycles insns */
+#define TRACE_EV_SYNC 0x24      /* cycle dropped regs[]: deltas restart from 0 */
+
+/* What the simulator does when the writer thread falls behind */
+#define TRACE_STALL 0 /* Wait for it: every event is kept */
+#define TRACE_DROP 1  /* Discard whole blocks of events and keep running */
+
+/* Largest encoding of any event but sync, which only opens a block */
+#define TRACE_EVENT_MAX 64
+
+extern const char *const APEX_stage_names[STAGE_COUNT];
+
+typedef struct APEX_Trace
+{
+    struct trace_ring *ring;
+    unsigned char *buf; /* Block being encoded */
+    int len;
+    int cap;
+    int last_pc;
+    int last_tag;
+    int decode_pc;
+    const APEX_Instruction *code;
+    int code_size;
+    const APEX_CPU *cpu; /* Read for the sync event of each block */
+    int policy;
+    int dropping;           /* Current block has no place in the ring */
+    long long block_events; /* events when the current block started */
+    long long events;       /* Events encoded, dropped ones included */
+    long long dropped;      /* Events discarded under TRACE_DROP */
+    long long stalls;       /* Times the simulator waited for the writer */
+    long long stall_ns;     /* Time spent waiting */
+    long long bytes;        /* Size of the file, known once closed */
+} APEX_Trace;
+
+/* One decoded event */
+typedef struct APEX_Trace_Event
+{
+    int kind;        /* TRACE_EV_STAGE for both stage kinds */
+    int stage;
+    long long cycle; /* Cycle the event happened in */
+    CPU_Stage insn;
+    int rd;
+    int value;
+    int free_regs;
+    int status;
+    int insns;
+    int regs[REG_FILE_SIZE]; /* Register file at a sync event */
+    long long dropped;       /* Events dropped before a sync event */
+} APEX_Trace_Event;
+
+typedef struct APEX_Trace_Reader
+{
+    FILE *fp;
+    APEX_Instruction *code;
+    int code_size;
+    int pregs;
+    long long cycle;
+    int last_pc;
+    int last_tag;
+} APEX_Trace_Reader;
+
+int APEX_trace_open(APEX_Trace *t, const char *filename, const APEX_CPU *cpu, int policy);
+void APEX_trace_flush(APEX_Trace *t);
+void APEX_trace_end(APEX_Trace *t, int status, const APEX_CPU *cpu);
+void APEX_trace_close(APEX_Trace *t);
+
+int APEX_trace_open_read(APEX_Trace_Reader *r, const char *filename);
+int APEX_trace_next(APEX_Trace_Reader *r, APEX_Trace_Event *ev);
+void APEX_trace_close_read(APEX_Trace_Reader *r);
+
+void APEX_print_instruction(FILE *fp, const CPU_Stage *stage);
+void APEX_print_stage(int stage_id, const CPU_Stage *stage);
+void APEX_print_regs(const int *regs, int free_regs, int pregs);
+void APEX_print_code_memory(const APEX_Instruction *code, int size);
+
+/* Makes room for one more event */
+static inline void
+trace_reserve(APEX_Trace *t)
+{
+    if (t->len + TRACE_EVENT_MAX > t->cap)
+    {
+        APEX_trace_flush(t);
+    }
+}
+
+/*
+ * The encoders below write through a local cursor and store the length back
+ * once per event: stores through an unsigned char pointer may alias any
+ * field of the APEX_Trace, so updating t->len byte by byte would reload and
+ * store it around every byte.
+ */
+static inline unsigned char *
+trace_enc_uvarint(unsigned char *p, unsigned int v)
+{
+    while (v >= 0x80)
+    {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+static inline unsigned char *
+trace_enc_svarint(unsigned char *p, int v)
+{
+    return trace_enc_uvarint(p, ((unsigned int)v << 1) ^ (unsigned int)(v >> 31));
+}
+
+static inline void
+trace_put_byte(APEX_Trace *t, unsigned int b)
+{
+    t->buf[t->len++] = (unsigned char)b;
+}
+
+static inline void
+trace_put_uvarint(APEX_Trace *t, unsigned int v)
+{
+    t->len = (int)(trace_enc_uvarint(t->buf + t->len, v) - t->buf);
+}
+
+static inline void
+trace_put_svarint(APEX_Trace *t, int v)
+{
+    t->len = (int)(trace_enc_svarint(t->buf + t->len, v) - t->buf);
+}
+
+/* Records the instruction held by a stage (or a queue entry) this cycle */
+static inline void
+APEX_trace_stage(APEX_Trace *t, int stage_id, const CPU_Stage *stage)
+{
+    int index = (stage->pc - 4000) / 4;
+    const APEX_Instruction *ins = NULL;
+    unsigned char *p;
+    int last_pc, last_tag;
+
+    trace_reserve(t);
+    p = t->buf + t->len;
+    last_pc = t->last_pc;
+    last_tag = t->last_tag;
+    if (index >= 0 && index < t->code_size)
+    {
+        ins = &t->code[index];
+    }
+    if (ins && ins->opcode == stage->opcode && ins->rd == stage->rd && ins->rs1 == stage->rs1 && ins->rs2 == stage->rs2 && ins->imm == stage->imm)
+    {
+        *p++ = TRACE_EV_STAGE + stage_id;
+    }
+    else
+    {
+        *p++ = TRACE_EV_STAGE_RAW + stage_id;
+        *p++ = (unsigned char)stage->opcode;
+        p = trace_enc_svarint(p, stage->rd);
+        p = trace_enc_svarint(p, stage->rs1);
+        p = trace_enc_svarint(p, stage->rs2);
+        p = trace_enc_svarint(p, stage->imm);
+    }
+    p = trace_enc_svarint(p, stage->pc - last_pc);
+    p = trace_enc_svarint(p, stage->rob_tag - last_tag);
+    p = trace_enc_svarint(p, stage->pd);
+    p = trace_enc_svarint(p, stage->ps1);
+    p = trace_enc_svarint(p, stage->ps2);
+    t->len = (int)(p - t->buf);
+    t->last_pc = stage->pc;
+    t->last_tag = stage->rob_tag;
+    t->events++;
+}
+
+static inline void
+APEX_trace_decode_pc(APEX_Trace *t, int pc)
+{
+    unsigned char *p;
+
+    if (pc == t->decode_pc)
+    {
+        return;
+    }
+    t->decode_pc = pc;
+    trace_reserve(t);
+    p = t->buf + t->len;
+    *p++ = TRACE_EV_DECODE_PC;
+    p = trace_enc_svarint(p, pc);
+    t->len = (int)(p - t->buf);
+    t->events++;
+}
+
+static inline void
+APEX_trace_reg(APEX_Trace *t, int rd, int value)
+{
+    unsigned char *p;
+
+    trace_reserve(t);
+    p = t->buf + t->len;
+    *p++ = TRACE_EV_REG;
+    p = trace_enc_uvarint(p, rd);
+    p = trace_enc_svarint(p, value);
+    t->len = (int)(p - t->buf);
+    t->events++;
+}
+
+static inline void
+APEX_trace_cycle_end(APEX_Trace *t, int free_regs)
+{
+    unsigned char *p;
+
+    trace_reserve(t);
+    p = t->buf + t->len;
+    *p++ = TRACE_EV_CYCLE_END;
+    p = trace_enc_uvarint(p, free_regs);
+    t->len = (int)(p - t->buf);
+    t->events++;
+}
+
+#endif
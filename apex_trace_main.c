@@ -0,0 +1,210 @@
+/*
+ * apex_trace_main.c
+ * apex_trace: decodes a binary pipeline trace written by apex_sim --trace
+ * back into the interactive textual format, optionally limited to a cycle
+ * range or to the instruction at one pc
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apex_trace.h"
+
+typedef struct trace_filter
+{
+    long long from; /* First cycle shown */
+    long long to;   /* Last cycle shown, -1 for no limit */
+    int pc;         /* Only stage lines of this pc, -1 for all */
+} trace_filter;
+
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr, "APEX_Help: Usage %s [--from CYCLE] [--to CYCLE] [--pc PC] <trace_file>\n", prog);
+}
+
+static int
+cycle_shown(const trace_filter *f, long long cycle)
+{
+    return cycle >= f->from && (f->to < 0 || cycle <= f->to);
+}
+
+/* Prints the cycle banner before the first line shown for a cycle */
+static void
+begin_cycle(long long cycle, long long *banner_cycle)
+{
+    if (*banner_cycle == cycle)
+    {
+        return;
+    }
+    *banner_cycle = cycle;
+    printf("--------------------------------------------\n");
+    printf("Clock Cycle #: %lld\n", cycle);
+    printf("--------------------------------------------\n");
+}
+
+static int
+decode_trace(APEX_Trace_Reader *r, const trace_filter *f)
+{
+    APEX_Trace_Event ev;
+    int regs[REG_FILE_SIZE] = {0};
+    int decode_pc = 0;
+    int decode_printed = FALSE;
+    long long dropped = 0;
+    long long banner_cycle = -1;
+    long long cycle = 0;
+    int full = f->pc < 0;
+    int rc;
+
+    if (full && f->from == 0)
+    {
+        APEX_print_code_memory(r->code, r->code_size);
+    }
+
+    while ((rc = APEX_trace_next(r, &ev)) > 0)
+    {
+        int shown = cycle_shown(f, ev.cycle);
+
+        if (ev.cycle != cycle)
+        {
+            cycle = ev.cycle;
+            decode_printed = FALSE;
+        }
+        if (f->to >= 0 && ev.cycle > f->to && ev.kind != TRACE_EV_END)
+        {
+            continue;
+        }
+
+        switch (ev.kind)
+        {
+        case TRACE_EV_STAGE:
+        {
+            /* Decode announces its latch just before the decode and fetch lines */
+            if (full && shown && ev.stage >= STAGE_DECODE && !decode_printed)
+            {
+                begin_cycle(cycle, &banner_cycle);
+                printf("In decode %d\t\n", decode_pc);
+                decode_printed = TRUE;
+            }
+            if (shown && (full || ev.insn.pc == f->pc))
+            {
+                begin_cycle(cycle, &banner_cycle);
+                APEX_print_stage(ev.stage, &ev.insn);
+            }
+            break;
+        }
+        case TRACE_EV_SYNC:
+        {
+            /* Restates the register file, which matters after a gap */
+            memcpy(regs, ev.regs, sizeof(regs));
+            if (ev.dropped > dropped)
+            {
+                printf("APEX_TRACE: %lld events dropped before cycle %lld\n", ev.dropped - dropped, ev.cycle);
+                dropped = ev.dropped;
+            }
+            break;
+        }
+        case TRACE_EV_DECODE_PC:
+        {
+            decode_pc = ev.insn.pc;
+            break;
+        }
+        case TRACE_EV_REG:
+        {
+            regs[ev.rd] = ev.value;
+            break;
+        }
+        case TRACE_EV_CYCLE_END:
+        {
+            if (full && shown)
+            {
+                begin_cycle(cycle, &banner_cycle);
+                if (!decode_printed)
+                {
+                    printf("In decode %d\t\n", decode_pc);
+                }
+                APEX_print_regs(regs, ev.free_regs, r->pregs);
+            }
+            break;
+        }
+        case TRACE_EV_END:
+        {
+            switch (ev.status)
+            {
+            case APEX_RUN_HALTED:
+                printf("APEX_CPU: Simulation Complete, cycles = %lld instructions = %d\n", ev.cycle, ev.insns);
+                break;
+            case APEX_RUN_CYCLE_LIMIT:
+                printf("APEX_CPU: Cycle limit reached, cycles = %lld instructions = %d\n", ev.cycle, ev.insns);
+                break;
+            case APEX_RUN_INSN_LIMIT:
+                printf("APEX_CPU: Instruction limit reached, cycles = %lld instructions = %d\n", ev.cycle, ev.insns);
+                break;
+            case APEX_RUN_FAULT:
+                printf("APEX_CPU: Simulation Stopped on a fault, cycles = %lld instructions = %d\n", ev.cycle, ev.insns);
+                break;
+            default:
+                printf("APEX_CPU: Simulation Stopped, cycles = %lld instructions = %d\n", ev.cycle, ev.insns);
+                break;
+            }
+            return 0;
+        }
+        }
+    }
+
+    if (rc < 0)
+    {
+        fprintf(stderr, "APEX_Error: Corrupt trace after cycle %lld\n", cycle);
+        return 1;
+    }
+    fprintf(stderr, "APEX_Error: Trace ends before the end of the run (cycle %lld)\n", cycle);
+    return 1;
+}
+
+int
+main(int argc, char const *argv[])
+{
+    APEX_Trace_Reader reader;
+    trace_filter filter = {0, -1, -1};
+    const char *filename = NULL;
+    int rc, i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--from") == 0 && i + 1 < argc)
+        {
+            filter.from = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc)
+        {
+            filter.to = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--pc") == 0 && i + 1 < argc)
+        {
+            filter.pc = atoi(argv[++i]);
+        }
+        else if (!filename && argv[i][0] != '-')
+        {
+            filename = argv[i];
+        }
+        else
+        {
+            filename = NULL;
+            break;
+        }
+    }
+
+    if (!filename)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (APEX_trace_open_read(&reader, filename) < 0)
+    {
+        return 1;
+    }
+    rc = decode_trace(&reader, &filter);
+    APEX_trace_close_read(&reader);
+    return rc;
+}
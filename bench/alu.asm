@@ -0,0 +1,14 @@
+MOVC R0,#0
+MOVC R1,#200000
+MOVC R2,#3
+MOVC R3,#5
+ADD R4,R2,R3
+SUB R5,R3,R2
+AND R6,R4,R5
+OR R7,R4,R2
+EXOR R8,R6,R7
+ADDL R9,R8,#1
+SUBL R1,R1,#1
+CMP R10,R1,R0
+BNZ #-32
+HALT
@@ -0,0 +1,641 @@
+/*
+ * apex_bench.c
+ * Host-throughput benchmark of apex_sim: runs a fixed job list headless a
+ * number of times, reports simulated cycles and instructions per second,
+ * wall time and peak RSS, and checks them against a stored baseline
+ *
+ * Every run is a fresh apex_sim process, so its peak RSS and startup are
+ * measured along with the simulation. Throughput is taken at the fastest
+ * of the repeats: noise on the host only ever adds time, so the best run
+ * is the steadiest figure to compare against a baseline.
+ *
+ * With --check it instead runs every job once in the pipeline and once on
+ * the functional interpreter, and fails if they end differently.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_REPEAT 5
+#define BENCH_THRESHOLD 10.0 /* Largest throughput loss tolerated, in percent */
+#define BENCH_MAX_JOBS 256
+#define BENCH_OUTPUT_SIZE 65536
+#define BENCH_MAX_SETTINGS 16
+#define BENCH_FUNCTIONAL "2000000000" /* --fast-forward that runs a whole check job on the interpreter */
+
+/* One program of the job list and its measurements */
+typedef struct bench_job
+{
+    char *filename;
+    char *max_cycles;   /* Passed on to apex_sim as given, or NULL */
+    char *fast_forward; /* Likewise */
+    char *settings[BENCH_MAX_SETTINGS]; /* Configuration settings, passed on with --set */
+    int nsettings;
+    double ipc_low;     /* Expected IPC band, checked when ipc_high > 0 */
+    double ipc_high;
+
+    long long cycles;
+    long long insns;
+    double *seconds; /* Wall time of every repeat */
+    long peak_rss;   /* KiB, largest of the repeats */
+    int failed;
+
+    double median, mean, stddev, min;
+} bench_job;
+
+/* A line of a results file */
+typedef struct bench_result
+{
+    char program[256];
+    long long cycles;
+    double cycles_per_second;
+} bench_result;
+
+static double
+now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr, "APEX_Help: Usage %s [--sim PATH] [--repeat N] [--out FILE] [--baseline FILE] [--threshold PCT] <job_list>\n", prog);
+    fprintf(stderr, "           %s [--sim PATH] --check <job_list>\n", prog);
+}
+
+/* Reads a job list in the format of apex_sim --batch, where a job may also
+ * give the band its IPC must fall in as ipc=LOW-HIGH. apex_sim checks the
+ * configuration settings when it runs the job. */
+static int
+load_jobs(const char *filename, bench_job *jobs)
+{
+    FILE *fp = fopen(filename, "r");
+    char *line = NULL;
+    size_t len = 0;
+    int count = 0, line_num = 0;
+
+    if (!fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to open job list %s\n", filename);
+        return -1;
+    }
+    while (getline(&line, &len, fp) != -1)
+    {
+        char *save;
+        char *token = strtok_r(line, " \t\r\n", &save);
+        bench_job *job;
+
+        line_num++;
+        if (!token || token[0] == '#')
+        {
+            continue;
+        }
+        if (count == BENCH_MAX_JOBS)
+        {
+            fprintf(stderr, "APEX_Error: %s has more than %d jobs\n", filename, BENCH_MAX_JOBS);
+            break;
+        }
+        job = &jobs[count++];
+        memset(job, 0, sizeof(*job));
+        job->filename = strdup(token);
+        while ((token = strtok_r(NULL, " \t\r\n", &save)) != NULL)
+        {
+            if (strncmp(token, "max_cycles=", 11) == 0)
+            {
+                job->max_cycles = strdup(token + 11);
+            }
+            else if (strncmp(token, "fast_forward=", 13) == 0)
+            {
+                job->fast_forward = strdup(token + 13);
+            }
+            else if (strncmp(token, "ipc=", 4) == 0 &&
+                     sscanf(token + 4, "%lf-%lf", &job->ipc_low, &job->ipc_high) == 2)
+            {
+            }
+            else if (strchr(token, '=') && job->nsettings < BENCH_MAX_SETTINGS)
+            {
+                job->settings[job->nsettings++] = strdup(token);
+            }
+            else
+            {
+                fprintf(stderr, "APEX_Error: %s:%d: unknown job setting %s\n", filename, line_num, token);
+                count = -1;
+                break;
+            }
+        }
+        if (count < 0)
+        {
+            break;
+        }
+    }
+    free(line);
+    fclose(fp);
+    return count;
+}
+
+/* Command line of a headless apex_sim run of the job. fast_forward
+ * overrides the job's own when not NULL. */
+static void
+job_argv(const char *sim, const bench_job *job, const char *fast_forward, const char **argv)
+{
+    int argc = 0, i;
+
+    argv[argc++] = sim;
+    argv[argc++] = "--headless";
+    if (job->max_cycles)
+    {
+        argv[argc++] = "--max-cycles";
+        argv[argc++] = job->max_cycles;
+    }
+    if (fast_forward || job->fast_forward)
+    {
+        argv[argc++] = "--fast-forward";
+        argv[argc++] = fast_forward ? fast_forward : job->fast_forward;
+    }
+    for (i = 0; i < job->nsettings; ++i)
+    {
+        argv[argc++] = "--set";
+        argv[argc++] = job->settings[i];
+    }
+    argv[argc++] = job->filename;
+    argv[argc] = NULL;
+}
+
+/* Runs a child apex_sim, reading what it prints from a pipe into output.
+ * Returns its wait status, or -1. */
+static int
+run_child(const char *sim, const char **argv, char *output, struct rusage *usage)
+{
+    size_t used = 0;
+    ssize_t n;
+    int fds[2];
+    int status;
+    pid_t pid;
+
+    if (pipe(fds) != 0)
+    {
+        fprintf(stderr, "APEX_Error: Unable to start %s\n", sim);
+        exit(1);
+    }
+    pid = fork();
+    if (pid < 0)
+    {
+        fprintf(stderr, "APEX_Error: Unable to start %s\n", sim);
+        exit(1);
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        close(fds[1]);
+        execv(sim, (char *const *)argv);
+        fprintf(stderr, "APEX_Error: Unable to run %s\n", sim);
+        _exit(127);
+    }
+
+    close(fds[1]);
+    while (used < BENCH_OUTPUT_SIZE - 1 && (n = read(fds[0], output + used, BENCH_OUTPUT_SIZE - 1 - used)) > 0)
+    {
+        used += n;
+    }
+    output[used] = '\0';
+    close(fds[0]);
+    if (wait4(pid, &status, 0, usage) != pid)
+    {
+        status = -1;
+    }
+    return status;
+}
+
+/*
+ * Runs the job once in a child apex_sim, reading its report from a pipe.
+ * Returns the wall time, or a negative value if the run failed, after
+ * passing on what the child printed.
+ */
+static double
+run_once(const char *sim, bench_job *job)
+{
+    char *output = malloc(BENCH_OUTPUT_SIZE);
+    const char *argv[8 + 2 * BENCH_MAX_SETTINGS];
+    struct rusage usage;
+    const char *p;
+    double start, seconds;
+    long long cycles, insns;
+    int status;
+
+    if (!output)
+    {
+        fprintf(stderr, "APEX_Error: Unable to start %s\n", sim);
+        exit(1);
+    }
+    job_argv(sim, job, NULL, argv);
+    start = now_seconds();
+    status = run_child(sim, argv, output, &usage);
+    seconds = now_seconds() - start;
+
+    if (usage.ru_maxrss > job->peak_rss)
+    {
+        job->peak_rss = usage.ru_maxrss;
+    }
+    p = strstr(output, "cycles = ");
+    if (status != 0 || !p || sscanf(p, "cycles = %lld instructions = %lld", &cycles, &insns) != 2)
+    {
+        fprintf(stderr, "%sAPEX_Error: %s did not complete\n", output, job->filename);
+        free(output);
+        return -1.0;
+    }
+    if (job->cycles && (cycles != job->cycles || insns != job->insns))
+    {
+        fprintf(stderr, "APEX_Error: %s gave different results on a repeat\n", job->filename);
+        free(output);
+        return -1.0;
+    }
+    job->cycles = cycles;
+    job->insns = insns;
+    free(output);
+    return seconds;
+}
+
+/*
+ * How a run ended, in a form that does not depend on how it was simulated:
+ * the pc of the instruction that faulted, or the instructions executed and
+ * the final register file. Returns -1 if the run did neither.
+ */
+static int
+run_outcome(const char *output, char *buf, size_t size)
+{
+    const char *p = strstr(output, "APEX_Error:");
+    const char *regs, *end;
+    long long insns;
+    int pc;
+
+    if (p && (p = strstr(p, " at pc ")) && sscanf(p, " at pc %d", &pc) == 1)
+    {
+        snprintf(buf, size, "fault at pc %d\n", pc);
+        return 0;
+    }
+    p = strstr(output, "Simulation Complete");
+    p = p ? strstr(p, "instructions = ") : NULL;
+    regs = strstr(output, "Registers:");
+    end = regs ? strstr(regs, "Free physical registers") : NULL;
+    if (!p || sscanf(p, "instructions = %lld", &insns) != 1 || !end)
+    {
+        return -1;
+    }
+    snprintf(buf, size, "%lld instructions\n%.*s", insns, (int)(end - regs), regs);
+    return 0;
+}
+
+/* Runs the job in the pipeline and on the interpreter. Returns TRUE if
+ * both end the same way, otherwise prints how each ended. */
+static int
+check_job(const char *sim, const bench_job *job)
+{
+    const char *argv[8 + 2 * BENCH_MAX_SETTINGS];
+    char *output = malloc(BENCH_OUTPUT_SIZE);
+    char pipeline[4096], functional[4096];
+    char name[512];
+    struct rusage usage;
+    size_t used;
+    int ok, i;
+
+    if (!output)
+    {
+        fprintf(stderr, "APEX_Error: Unable to start %s\n", sim);
+        exit(1);
+    }
+    /* The same program is often checked under several settings */
+    used = snprintf(name, sizeof(name), "%s", job->filename);
+    for (i = 0; i < job->nsettings && used < sizeof(name); ++i)
+    {
+        used += snprintf(name + used, sizeof(name) - used, " %s", job->settings[i]);
+    }
+
+    job_argv(sim, job, NULL, argv);
+    run_child(sim, argv, output, &usage);
+    ok = run_outcome(output, pipeline, sizeof(pipeline)) == 0;
+    if (!ok)
+    {
+        printf("%s", output);
+    }
+    job_argv(sim, job, BENCH_FUNCTIONAL, argv);
+    run_child(sim, argv, output, &usage);
+    if (ok && run_outcome(output, functional, sizeof(functional)) != 0)
+    {
+        printf("%s", output);
+        ok = 0;
+    }
+    free(output);
+
+    if (!ok)
+    {
+        printf("%-30s did not run to completion\n", name);
+        return 0;
+    }
+    if (strcmp(pipeline, functional) != 0)
+    {
+        printf("%-30s MISMATCH\nPipeline: %sInterpreter: %s", name, pipeline, functional);
+        return 0;
+    }
+    printf("%-30s ok\n", name);
+    return 1;
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void
+summarize(bench_job *job, int repeat)
+{
+    double sum = 0.0, sq = 0.0;
+    int i;
+
+    qsort(job->seconds, repeat, sizeof(double), compare_doubles);
+    job->min = job->seconds[0];
+    job->median = repeat % 2 ? job->seconds[repeat / 2]
+                             : (job->seconds[repeat / 2 - 1] + job->seconds[repeat / 2]) / 2;
+    for (i = 0; i < repeat; ++i)
+    {
+        sum += job->seconds[i];
+    }
+    job->mean = sum / repeat;
+    for (i = 0; i < repeat; ++i)
+    {
+        sq += (job->seconds[i] - job->mean) * (job->seconds[i] - job->mean);
+    }
+    job->stddev = repeat > 1 ? sqrt(sq / (repeat - 1)) : 0.0;
+}
+
+/*
+ * Results are CSV, one line per program after a header:
+ *   program,runs,cycles,insns,median_s,mean_s,stddev_s,min_s,cycles_per_s,insns_per_s,peak_rss_kb
+ */
+static int
+write_results(const char *filename, const bench_job *jobs, int count, int repeat)
+{
+    FILE *fp = fopen(filename, "w");
+    int i;
+
+    if (!fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to write %s\n", filename);
+        return -1;
+    }
+    fprintf(fp, "program,runs,cycles,insns,median_s,mean_s,stddev_s,min_s,cycles_per_s,insns_per_s,peak_rss_kb\n");
+    for (i = 0; i < count; ++i)
+    {
+        const bench_job *job = &jobs[i];
+
+        if (job->failed)
+        {
+            continue;
+        }
+        fprintf(fp, "%s,%d,%lld,%lld,%.6f,%.6f,%.6f,%.6f,%.0f,%.0f,%ld\n", job->filename, repeat,
+                job->cycles, job->insns, job->median, job->mean, job->stddev, job->min,
+                job->cycles / job->min, job->insns / job->min, job->peak_rss);
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+static int
+load_baseline(const char *filename, bench_result *base, int max)
+{
+    FILE *fp = fopen(filename, "r");
+    char line[1024];
+    int count = 0;
+
+    if (!fp)
+    {
+        return -1;
+    }
+    while (count < max && fgets(line, sizeof(line), fp))
+    {
+        bench_result *r = &base[count];
+        char *comma = strchr(line, ',');
+
+        if (!comma || comma - line >= (int)sizeof(r->program) || strncmp(line, "program,", 8) == 0)
+        {
+            continue;
+        }
+        memcpy(r->program, line, comma - line);
+        r->program[comma - line] = '\0';
+        if (sscanf(comma + 1, "%*d,%lld,%*d,%*f,%*f,%*f,%*f,%lf", &r->cycles, &r->cycles_per_second) == 2)
+        {
+            count++;
+        }
+    }
+    fclose(fp);
+    return count;
+}
+
+/* Returns the number of programs that slowed down by more than threshold
+ * percent */
+static int
+compare_baseline(const char *filename, const bench_job *jobs, int count, double threshold)
+{
+    bench_result *base = calloc(BENCH_MAX_JOBS, sizeof(bench_result));
+    int n = load_baseline(filename, base, BENCH_MAX_JOBS);
+    int regressed = 0;
+    int i, b;
+
+    if (n < 0)
+    {
+        printf("APEX_Bench: no baseline %s, nothing to compare\n", filename);
+        free(base);
+        return 0;
+    }
+
+    printf("\n%-30s %14s %14s %9s\n", "Baseline", "Cycles/s", "Now", "Change");
+    for (i = 0; i < count; ++i)
+    {
+        const bench_job *job = &jobs[i];
+        double now, change;
+
+        if (job->failed)
+        {
+            continue;
+        }
+        for (b = 0; b < n && strcmp(base[b].program, job->filename) != 0; ++b)
+        {
+        }
+        if (b == n)
+        {
+            printf("%-30s %14s\n", job->filename, "(new)");
+            continue;
+        }
+        now = job->cycles / job->min;
+        change = 100.0 * (now - base[b].cycles_per_second) / base[b].cycles_per_second;
+        printf("%-30s %14.0f %14.0f %8.1f%%%s\n", job->filename, base[b].cycles_per_second, now, change,
+               change < -threshold ? "  REGRESSION" : "");
+        if (base[b].cycles != job->cycles)
+        {
+            printf("%-30s simulated cycles changed from %lld to %lld\n", "", base[b].cycles, job->cycles);
+        }
+        regressed += change < -threshold;
+    }
+    free(base);
+    return regressed;
+}
+
+static void
+free_jobs(bench_job *jobs, int count)
+{
+    int i, k;
+
+    for (i = 0; i < count; ++i)
+    {
+        free(jobs[i].filename);
+        free(jobs[i].max_cycles);
+        free(jobs[i].fast_forward);
+        for (k = 0; k < jobs[i].nsettings; ++k)
+        {
+            free(jobs[i].settings[k]);
+        }
+        free(jobs[i].seconds);
+    }
+    free(jobs);
+}
+
+int
+main(int argc, char const *argv[])
+{
+    const char *sim = "./apex_sim";
+    const char *out = NULL;
+    const char *baseline = NULL;
+    const char *job_list = NULL;
+    double threshold = BENCH_THRESHOLD;
+    int repeat = BENCH_REPEAT;
+    int check = 0;
+    bench_job *jobs;
+    int count, failed = 0, regressed = 0;
+    int i, r;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--sim") == 0 && i + 1 < argc)
+        {
+            sim = argv[++i];
+        }
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            out = argv[++i];
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+        {
+            baseline = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+        {
+            threshold = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--check") == 0)
+        {
+            check = 1;
+        }
+        else if (argv[i][0] != '-' && !job_list)
+        {
+            job_list = argv[i];
+        }
+        else
+        {
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+    if (!job_list || repeat < 1)
+    {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    jobs = calloc(BENCH_MAX_JOBS, sizeof(bench_job));
+    count = load_jobs(job_list, jobs);
+    if (count <= 0)
+    {
+        exit(1);
+    }
+
+    if (check)
+    {
+        for (i = 0; i < count; ++i)
+        {
+            failed += !check_job(sim, &jobs[i]);
+        }
+        if (failed)
+        {
+            printf("APEX_Bench: %d programs ended differently in the pipeline and the interpreter\n", failed);
+        }
+        free_jobs(jobs, count);
+        return failed ? 1 : 0;
+    }
+
+    printf("%-30s %5s %11s %11s %6s %9s %9s %9s %13s %13s %9s\n", "Program", "Runs", "Cycles", "Insns", "IPC",
+           "Median(s)", "Stddev(s)", "Min(s)", "Cycles/s", "Insns/s", "RSS(KiB)");
+    for (i = 0; i < count; ++i)
+    {
+        bench_job *job = &jobs[i];
+
+        job->seconds = calloc(repeat, sizeof(double));
+        for (r = 0; r < repeat && !job->failed; ++r)
+        {
+            job->seconds[r] = run_once(sim, job);
+            job->failed = job->seconds[r] < 0;
+        }
+        if (job->failed)
+        {
+            printf("%-30s %5s\n", job->filename, "failed");
+            failed++;
+            continue;
+        }
+        summarize(job, repeat);
+        printf("%-30s %5d %11lld %11lld %6.3f %9.4f %9.4f %9.4f %13.0f %13.0f %9ld\n", job->filename, repeat,
+               job->cycles, job->insns, job->cycles ? (double)job->insns / job->cycles : 0.0, job->median, job->stddev, job->min, job->cycles / job->min,
+               job->insns / job->min, job->peak_rss);
+        if (job->ipc_high > 0 && (job->cycles == 0 || (double)job->insns / job->cycles < job->ipc_low ||
+                                  (double)job->insns / job->cycles > job->ipc_high))
+        {
+            printf("%-30s IPC %.3f outside the expected %.3f-%.3f\n", "",
+                   job->cycles ? (double)job->insns / job->cycles : 0.0, job->ipc_low, job->ipc_high);
+            failed++;
+        }
+    }
+
+    if (failed)
+    {
+        printf("APEX_Bench: %d programs failed or left their IPC band\n", failed);
+    }
+    if (out && write_results(out, jobs, count, repeat) == 0)
+    {
+        printf("APEX_Bench: results written to %s\n", out);
+    }
+    if (baseline)
+    {
+        regressed = compare_baseline(baseline, jobs, count, threshold);
+        if (regressed)
+        {
+            printf("APEX_Bench: %d programs lost more than %.1f%% throughput\n", regressed, threshold);
+        }
+    }
+
+    free_jobs(jobs, count);
+    return failed || regressed ? 1 : 0;
+}
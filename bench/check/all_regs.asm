@@ -0,0 +1,17 @@
+MOVC R0,#1
+MOVC R1,#2
+MOVC R2,#3
+MOVC R3,#4
+MOVC R4,#5
+MOVC R5,#6
+MOVC R6,#7
+MOVC R7,#8
+MOVC R8,#9
+MOVC R9,#10
+MOVC R10,#11
+MOVC R11,#12
+MOVC R12,#13
+MOVC R13,#14
+MOVC R14,#15
+MOVC R15,#16
+HALT
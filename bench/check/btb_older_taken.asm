@@ -0,0 +1,13 @@
+MOVC R1,#1
+MOVC R2,#2
+MOVC R3,#1
+MUL R3,R3,R2
+MUL R3,R3,R2
+CMP R15,R3,R3
+BZ #20
+CMP R15,R1,R1
+BZ #8
+ADDL R5,R5,#1
+ADDL R6,R6,#1
+ADDL R7,R7,#1
+HALT
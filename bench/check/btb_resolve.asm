@@ -0,0 +1,16 @@
+MOVC R1,#1
+MOVC R2,#2
+MOVC R4,#1
+MOVC R3,#1
+MUL R4,R4,R2
+MUL R4,R4,R2
+MUL R3,R3,R2
+MUL R3,R3,R2
+MUL R3,R3,R2
+CMP R15,R4,R2
+BZ #8
+CMP R15,R3,R3
+BZ #8
+ADDL R5,R5,#1
+HALT
+MOVC R1,#999
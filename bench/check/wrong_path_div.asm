@@ -0,0 +1,14 @@
+MOVC R0,#0
+MOVC R1,#200
+MOVC R2,#1
+MOVC R6,#5000
+MUL R4,R2,R2
+MUL R4,R4,R2
+CMP R15,R4,R2
+BZ #8
+DIV R7,R1,R0
+ADDL R3,R3,#1
+SUBL R1,R1,#1
+CMP R15,R1,R0
+BNZ #-32
+HALT
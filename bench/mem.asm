@@ -0,0 +1,13 @@
+MOVC R0,#0
+MOVC R1,#200000
+MOVC R2,#7
+MOVC R5,#16
+STORE R2,R0,#8
+LOAD R3,R0,#8
+ADDL R2,R3,#1
+STR R2,R0,R5
+LDR R4,R0,R5
+SUBL R1,R1,#1
+CMP R9,R1,R0
+BNZ #-28
+HALT
@@ -0,0 +1,16 @@
+MOVC R0,#0
+MOVC R1,#20000
+MOVC R2,#1
+CMP R15,R0,R0
+BZ #8
+ADDL R3,R3,#1
+CMP R15,R2,R0
+BZ #8
+ADDL R4,R4,#1
+CMP R15,R0,R0
+BNZ #8
+ADDL R5,R5,#1
+SUBL R1,R1,#1
+CMP R15,R1,R0
+BNZ #-44
+HALT
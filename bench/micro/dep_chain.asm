@@ -0,0 +1,16 @@
+MOVC R0,#0
+MOVC R1,#20000
+MOVC R2,#1
+MOVC R3,#1
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+SUBL R1,R1,#1
+CMP R15,R1,R0
+BNZ #-40
+HALT
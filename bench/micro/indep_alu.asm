@@ -0,0 +1,50 @@
+MOVC R0,#0
+MOVC R1,#20000
+MOVC R2,#1
+MOVC R3,#1
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+SUB R5,R3,R0
+ADDL R6,R3,#7
+SUBL R7,R3,#7
+ADD R8,R3,R0
+SUB R9,R3,R0
+ADDL R10,R3,#7
+SUBL R11,R3,#7
+ADD R4,R3,R0
+SUB R5,R3,R0
+ADDL R6,R3,#7
+SUBL R7,R3,#7
+ADD R8,R3,R0
+SUB R9,R3,R0
+ADDL R10,R3,#7
+SUBL R11,R3,#7
+ADD R4,R3,R0
+SUB R5,R3,R0
+ADDL R6,R3,#7
+SUBL R7,R3,#7
+ADD R8,R3,R0
+SUB R9,R3,R0
+ADDL R10,R3,#7
+SUBL R11,R3,#7
+ADD R4,R3,R0
+SUB R5,R3,R0
+ADDL R6,R3,#7
+SUBL R7,R3,#7
+ADD R8,R3,R0
+SUB R9,R3,R0
+ADDL R10,R3,#7
+SUBL R1,R1,#1
+CMP R15,R1,R0
+BNZ #-176
+HALT
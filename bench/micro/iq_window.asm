@@ -0,0 +1,48 @@
+MOVC R0,#0
+MOVC R1,#20000
+MOVC R2,#1
+MOVC R3,#1
+MUL R2,R2,R3
+ADDL R5,R2,#1
+MUL R2,R2,R3
+ADDL R6,R2,#2
+MUL R2,R2,R3
+ADDL R7,R2,#3
+MUL R2,R2,R3
+ADDL R4,R2,#4
+MUL R2,R2,R3
+ADDL R5,R2,#5
+MUL R2,R2,R3
+ADDL R6,R2,#6
+MUL R2,R2,R3
+ADDL R7,R2,#7
+MUL R2,R2,R3
+ADDL R4,R2,#8
+MUL R2,R2,R3
+ADDL R5,R2,#9
+MUL R2,R2,R3
+ADDL R6,R2,#10
+MUL R2,R2,R3
+ADDL R7,R2,#11
+MUL R2,R2,R3
+ADDL R4,R2,#12
+ADDL R9,R3,#1
+ADDL R10,R3,#2
+ADDL R11,R3,#3
+ADDL R8,R3,#4
+ADDL R9,R3,#5
+ADDL R10,R3,#6
+ADDL R11,R3,#7
+ADDL R8,R3,#8
+ADDL R9,R3,#9
+ADDL R10,R3,#10
+ADDL R11,R3,#11
+ADDL R8,R3,#12
+ADDL R9,R3,#13
+ADDL R10,R3,#14
+ADDL R11,R3,#15
+ADDL R8,R3,#16
+SUBL R1,R1,#1
+CMP R15,R1,R0
+BNZ #-168
+HALT
@@ -0,0 +1,16 @@
+MOVC R0,#0
+MOVC R1,#20000
+MOVC R2,#3
+MOVC R3,#5
+AND R4,R2,R3
+OR R4,R4,R2
+EXOR R4,R4,R3
+AND R4,R4,R3
+OR R4,R4,R2
+EXOR R4,R4,R3
+AND R4,R4,R3
+OR R4,R4,R2
+SUBL R1,R1,#1
+CMP R15,R1,R0
+BNZ #-40
+HALT
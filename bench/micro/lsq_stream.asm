@@ -0,0 +1,36 @@
+MOVC R0,#0
+MOVC R1,#20000
+MOVC R2,#1
+MOVC R3,#100
+MUL R2,R2,R2
+MUL R2,R2,R2
+MUL R2,R2,R2
+MUL R2,R2,R2
+MUL R2,R2,R2
+MUL R2,R2,R2
+MUL R2,R2,R2
+MUL R2,R2,R2
+MUL R2,R2,R2
+MUL R2,R2,R2
+MUL R2,R2,R2
+MUL R2,R2,R2
+STORE R2,R3,#0
+LOAD R4,R3,#32
+STORE R2,R3,#4
+LOAD R5,R3,#36
+STORE R2,R3,#8
+LOAD R6,R3,#40
+STORE R2,R3,#12
+LOAD R7,R3,#44
+STORE R2,R3,#16
+LOAD R8,R3,#48
+STORE R2,R3,#20
+LOAD R9,R3,#52
+STORE R2,R3,#24
+LOAD R10,R3,#56
+STORE R2,R3,#28
+LOAD R11,R3,#60
+SUBL R1,R1,#1
+CMP R15,R1,R0
+BNZ #-120
+HALT
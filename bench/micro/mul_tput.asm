@@ -0,0 +1,16 @@
+MOVC R0,#0
+MOVC R1,#20000
+MOVC R2,#3
+MOVC R3,#5
+MUL R4,R2,R3
+MUL R5,R3,R2
+MUL R6,R2,R2
+MUL R7,R3,R3
+MUL R8,R2,R3
+MUL R9,R3,R2
+MUL R10,R2,R2
+MUL R11,R3,R3
+SUBL R1,R1,#1
+CMP R15,R1,R0
+BNZ #-40
+HALT
@@ -0,0 +1,50 @@
+MOVC R0,#0
+MOVC R1,#20000
+MOVC R2,#1
+MOVC R3,#1
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+MUL R2,R2,R3
+ADDL R5,R3,#1
+ADDL R6,R3,#2
+ADDL R7,R3,#3
+ADDL R8,R3,#4
+ADDL R9,R3,#5
+ADDL R10,R3,#6
+ADDL R11,R3,#7
+ADDL R4,R3,#8
+ADDL R5,R3,#9
+ADDL R6,R3,#10
+ADDL R7,R3,#11
+ADDL R8,R3,#12
+ADDL R9,R3,#13
+ADDL R10,R3,#14
+ADDL R11,R3,#15
+ADDL R4,R3,#16
+ADDL R5,R3,#17
+ADDL R6,R3,#18
+ADDL R7,R3,#19
+ADDL R8,R3,#20
+ADDL R9,R3,#21
+ADDL R10,R3,#22
+ADDL R11,R3,#23
+ADDL R4,R3,#24
+ADDL R5,R3,#25
+ADDL R6,R3,#26
+ADDL R7,R3,#27
+ADDL R8,R3,#28
+ADDL R9,R3,#29
+ADDL R10,R3,#30
+SUBL R1,R1,#1
+CMP R15,R1,R0
+BNZ #-176
+HALT
@@ -0,0 +1,20 @@
+MOVC R0,#0
+MOVC R1,#20000
+MOVC R3,#1
+MOVC R4,#1
+MUL R2,R4,R3
+STORE R2,R0,#100
+LOAD R4,R0,#100
+MUL R2,R4,R3
+STORE R2,R0,#100
+LOAD R4,R0,#100
+MUL R2,R4,R3
+STORE R2,R0,#100
+LOAD R4,R0,#100
+MUL R2,R4,R3
+STORE R2,R0,#100
+LOAD R4,R0,#100
+SUBL R1,R1,#1
+CMP R15,R1,R0
+BNZ #-56
+HALT
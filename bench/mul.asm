@@ -0,0 +1,12 @@
+MOVC R0,#0
+MOVC R1,#200000
+MOVC R2,#1
+MOVC R3,#1
+MUL R4,R2,R3
+MUL R5,R4,R3
+MUL R6,R5,R3
+ADD R7,R6,R2
+SUBL R1,R1,#1
+CMP R9,R1,R0
+BNZ #-24
+HALT
@@ -0,0 +1,26 @@
+MOVC R0,#0
+MOVC R1,#30000
+MOVC R2,#3
+MOVC R3,#5
+MUL R4,R2,R3
+MUL R5,R4,R2
+ADD R6,R5,R4
+SUBL R1,R1,#1
+CMP R9,R1,R0
+BNZ #-20
+MOVC R1,#50000
+ADD R4,R2,R3
+AND R5,R4,R2
+OR R6,R5,R3
+STORE R6,R0,#4
+LOAD R7,R0,#4
+SUBL R1,R1,#1
+CMP R9,R1,R0
+BNZ #-28
+MOVC R1,#20000
+MUL R4,R2,R3
+ADD R5,R4,R2
+SUBL R1,R1,#1
+CMP R9,R1,R0
+BNZ #-16
+HALT
@@ -7,7 +7,7 @@
  * Copyright (c) 2020, Gaurav Kothari (gkothar1@binghamton.edu)
  * State University of New York at Binghamton
  */
-#include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,322 +15,453 @@
 #include "apex_cpu.h"
 #include "apex_macros.h"
 
-/*
- * This function is related to parsing input file
- *
- * Note : You are not supposed to edit this function
- */
+/* Mnemonic of every opcode, as written in the input file */
+const char *const APEX_opcode_names[OPCODE_COUNT] = {
+    [OPCODE_NULL] = "",
+    [OPCODE_ADD] = "ADD",
+    [OPCODE_SUB] = "SUB",
+    [OPCODE_MUL] = "MUL",
+    [OPCODE_DIV] = "DIV",
+    [OPCODE_AND] = "AND",
+    [OPCODE_OR] = "OR",
+    [OPCODE_XOR] = "EXOR",
+    [OPCODE_MOVC] = "MOVC",
+    [OPCODE_LOAD] = "LOAD",
+    [OPCODE_STORE] = "STORE",
+    [OPCODE_BZ] = "BZ",
+    [OPCODE_BNZ] = "BNZ",
+    [OPCODE_HALT] = "HALT",
+    [OPCODE_SUBL] = "SUBL",
+    [OPCODE_ADDL] = "ADDL",
+    [OPCODE_STR] = "STR",
+    [OPCODE_LDR] = "LDR",
+    [OPCODE_CMP] = "CMP",
+    [OPCODE_NOP] = "NOP",
+    [OPCODE_JAL] = "JAL",
+    [OPCODE_JUMP] = "JUMP",
+};
+
+/* Operands of each opcode, in the order they are written: d is rd, s is
+ * rs1, t is rs2 and i the immediate */
+static const char *const operand_format[OPCODE_COUNT] = {
+    [OPCODE_ADD] = "dst",
+    [OPCODE_SUB] = "dst",
+    [OPCODE_MUL] = "dst",
+    [OPCODE_DIV] = "dst",
+    [OPCODE_AND] = "dst",
+    [OPCODE_OR] = "dst",
+    [OPCODE_XOR] = "dst",
+    [OPCODE_LDR] = "dst",
+    [OPCODE_STR] = "dst",
+    [OPCODE_CMP] = "dst",
+    [OPCODE_MOVC] = "di",
+    [OPCODE_JUMP] = "si",
+    [OPCODE_LOAD] = "dsi",
+    [OPCODE_ADDL] = "dsi",
+    [OPCODE_SUBL] = "dsi",
+    [OPCODE_JAL] = "dsi",
+    [OPCODE_STORE] = "sti",
+    [OPCODE_BZ] = "i",
+    [OPCODE_BNZ] = "i",
+    [OPCODE_NOP] = "",
+    [OPCODE_HALT] = "",
+};
+
+/* Position in the file being parsed, for error messages */
+typedef struct asm_parser
+{
+    const char *filename;
+    int line;
+    const char *line_start;
+} asm_parser;
+
 static int
-get_num_from_string(const char *buffer)
+is_blank(char c)
 {
-    char str[16];
-    int i, j = 0;
+    return c == ' ' || c == '\t' || c == '\r';
+}
 
-    for (i = 1; buffer[i] != '\0'; ++i)
+static void
+parse_error(const asm_parser *ps, const char *at, const char *what, const char *token, int len)
+{
+    fprintf(stderr, "APEX_Error: %s:%d:%d: %s", ps->filename, ps->line, (int)(at - ps->line_start) + 1, what);
+    if (token)
     {
-        str[j] = buffer[i];
-        j++;
+        fprintf(stderr, " '%.*s'", len, token);
     }
-    str[j] = '\0';
-
-    return atoi(str);
+    fprintf(stderr, "\n");
 }
 
+#define MNEMONIC_IS(s, len, name) ((len) == sizeof(name) - 1 && memcmp((s), (name), (len)) == 0)
+
 /*
  * This function sets the numeric opcode to an instruction based on string value
  *
+ * Dispatches on the first letter, leaving at most three candidates to compare
+ *
  * Note : you can edit this function to add new instructions
  */
 static int
-set_opcode_str(const char *opcode_str)
+set_opcode_str(const char *s, int len)
 {
-    if (strcmp(opcode_str, "ADD") == 0)
-    {
-        return OPCODE_ADD;
-    }
-    if (strcmp(opcode_str, "NOP") == 0)
-    {
-        return OPCODE_NOP;
-    }
-
-    if (strcmp(opcode_str, "SUB") == 0)
-    {
-        return OPCODE_SUB;
-    }
-
-    if (strcmp(opcode_str, "MUL") == 0)
-    {
-        return OPCODE_MUL;
-    }
-
-    if (strcmp(opcode_str, "DIV") == 0)
-    {
-        return OPCODE_DIV;
-    }
-
-    if (strcmp(opcode_str, "AND") == 0)
+    switch (s[0])
     {
-        return OPCODE_AND;
-    }
-
-    if (strcmp(opcode_str, "OR") == 0)
-    {
-        return OPCODE_OR;
-    }
-
-    if (strcmp(opcode_str, "EXOR") == 0)
-    {
-        return OPCODE_XOR;
-    }
-
-    if (strcmp(opcode_str, "MOVC") == 0)
-    {
-        return OPCODE_MOVC;
-    }
-
-    if (strcmp(opcode_str, "LOAD") == 0)
-    {
-        return OPCODE_LOAD;
-    }
-
-    if (strcmp(opcode_str, "STORE") == 0)
-    {
-        return OPCODE_STORE;
-    }
-
-    if (strcmp(opcode_str, "STR") == 0)
-    {
-        return OPCODE_STR;
-    }
-
-    if (strcmp(opcode_str, "LDR") == 0)
-    {
-        return OPCODE_LDR;
-    }
-    if (strcmp(opcode_str, "ADDL") == 0)
-    {
-        return OPCODE_ADDL;
-    }
-    if (strcmp(opcode_str, "SUBL") == 0)
-    {
-        return OPCODE_SUBL;
+    case 'A':
+        if (MNEMONIC_IS(s, len, "ADD"))
+        {
+            return OPCODE_ADD;
+        }
+        if (MNEMONIC_IS(s, len, "ADDL"))
+        {
+            return OPCODE_ADDL;
+        }
+        if (MNEMONIC_IS(s, len, "AND"))
+        {
+            return OPCODE_AND;
+        }
+        break;
+    case 'B':
+        if (MNEMONIC_IS(s, len, "BZ"))
+        {
+            return OPCODE_BZ;
+        }
+        if (MNEMONIC_IS(s, len, "BNZ"))
+        {
+            return OPCODE_BNZ;
+        }
+        break;
+    case 'C':
+        if (MNEMONIC_IS(s, len, "CMP"))
+        {
+            return OPCODE_CMP;
+        }
+        break;
+    case 'D':
+        if (MNEMONIC_IS(s, len, "DIV"))
+        {
+            return OPCODE_DIV;
+        }
+        break;
+    case 'E':
+        if (MNEMONIC_IS(s, len, "EXOR"))
+        {
+            return OPCODE_XOR;
+        }
+        break;
+    case 'H':
+        if (MNEMONIC_IS(s, len, "HALT"))
+        {
+            return OPCODE_HALT;
+        }
+        break;
+    case 'J':
+        if (MNEMONIC_IS(s, len, "JUMP"))
+        {
+            return OPCODE_JUMP;
+        }
+        if (MNEMONIC_IS(s, len, "JAL"))
+        {
+            return OPCODE_JAL;
+        }
+        break;
+    case 'L':
+        if (MNEMONIC_IS(s, len, "LOAD"))
+        {
+            return OPCODE_LOAD;
+        }
+        if (MNEMONIC_IS(s, len, "LDR"))
+        {
+            return OPCODE_LDR;
+        }
+        break;
+    case 'M':
+        if (MNEMONIC_IS(s, len, "MOVC"))
+        {
+            return OPCODE_MOVC;
+        }
+        if (MNEMONIC_IS(s, len, "MUL"))
+        {
+            return OPCODE_MUL;
+        }
+        break;
+    case 'N':
+        if (MNEMONIC_IS(s, len, "NOP"))
+        {
+            return OPCODE_NOP;
+        }
+        break;
+    case 'O':
+        if (MNEMONIC_IS(s, len, "OR"))
+        {
+            return OPCODE_OR;
+        }
+        break;
+    case 'S':
+        if (MNEMONIC_IS(s, len, "SUB"))
+        {
+            return OPCODE_SUB;
+        }
+        if (MNEMONIC_IS(s, len, "SUBL"))
+        {
+            return OPCODE_SUBL;
+        }
+        if (MNEMONIC_IS(s, len, "STORE"))
+        {
+            return OPCODE_STORE;
+        }
+        if (MNEMONIC_IS(s, len, "STR"))
+        {
+            return OPCODE_STR;
+        }
+        break;
     }
 
-    if (strcmp(opcode_str, "CMP") == 0)
-    {
-        return OPCODE_CMP;
-    }
+    return -1;
+}
 
-    if (strcmp(opcode_str, "BZ") == 0)
-    {
-        return OPCODE_BZ;
-    }
+/*
+ * Parses one operand, R<n> or #<n>, starting at p. Returns the character
+ * after it, or NULL after reporting what is wrong with it.
+ */
+static const char *
+parse_operand(const asm_parser *ps, const char *p, char kind, int *value)
+{
+    const char *start = p;
+    const char prefix = kind == 'i' ? '#' : 'R';
+    long long v = 0;
+    int negative = FALSE;
 
-    if (strcmp(opcode_str, "BNZ") == 0)
+    if (*p != prefix)
     {
-        return OPCODE_BNZ;
+        parse_error(ps, p, kind == 'i' ? "expected an immediate #<n>" : "expected a register R<n>", NULL, 0);
+        return NULL;
     }
-
-    if (strcmp(opcode_str, "HALT") == 0)
+    p++;
+    if (kind == 'i' && (*p == '-' || *p == '+'))
     {
-        return OPCODE_HALT;
+        negative = *p == '-';
+        p++;
     }
-    if (strcmp(opcode_str, "JUMP") == 0)
+    if (*p < '0' || *p > '9')
     {
-        return OPCODE_JUMP;
+        parse_error(ps, p, "expected a number", NULL, 0);
+        return NULL;
     }
-    if (strcmp(opcode_str, "JAL") == 0)
+    while (*p >= '0' && *p <= '9')
     {
-        return OPCODE_JAL;
+        v = v * 10 + (*p - '0');
+        if (v > (long long)INT_MAX + 1)
+        {
+            parse_error(ps, start, "number out of range", NULL, 0);
+            return NULL;
+        }
+        p++;
     }
-
-    assert(0 && "Invalid opcode");
-    return 0;
-}
-
-static void
-split_opcode_from_insn_string(char *buffer, char tokens[2][128])
-{
-    int token_num = 0;
-    char *p;
-    char *token = strtok(buffer, " ");
-
-    while (token != NULL)
+    if (negative)
     {
-        strcpy(tokens[token_num], token);
-        token_num++;
-        token = strtok(NULL, " ");
+        v = -v;
     }
-    p = tokens[0];
-    while (*p != '\0')
+    if (kind == 'i' ? v > INT_MAX : v >= REG_FILE_SIZE)
     {
-        if (*p == '\n')
-        {
-            *p = '\0';
-            break;
-        }
-        p++;
+        parse_error(ps, start, kind == 'i' ? "number out of range" : "no such register", start, (int)(p - start));
+        return NULL;
     }
+    *value = (int)v;
+    return p;
 }
 
 /*
  * This function is related to parsing input file
  *
+ * Parses the instruction written between p and the end of its line: the
+ * mnemonic, blanks, then the comma-separated operands with no blanks in
+ * between. Anything after the operands, e.g. trailing blanks, is ignored.
+ * Trailing operands left out read as R0 or #0. Returns -1 after reporting
+ * an error.
+ *
  * Note : you can edit this function to add new instructions
  */
-static void
-create_APEX_instruction(APEX_Instruction *ins, char *buffer)
+static int
+create_APEX_instruction(const asm_parser *ps, APEX_Instruction *ins, const char *p)
 {
-    int i, token_num = 0;
-    char tokens[6][128];
-    char top_level_tokens[2][128];
+    const char *mnemonic = p;
+    const char *format;
+    int value;
 
-    for (i = 0; i < 2; ++i)
+    while (*p != '\n' && *p != '\0' && !is_blank(*p))
     {
-        strcpy(top_level_tokens[i], "");
+        p++;
     }
-
-    split_opcode_from_insn_string(buffer, top_level_tokens);
-
-    char *token = strtok(top_level_tokens[1], ",");
-
-    while (token != NULL)
+    ins->opcode = set_opcode_str(mnemonic, (int)(p - mnemonic));
+    if (ins->opcode < 0)
     {
-        strcpy(tokens[token_num], token);
-        token_num++;
-        token = strtok(NULL, ",");
+        parse_error(ps, mnemonic, "invalid opcode", mnemonic, (int)(p - mnemonic));
+        return -1;
     }
-
-    strcpy(ins->opcode_str, top_level_tokens[0]);
-    ins->opcode = set_opcode_str(ins->opcode_str);
-    switch (ins->opcode)
+    format = operand_format[ins->opcode];
+    if (*format == '\0')
     {
-
-    case OPCODE_LDR:
-    case OPCODE_STR:
-    case OPCODE_ADD:
-    case OPCODE_SUB:
-    case OPCODE_MUL:
-    case OPCODE_DIV:
-    case OPCODE_AND:
-    case OPCODE_OR:
-    case OPCODE_XOR:
-    case OPCODE_CMP:
-    {
-        ins->rd = get_num_from_string(tokens[0]);
-        ins->rs1 = get_num_from_string(tokens[1]);
-        ins->rs2 = get_num_from_string(tokens[2]);
-        break;
+        return 0;
     }
 
-    case OPCODE_MOVC:
+    while (is_blank(*p))
     {
-        ins->rd = get_num_from_string(tokens[0]);
-        ins->imm = get_num_from_string(tokens[1]);
-        break;
+        p++;
     }
-
-        // case OPCODE_CMP:
-        // {
-        //     ins->rs1 = get_num_from_string(tokens[0]);
-        //     ins->rs2 = get_num_from_string(tokens[1]);
-        //     break;
-        // }
-    case OPCODE_JUMP:
+    for (; *format != '\0'; ++format)
     {
-        ins->rs1 = get_num_from_string(tokens[0]);
-        ins->imm = get_num_from_string(tokens[1]);
-        break;
+        if (*p == '\n' || *p == '\0' || is_blank(*p))
+        {
+            break;
+        }
+        p = parse_operand(ps, p, *format, &value);
+        if (!p)
+        {
+            return -1;
+        }
+        switch (*format)
+        {
+        case 'd':
+            ins->rd = value;
+            break;
+        case 's':
+            ins->rs1 = value;
+            break;
+        case 't':
+            ins->rs2 = value;
+            break;
+        default:
+            ins->imm = value;
+            break;
+        }
+        if (*p == ',')
+        {
+            p++;
+            if (format[1] == '\0')
+            {
+                parse_error(ps, p - 1, "too many operands for", mnemonic,
+                            (int)strlen(APEX_opcode_names[ins->opcode]));
+                return -1;
+            }
+        }
+        else if (*p != '\n' && *p != '\0' && !is_blank(*p))
+        {
+            parse_error(ps, p, "unexpected character in operand", p, 1);
+            return -1;
+        }
+        else
+        {
+            break;
+        }
     }
+    return 0;
+}
 
-    case OPCODE_LOAD:
-    case OPCODE_ADDL:
-    case OPCODE_SUBL:
-    case OPCODE_JAL:
-    {
-        ins->rd = get_num_from_string(tokens[0]);
-        ins->rs1 = get_num_from_string(tokens[1]);
-        ins->imm = get_num_from_string(tokens[2]);
-        break;
-    }
+/* Reads the whole file into one NUL-terminated buffer */
+static char *
+read_file(const char *filename, long *length)
+{
+    FILE *fp = fopen(filename, "rb");
+    char *text;
+    long n;
 
-    case OPCODE_STORE:
+    if (!fp)
     {
-        ins->rs1 = get_num_from_string(tokens[0]);
-        ins->rs2 = get_num_from_string(tokens[1]);
-        ins->imm = get_num_from_string(tokens[2]);
-        break;
+        return NULL;
     }
-
-    case OPCODE_BZ:
-    case OPCODE_BNZ:
+    if (fseek(fp, 0, SEEK_END) != 0 || (n = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0)
     {
-        ins->imm = get_num_from_string(tokens[0]);
-        break;
+        fclose(fp);
+        return NULL;
     }
-
-    case OPCODE_NOP:
-    case OPCODE_HALT:
+    text = malloc(n + 1);
+    if (!text || fread(text, 1, n, fp) != (size_t)n)
     {
-        break;
-    }
+        free(text);
+        fclose(fp);
+        return NULL;
     }
-    /* Fill in rest of the instructions accordingly */
+    text[n] = '\0';
+    fclose(fp);
+    *length = n;
+    return text;
 }
 
 /*
  * This function is related to parsing input file
  *
- * Note : You are not supposed to edit this function
+ * One pass over the file, one instruction per line into a code memory that
+ * doubles as it fills. Blank lines are skipped and do not take an address.
  */
 APEX_Instruction *
 create_code_memory(const char *filename, int *size)
 {
-    FILE *fp;
-    ssize_t nread;
-    size_t len = 0;
-    char *line = NULL;
-    int code_memory_size = 0;
-    int current_instruction = 0;
-    APEX_Instruction *code_memory;
-
+    asm_parser ps;
+    APEX_Instruction *code_memory = NULL;
+    int capacity = 0;
+    int count = 0;
+    long length = 0;
+    char *text;
+    const char *p;
+
+    *size = 0;
     if (!filename)
     {
         return NULL;
     }
-
-    fp = fopen(filename, "r");
-    if (!fp)
+    text = read_file(filename, &length);
+    if (!text)
     {
         return NULL;
     }
 
-    while ((nread = getline(&line, &len, fp)) != -1)
-    {
-        code_memory_size++;
-    }
-    *size = code_memory_size;
-    if (!code_memory_size)
+    ps.filename = filename;
+    ps.line = 0;
+    for (p = text; p < text + length;)
     {
-        fclose(fp);
-        return NULL;
-    }
+        const char *q;
 
-    code_memory = calloc(code_memory_size, sizeof(APEX_Instruction));
-    if (!code_memory)
-    {
-        fclose(fp);
-        return NULL;
-    }
+        ps.line++;
+        ps.line_start = p;
+        for (q = p; is_blank(*q); ++q)
+        {
+        }
+        if (*q != '\n' && *q != '\0')
+        {
+            if (count == capacity)
+            {
+                APEX_Instruction *grown;
+
+                capacity = capacity ? capacity * 2 : 256;
+                grown = realloc(code_memory, capacity * sizeof(APEX_Instruction));
+                if (!grown)
+                {
+                    fprintf(stderr, "APEX_Error: Out of memory parsing %s\n", filename);
+                    free(code_memory);
+                    free(text);
+                    return NULL;
+                }
+                code_memory = grown;
+            }
+            memset(&code_memory[count], 0, sizeof(APEX_Instruction));
+            if (create_APEX_instruction(&ps, &code_memory[count], q) < 0)
+            {
+                free(code_memory);
+                free(text);
+                return NULL;
+            }
+            count++;
+        }
 
-    rewind(fp);
-    while ((nread = getline(&line, &len, fp)) != -1)
-    {
-        create_APEX_instruction(&code_memory[current_instruction], line);
-        current_instruction++;
+        p = memchr(p, '\n', text + length - p);
+        if (!p)
+        {
+            break;
+        }
+        p++;
     }
+    free(text);
 
-    free(line);
-    fclose(fp);
+    *size = count;
     return code_memory;
-}
\ No newline at end of file
+}
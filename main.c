@@ -7,30 +7,515 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
+#include "apex_batch.h"
+#include "apex_cache.h"
+#include "apex_checkpoint.h"
+#include "apex_config.h"
 #include "apex_cpu.h"
+#include "apex_functional.h"
+#include "apex_kanata.h"
+#include "apex_parallel.h"
+#include "apex_simpoint.h"
+#include "apex_stats.h"
+#include "apex_trace.h"
+
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr, "APEX_Help: Usage %s [--config FILE] [--set key=value]... [--headless [--no-skip]] [--max-cycles N] [--fast-forward N] [--trace FILE [--trace-drop]] [--kanata FILE] [--stats [--stats-interval N]]\n", prog);
+    fprintf(stderr, "           %*s [--cache DIR [--rerun]]\n", (int)strlen(prog), "");
+    fprintf(stderr, "           %*s [--checkpoint FILE [--checkpoint-at-cycle N | --checkpoint-at-insn N]] <input_file | --restore FILE>\n", (int)strlen(prog), "");
+    fprintf(stderr, "           %s --batch <job_list> [--threads N] [--max-cycles N]\n", prog);
+    fprintf(stderr, "           %s --simpoint <input_file> [--interval N] [--clusters K] [--warmup N] [--max-insns N] [--verify]\n", prog);
+    fprintf(stderr, "           %s --parallel <input_file> [--segment N] [--overlap N] [--threads N] [--max-insns N] [--verify]\n", prog);
+    fprintf(stderr, "           %*s --batch, --simpoint and --parallel take --config and --set too\n", (int)strlen(prog), "");
+}
+
+/* Applies --config FILE or --set key=value at argv[*i], in the order they
+ * are given. Returns 1 if argv[*i] was one, -1 if it was but its settings
+ * were bad, 0 if it was some other argument. */
+static int
+config_option(int argc, char const *argv[], int *i, APEX_Config *config)
+{
+    if (strcmp(argv[*i], "--config") == 0 && *i + 1 < argc)
+    {
+        return APEX_config_load(config, argv[++*i]) < 0 ? -1 : 1;
+    }
+    if (strcmp(argv[*i], "--set") == 0 && *i + 1 < argc)
+    {
+        return APEX_config_set(config, argv[++*i], "--set ") < 0 ? -1 : 1;
+    }
+    return 0;
+}
+
+/* Runs every job of a job list on a thread pool and prints one report */
+static int
+run_batch(int argc, char const *argv[])
+{
+    APEX_Batch batch;
+    APEX_Config config;
+    int threads = 0;
+    int max_cycles = APEX_BATCH_MAX_CYCLES;
+    int i, used;
+
+    APEX_config_defaults(&config);
+    for (i = 3; i < argc; ++i)
+    {
+        if ((used = config_option(argc, argv, &i, &config)) != 0)
+        {
+            if (used < 0)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-cycles") == 0 && i + 1 < argc)
+        {
+            max_cycles = atoi(argv[++i]);
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (APEX_batch_load(&batch, argv[2], max_cycles, &config) < 0)
+    {
+        return 1;
+    }
+    APEX_batch_run(&batch, threads);
+    APEX_batch_report(&batch);
+    APEX_batch_free(&batch);
+    return 0;
+}
+
+/* Estimates the CPI of a long run from a few simulated intervals */
+static int
+run_simpoint(int argc, char const *argv[])
+{
+    APEX_SimPoint_Options opt;
+    int i, used;
+
+    APEX_simpoint_defaults(&opt);
+    for (i = 3; i < argc; ++i)
+    {
+        if ((used = config_option(argc, argv, &i, &opt.config)) != 0)
+        {
+            if (used < 0)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+        {
+            opt.interval = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--clusters") == 0 && i + 1 < argc)
+        {
+            opt.max_clusters = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+        {
+            opt.warmup = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-insns") == 0 && i + 1 < argc)
+        {
+            opt.max_insns = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--verify") == 0)
+        {
+            opt.verify = TRUE;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    return APEX_simpoint_run(argv[2], &opt);
+}
+
+/* Splits one long run into segments simulated on all cores */
+static int
+run_parallel(int argc, char const *argv[])
+{
+    APEX_Parallel_Options opt;
+    int i, used;
+
+    APEX_parallel_defaults(&opt);
+    for (i = 3; i < argc; ++i)
+    {
+        if ((used = config_option(argc, argv, &i, &opt.config)) != 0)
+        {
+            if (used < 0)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--segment") == 0 && i + 1 < argc)
+        {
+            opt.segment = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--overlap") == 0 && i + 1 < argc)
+        {
+            opt.overlap = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            opt.threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-insns") == 0 && i + 1 < argc)
+        {
+            opt.max_insns = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--verify") == 0)
+        {
+            opt.verify = TRUE;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    return APEX_parallel_run(argv[2], &opt);
+}
+
+/*
+ * Runs the first n instructions on the functional interpreter; the pipeline
+ * then starts from the architectural state they leave. Returns the
+ * APEX_FUNC_* status; only after LIMIT or OFF_END is there a pipeline run.
+ */
+static int
+fast_forward(APEX_CPU *cpu, long long n)
+{
+    struct timespec start, end;
+    double seconds;
+    int status;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    status = APEX_functional_run(cpu, n);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    /* The timing changes from run to run, so it stays out of the output a
+     * cache entry keeps */
+    printf("APEX_CPU: Fast-forwarded %lld instructions, pc = %d\n", cpu->insn_fast_forwarded, cpu->pc);
+    fprintf(stderr, "APEX_CPU: Fast-forward took %.3f s (%.1f MIPS)\n", seconds,
+            seconds > 0 ? cpu->insn_fast_forwarded / seconds / 1e6 : 0.0);
+
+    switch (status)
+    {
+    case APEX_FUNC_HALTED:
+        printf("APEX_CPU: Simulation Complete during fast-forward, instructions = %lld\n", cpu->insn_fast_forwarded);
+        APEX_print_regs(cpu->regs, cpu->config.pregs, cpu->config.pregs);
+        break;
+    case APEX_FUNC_FAULT:
+        fprintf(stderr, "APEX_Error: Bad data address or division by zero at pc %d during fast-forward\n", cpu->pc);
+        break;
+    case APEX_FUNC_OFF_END:
+        printf("APEX_CPU: Fast-forward ran past the end of the program\n");
+        break;
+    }
+    return status;
+}
 
 int
 main(int argc, char const *argv[])
 {
     APEX_CPU *cpu;
+    const char *filename = NULL;
+    const char *trace_file = NULL;
+    const char *kanata_file = NULL;
+    const char *checkpoint_file = NULL;
+    const char *restore_file = NULL;
+    const char *cache_dir = NULL;
+    APEX_Trace trace;
+    APEX_Kanata kanata;
+    APEX_Stats stats;
+    APEX_Cache cache;
+    APEX_Config config;
+    int configured = 0;
+    int gather_stats = 0;
+    long long stats_interval = 0;
+    int headless = 0;
+    int skip_idle = 1;
+    int max_cycles = 0;
+    long long fast_forward_insns = 0;
+    int checkpoint_cycle = -1;
+    long long checkpoint_insn = 0;
+    int trace_policy = TRACE_STALL;
+    int rerun = 0;
+    int caching = 0;
+    int status = APEX_RUN_CYCLE_LIMIT;
+    int i, used;
 
     fprintf(stderr, "APEX CPU Pipeline Simulator v%0.1lf\n", VERSION);
 
-    if (argc != 2)
+    if (argc >= 3 && strcmp(argv[1], "--batch") == 0)
+    {
+        return run_batch(argc, argv);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--simpoint") == 0)
+    {
+        return run_simpoint(argc, argv);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--parallel") == 0)
+    {
+        return run_parallel(argc, argv);
+    }
+
+    APEX_config_defaults(&config);
+    for (i = 1; i < argc; ++i)
+    {
+        if ((used = config_option(argc, argv, &i, &config)) != 0)
+        {
+            if (used < 0)
+            {
+                exit(1);
+            }
+            configured = 1;
+        }
+        else if (strcmp(argv[i], "--headless") == 0)
+        {
+            headless = 1;
+        }
+        else if (strcmp(argv[i], "--no-skip") == 0)
+        {
+            skip_idle = 0;
+        }
+        else if (strcmp(argv[i], "--max-cycles") == 0 && i + 1 < argc)
+        {
+            max_cycles = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--fast-forward") == 0 && i + 1 < argc)
+        {
+            fast_forward_insns = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            trace_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--kanata") == 0 && i + 1 < argc)
+        {
+            kanata_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--stats") == 0)
+        {
+            gather_stats = 1;
+        }
+        else if (strcmp(argv[i], "--stats-interval") == 0 && i + 1 < argc)
+        {
+            gather_stats = 1;
+            stats_interval = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--trace-drop") == 0)
+        {
+            trace_policy = TRACE_DROP;
+        }
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc)
+        {
+            checkpoint_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--checkpoint-at-cycle") == 0 && i + 1 < argc)
+        {
+            checkpoint_cycle = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--checkpoint-at-insn") == 0 && i + 1 < argc)
+        {
+            checkpoint_insn = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+        {
+            cache_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--rerun") == 0)
+        {
+            rerun = 1;
+        }
+        else if (strcmp(argv[i], "--restore") == 0 && i + 1 < argc)
+        {
+            restore_file = argv[++i];
+        }
+        else if (!filename && argv[i][0] != '-')
+        {
+            filename = argv[i];
+        }
+        else
+        {
+            filename = NULL;
+            break;
+        }
+    }
+
+    if (!filename == !restore_file || (trace_file && kanata_file) || (rerun && !cache_dir) ||
+        ((checkpoint_cycle >= 0 || checkpoint_insn > 0) && !checkpoint_file))
     {
-        fprintf(stderr, "APEX_Help: Usage %s <input_file>\n", argv[0]);
+        print_usage(argv[0]);
+        exit(1);
+    }
+    /* Only a headless run that writes nothing but its output is cached */
+    if (cache_dir && (!headless || trace_file || kanata_file || checkpoint_file || restore_file))
+    {
+        fprintf(stderr, "APEX_Error: --cache needs --headless and no trace, Kanata log or checkpoint\n");
+        exit(1);
+    }
+    if (restore_file && configured)
+    {
+        fprintf(stderr, "APEX_Error: A restored run keeps the configuration of its checkpoint\n");
         exit(1);
     }
 
-    cpu = APEX_cpu_init(argv[1]);
+    cpu = restore_file ? APEX_checkpoint_load(restore_file) : APEX_cpu_init(filename, &config);
     if (!cpu)
     {
         fprintf(stderr, "APEX_Error: Unable to initialize CPU\n");
         exit(1);
     }
+    if (restore_file)
+    {
+        printf("APEX_CPU: Restored %s at cycle %d, instructions = %d (+%lld fast-forwarded)\n",
+               restore_file, cpu->clock, cpu->insn_completed, cpu->insn_fast_forwarded);
+    }
+
+    /* Headless: no per-cycle trace or prompt, only the final stats */
+    if (headless)
+    {
+        cpu->debug_messages = 0;
+        cpu->single_step = 0;
+    }
+    cpu->max_cycles = max_cycles;
+    cpu->skip_idle = skip_idle;
+    if (checkpoint_cycle > 0)
+    {
+        cpu->max_cycles = checkpoint_cycle;
+    }
+    cpu->max_insns = checkpoint_insn;
+
+    /* The key takes only the options that change the output: --no-skip
+     * prints the same results, only sooner */
+    if (cache_dir)
+    {
+        char options[128];
+
+        snprintf(options, sizeof(options), "max_cycles=%d fast_forward=%lld stats=%d stats_interval=%lld",
+                 max_cycles, fast_forward_insns, gather_stats, stats_interval);
+        if (APEX_cache_open(&cache, cache_dir, cpu, options) < 0)
+        {
+            APEX_cpu_stop(cpu);
+            exit(1);
+        }
+        if (!rerun && APEX_cache_replay(&cache))
+        {
+            fprintf(stderr, "APEX_Cache: replayed %s\n", cache.path);
+            APEX_cpu_stop(cpu);
+            return 0;
+        }
+        caching = APEX_cache_record(&cache) == 0;
+    }
+
+    /* Before the trace opens, so that it starts from the handed-over state.
+     * The interpreter only knows architectural state, so it cannot run once
+     * the pipeline holds instructions. */
+    if (fast_forward_insns > 0 && cpu->clock > 0)
+    {
+        fprintf(stderr, "APEX_Error: Cannot fast-forward a checkpoint taken after the pipeline started\n");
+        APEX_cpu_stop(cpu);
+        exit(1);
+    }
+    if (fast_forward_insns > 0)
+    {
+        int status = fast_forward(cpu, fast_forward_insns);
+
+        if (status == APEX_FUNC_HALTED || status == APEX_FUNC_FAULT)
+        {
+            if (caching)
+            {
+                APEX_cache_finish(&cache, status == APEX_FUNC_HALTED);
+            }
+            APEX_cpu_stop(cpu);
+            return status == APEX_FUNC_FAULT;
+        }
+    }
+
+    /* The pipeline goes to the trace file instead of the terminal */
+    if (trace_file)
+    {
+        if (APEX_trace_open(&trace, trace_file, cpu, trace_policy) < 0)
+        {
+            APEX_cpu_stop(cpu);
+            exit(1);
+        }
+        cpu->trace_out = &trace;
+    }
+    if (kanata_file)
+    {
+        if (APEX_kanata_open(&kanata, kanata_file, cpu->config.rob_size) < 0)
+        {
+            APEX_cpu_stop(cpu);
+            exit(1);
+        }
+        cpu->kanata_out = &kanata;
+    }
+
+    if (gather_stats)
+    {
+        APEX_stats_start(&stats, cpu, stats_interval);
+        cpu->stats = &stats;
+    }
+
+    /* Cycle 0 is a checkpoint of the state the pipeline would start from */
+    if (checkpoint_cycle != 0)
+    {
+        status = APEX_cpu_run(cpu);
+    }
 
-    APEX_cpu_run(cpu);
+    if (trace_file)
+    {
+        APEX_trace_close(&trace);
+        printf("APEX_CPU: Trace written to %s, %lld bytes\n", trace_file, trace.bytes);
+        printf("APEX_CPU: Trace events = %lld dropped = %lld, writer stalls = %lld (%.3f s)\n",
+               trace.events, trace.dropped, trace.stalls, trace.stall_ns / 1e9);
+    }
+    if (kanata_file)
+    {
+        APEX_kanata_close(&kanata);
+        printf("APEX_CPU: Kanata log written to %s, %u instructions (%u retired, %u flushed)\n",
+               kanata_file, kanata.next_id, kanata.retired, kanata.flushed);
+    }
+    if (gather_stats)
+    {
+        APEX_stats_report(&stats);
+    }
+    if (caching)
+    {
+        APEX_cache_finish(&cache, status != APEX_RUN_STOPPED && status != APEX_RUN_FAULT);
+    }
+    if (checkpoint_file)
+    {
+        /* Nothing is left to resume after HALT */
+        if (status == APEX_RUN_HALTED || status == APEX_RUN_FAULT)
+        {
+            printf("APEX_CPU: Program %s, no checkpoint written\n", status == APEX_RUN_HALTED ? "halted" : "faulted");
+        }
+        else if (APEX_checkpoint_save(cpu, checkpoint_file) == 0)
+        {
+            printf("APEX_CPU: Checkpoint written to %s at cycle %d, instructions = %d (+%lld fast-forwarded)\n",
+                   checkpoint_file, cpu->clock, cpu->insn_completed, cpu->insn_fast_forwarded);
+        }
+        else
+        {
+            APEX_cpu_stop(cpu);
+            return 1;
+        }
+    }
     APEX_cpu_stop(cpu);
-    return 0;
-}
\ No newline at end of file
+    return status == APEX_RUN_FAULT;
+}